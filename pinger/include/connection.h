@@ -25,9 +25,15 @@
 
 #include <QObject>
 #include <QString>
+#include <QVector>
+
+#include <cstdint>
+
+#include "event_log.h"
+#include "pinger.h"
 
 class QLocalSocket;
-class Pinger;
+class LatencyHistogram;
 
 /**
  * The connection instance.
@@ -36,6 +42,27 @@ class Connection:public QObject {
     Q_OBJECT
 
     public:
+        /**
+         * Trivial class holding an unsolicited report encoded once for every connection flavor.
+         */
+        class Event {
+            public:
+                /**
+                 * The report for untagged text connections.
+                 */
+                QByteArray text;
+
+                /**
+                 * The report for text connections that use request tags.
+                 */
+                QByteArray taggedText;
+
+                /**
+                 * The report for binary connections.
+                 */
+                QByteArray frame;
+        };
+
         /**
          * Constructor
          *
@@ -48,9 +75,155 @@ class Connection:public QObject {
 
         ~Connection() override;
 
+        /**
+         * Method you can use to obtain the tag of the command being processed.
+         *
+         * \return Returns the request tag.  A value of 0 indicates the command is untagged.
+         */
+        inline unsigned long currentTag() const {
+            return requestTag;
+        }
+
+        /**
+         * Method that reports the outcome of the command being processed.
+         *
+         * \param[in] status The outcome to be reported.
+         */
+        void sendStatus(Pinger::BatchStatus status);
+
+        /**
+         * Method that reports the outcome of a single server command.
+         *
+         * \param[in] status The outcome to be reported.
+         *
+         * \param[in] tag    The tag of the command that produced the outcome.
+         */
+        void sendStatus(Pinger::BatchStatus status, unsigned long tag);
+
+        /**
+         * Method that reports the outcome of a batch command.
+         *
+         * \param[in] statuses     The per-item status characters.
+         *
+         * \param[in] numberFailed The number of items that were not applied.
+         *
+         * \param[in] tag          The tag of the batch command.
+         */
+        void sendBatchResult(const QByteArray& statuses, unsigned long numberFailed, unsigned long tag);
+
+        /**
+         * Method that reports the outcome of a sync command.
+         *
+         * \param[in] statuses      The per-item status characters.
+         *
+         * \param[in] numberRemoved The number of unlisted servers that were removed.
+         *
+         * \param[in] numberFailed  The number of items that were not applied.
+         *
+         * \param[in] tag           The tag of the sync command.
+         */
+        void sendSyncResult(
+            const QByteArray& statuses,
+            unsigned long     numberRemoved,
+            unsigned long     numberFailed,
+            unsigned long     tag
+        );
+
+        /**
+         * Method that reports the round trip latency statistics for a server in reply to the command being
+         * processed.
+         *
+         * \param[in] hostId  The ID of the server.
+         *
+         * \param[in] latency The latency histogram for the server.
+         */
+        void sendLatency(unsigned long hostId, const LatencyHistogram& latency);
+
+        /**
+         * Method that sends an unsolicited report.
+         *
+         * \param[in] event The report to be sent.
+         */
+        void sendEvent(const Event& event);
+
+        /**
+         * Method that encodes a report for a server that stopped responding.  The report is marked as an event on
+         * connections that use request tags.
+         *
+         * \param[in] hostId     The ID of the server.
+         *
+         * \param[in] serverName The name of the server, encoded as UTF-8.
+         *
+         * \return Returns the encoded report.
+         */
+        static Event noPingEvent(unsigned long hostId, const QByteArray& serverName);
+
+        /**
+         * Method that encodes a logged server state change for connections that receive sequenced events.
+         *
+         * \param[in] entry The logged event.
+         *
+         * \return Returns the encoded report.
+         */
+        static Event sequencedEvent(const EventLog::Entry& entry);
+
+        /**
+         * Method that reports the outcome of a resume command.
+         *
+         * \param[in] numberReplayed The number of logged events that were replayed.
+         *
+         * \param[in] numberLost     The number of events that could not be replayed because they are no longer
+         *                           retained.  A non-zero value means the client must re-query its servers.
+         *
+         * \param[in] lastSequence   The sequence number of the newest logged event.
+         *
+         * \param[in] reset          If true, the client's sequence number was not issued by this run, typically
+         *                           because the pinger restarted.  The client must re-query its servers.
+         */
+        void sendResumed(
+            unsigned long numberReplayed,
+            unsigned long numberLost,
+            std::uint64_t lastSequence,
+            bool          reset
+        );
+
+        /**
+         * Method you can use to determine if this connection receives sequenced events.
+         *
+         * \return Returns true if the connection receives sequenced events.  Returns false if it only receives
+         *         failure reports.
+         */
+        inline bool isStreaming() const {
+            return streaming;
+        }
+
+        /**
+         * Method that switches this connection to sequenced events.
+         */
+        inline void setStreaming() {
+            streaming = true;
+        }
+
+        /**
+         * Method you can use to determine the number of bytes waiting to be delivered to the remote side.
+         *
+         * \return Returns the number of queued bytes, including bytes held by the socket.
+         */
+        unsigned long queueDepth() const;
+
+        /**
+         * Method you can use to determine the number of bytes handed to the socket.
+         *
+         * \return Returns the number of bytes written.
+         */
+        inline unsigned long numberBytesWritten() const {
+            return bytesWritten;
+        }
+
     public slots:
         /**
-         * Slot you can overload to write a response.
+         * Slot you can overload to write a response to the command being processed.  On binary connections the
+         * message is sent as a text frame.
          *
          * \param[in] message The message to be sent.
          */
@@ -73,12 +246,385 @@ class Connection:public QObject {
          */
         static constexpr unsigned maximumLineLength = 512;
 
+        /**
+         * Value holding the maximum number of arguments in a command, including the command itself.
+         */
+        static constexpr unsigned maximumArguments = 4;
+
+        /**
+         * Value holding the maximum number of items accepted in a single batch command.
+         */
+        static constexpr int maximumBatchItems = 262144;
+
+        /**
+         * Value holding the length of a binary frame header.  The header holds the payload length as a 32-bit little
+         * endian value, the frame type and the 32-bit little endian request tag.
+         */
+        static constexpr unsigned frameHeaderLength = 9;
+
+        /**
+         * Value holding the maximum allowed binary frame payload length, in bytes.
+         */
+        static constexpr unsigned maximumFrameLength = 64 * 1024 * 1024;
+
+        /**
+         * Value holding the time to let a closing connection drain its output, in mSec.  A remote side that stops
+         * reading is cut off once this time expires.
+         */
+        static constexpr int closeTimeout = 5003;
+
+        /**
+         * Enumeration of binary frame types.  Requests use values below 0x80, replies use values from 0x80 up.
+         */
+        enum class FrameType : std::uint8_t {
+            /**
+             * Adds a server.  Payload is the 64-bit ID followed by the UTF-8 server name.
+             */
+            ADD = 0x01,
+
+            /**
+             * Removes a server.  Payload is the 64-bit ID.
+             */
+            REMOVE = 0x02,
+
+            /**
+             * Marks a server as defunct.  Payload is the 64-bit ID.
+             */
+            DEFUNCT = 0x03,
+
+            /**
+             * Sets the ping interval for a server.  Payload is the 64-bit ID followed by the 32-bit interval in mSec.
+             */
+            INTERVAL = 0x04,
+
+            /**
+             * Requests the latency statistics for a server.  Payload is the 64-bit ID.
+             */
+            LATENCY = 0x05,
+
+            /**
+             * Requests the pinger statistics.  No payload.
+             */
+            STATISTICS = 0x06,
+
+            /**
+             * Disconnects.  No payload.
+             */
+            QUIT = 0x07,
+
+            /**
+             * Changes the event subscription.  Payload is the subscription type followed, for range subscriptions,
+             * by the 64-bit first and last IDs and, optionally for owner subscriptions, by the client name.
+             */
+            SUBSCRIBE = 0x08,
+
+            /**
+             * Switches to sequenced events and replays missed events.  Payload is the 64-bit sequence number of the
+             * last event received.
+             */
+            RESUME = 0x09,
+
+            /**
+             * Adds a batch of servers.  Payload is a 32-bit count followed by, for each server, the 64-bit ID, a
+             * 16-bit name length and the UTF-8 server name.
+             */
+            BATCH_ADD = 0x10,
+
+            /**
+             * Removes a batch of servers.  Payload is a 32-bit count followed by the 64-bit IDs.
+             */
+            BATCH_REMOVE = 0x11,
+
+            /**
+             * Marks a batch of servers as defunct.  Payload is a 32-bit count followed by the 64-bit IDs.
+             */
+            BATCH_DEFUNCT = 0x12,
+
+            /**
+             * Reconciles the server table against a complete list of servers.  Payload matches
+             * \ref FrameType::BATCH_ADD.
+             */
+            SYNC = 0x13,
+
+            /**
+             * Reports the outcome of a single server command.  Payload is the status character.
+             */
+            STATUS_REPLY = 0x80,
+
+            /**
+             * Reports the outcome of a batch command.  Payload is the 32-bit item count, the 32-bit failure count
+             * and one status character per item.
+             */
+            BATCH_REPLY = 0x81,
+
+            /**
+             * Reports the outcome of a sync command.  Payload is the 32-bit item count, the 32-bit removed count,
+             * the 32-bit failure count and one status character per item.
+             */
+            SYNC_REPLY = 0x82,
+
+            /**
+             * Reports latency statistics.  Payload is the 64-bit ID, the 32-bit sample count and the last, minimum,
+             * maximum, smoothed, 50th, 90th and 99th percentile round trip times as 32-bit values in uSec.  These are
+             * followed by the 32-bit lost probe count, the smoothed loss in hundredths of a percent and the jitter in
+             * uSec.
+             */
+            LATENCY_REPLY = 0x83,
+
+            /**
+             * Reports a server that stopped responding.  Payload is the 64-bit ID followed by the UTF-8 server
+             * name.
+             */
+            NOPING_REPLY = 0x84,
+
+            /**
+             * Carries a reply that has no binary form, such as the statistics report.  Payload is UTF-8 text.
+             */
+            TEXT_REPLY = 0x85,
+
+            /**
+             * Reports a sequenced server state change.  Payload is the 64-bit sequence number, the event kind, the
+             * 64-bit ID and the UTF-8 server name.
+             */
+            EVENT_REPLY = 0x86,
+
+            /**
+             * Reports the outcome of a resume command.  Payload is the 64-bit replayed count, the 64-bit lost count,
+             * the 64-bit sequence number of the newest event and an 8-bit flag set to 1 if the event log was reset.
+             */
+            RESUME_REPLY = 0x87
+        };
+
+        /**
+         * Enumeration of batch commands.
+         */
+        enum class BatchMode : std::uint8_t {
+            /**
+             * Indicates no batch command is open.
+             */
+            NONE = 0,
+
+            /**
+             * Indicates a batch add command is open.
+             */
+            ADD = 1,
+
+            /**
+             * Indicates a batch remove command is open.
+             */
+            REMOVE = 2,
+
+            /**
+             * Indicates a batch defunct command is open.
+             */
+            DEFUNCT = 3,
+
+            /**
+             * Indicates a sync command is open.
+             */
+            SYNC = 4
+        };
+
+        /**
+         * Method that receives and processes the next text command.
+         *
+         * \param[out] failed Set to true if the socket reported an error.
+         *
+         * \return Returns true if a line was consumed.  Returns false if no complete line is available.
+         */
+        bool receiveLine(bool& failed);
+
+        /**
+         * Method that receives and processes the next binary frame.
+         *
+         * \return Returns true if a frame was consumed.  Returns false if no complete frame is available.
+         */
+        bool receiveFrame();
+
+        /**
+         * Method that stops processing commands, hands any queued output to the socket and asks the pinger to drop
+         * the connection.  The socket is closed once Qt has written the output so the caller never waits on the
+         * remote side.
+         */
+        void closeAfterFlush();
+
+        /**
+         * Method that strips an optional leading request tag, written as ``#<tag>``, from a received line.
+         *
+         * \param[in]  line   The received line.
+         *
+         * \param[in]  length The length of the line, in bytes.
+         *
+         * \param[out] valid  Set to false if the line starts with a malformed tag.
+         *
+         * \return Returns the number of bytes consumed by the tag.  The request tag is updated.
+         */
+        unsigned extractTag(const char* line, unsigned length, bool& valid);
+
         /**
          * Method that is called to process a received command.
          *
-         * \param[in] received The received command.
+         * \param[in] line   The received line.  The line is not required to be terminated.
+         *
+         * \param[in] length The length of the line, in bytes.
+         */
+        void processCommand(const char* line, unsigned length);
+
+        /**
+         * Method that is called to process a line received while a batch command is open.
+         *
+         * \param[in] arguments       The arguments found on the line.
+         *
+         * \param[in] numberArguments The number of arguments found on the line.  May exceed
+         *                            \ref Connection::maximumArguments.
+         */
+        void processBatchLine(const QLatin1String* arguments, unsigned numberArguments);
+
+        /**
+         * Method that is called to apply the items of an open batch command once its end marker is received.
          */
-        void processCommand(const QString& received);
+        void finishBatch();
+
+        /**
+         * Method that is called to process a received binary frame.
+         *
+         * \param[in] frameType The received frame type.
+         *
+         * \param[in] payload   The frame payload.
+         *
+         * \param[in] length    The payload length, in bytes.
+         */
+        void processFrame(FrameType frameType, const char* payload, unsigned length);
+
+        /**
+         * Method that is called to decode and apply a binary batch frame.
+         *
+         * \param[in] mode    The batch command carried by the frame.
+         *
+         * \param[in] payload The frame payload.
+         *
+         * \param[in] length  The payload length, in bytes.
+         */
+        void processBatchFrame(BatchMode mode, const char* payload, unsigned length);
+
+        /**
+         * Method that queues data for delivery.  Data queued during a single pass of the event loop is delivered
+         * with a single write.  A connection whose queue grows past the pinger's output limit is dropped.
+         *
+         * \param[in] data The data to be queued.
+         */
+        void queueOutput(const QByteArray& data);
+
+        /**
+         * Method that hands all queued data to the socket.
+         */
+        void flushOutput();
+
+        /**
+         * Method that sends a text reply, or a text frame on binary connections.
+         *
+         * \param[in] tag     The tag of the command being answered.  A value of 0 sends an untagged reply.
+         *
+         * \param[in] message The message to be sent.
+         */
+        void sendReply(unsigned long tag, const QString& message);
+
+        /**
+         * Method that sends a binary frame.
+         *
+         * \param[in] frame The frame to be sent.  The frame must start with \ref Connection::frameHeaderLength bytes
+         *                  reserved for the header.
+         *
+         * \param[in] type  The frame type.
+         *
+         * \param[in] tag   The tag of the command being answered.  Unsolicited frames use 0.
+         */
+        void sendFrame(QByteArray& frame, FrameType type, unsigned long tag);
+
+        /**
+         * Method that fills in the header of a binary frame.
+         *
+         * \param[in] frame The frame to be updated.  The frame must start with \ref Connection::frameHeaderLength
+         *                  bytes reserved for the header.
+         *
+         * \param[in] type  The frame type.
+         *
+         * \param[in] tag   The tag of the command being answered.  Unsolicited frames use 0.
+         */
+        static void encodeFrameHeader(QByteArray& frame, FrameType type, unsigned long tag);
+
+        /**
+         * Method that creates an empty frame with space reserved for the header.
+         *
+         * \param[in] payloadLength The expected payload length, in bytes.
+         *
+         * \return Returns the new frame.
+         */
+        static QByteArray newFrame(unsigned payloadLength);
+
+        /**
+         * Method that appends a 32-bit little endian value to a frame.
+         *
+         * \param[in] frame The frame to append to.
+         *
+         * \param[in] value The value to be appended.
+         */
+        static void appendUnsigned32(QByteArray& frame, std::uint32_t value);
+
+        /**
+         * Method that appends a 64-bit little endian value to a frame.
+         *
+         * \param[in] frame The frame to append to.
+         *
+         * \param[in] value The value to be appended.
+         */
+        static void appendUnsigned64(QByteArray& frame, std::uint64_t value);
+
+        /**
+         * Method that converts a time in mSec to a 32-bit time in uSec, saturating on overflow.
+         *
+         * \param[in] milliseconds The time in mSec.
+         *
+         * \return Returns the time in uSec.
+         */
+        static std::uint32_t toMicroseconds(double milliseconds);
+
+        /**
+         * Method that replies to a command that could not be processed.  The reply echoes the line with surrounding
+         * whitespace removed.
+         *
+         * \param[in] line   The received line.
+         *
+         * \param[in] length The length of the line, in bytes.
+         */
+        void sendError(const char* line, unsigned length);
+
+        /**
+         * Method that splits a line into whitespace separated arguments.  The arguments refer to the line and are
+         * only valid as long as the line is.
+         *
+         * \param[in]  line      The line to be split.
+         *
+         * \param[in]  length    The length of the line, in bytes.
+         *
+         * \param[out] arguments Array populated with the arguments.  Must hold \ref Connection::maximumArguments
+         *                       entries.
+         *
+         * \return Returns the number of arguments found.  Values above \ref Connection::maximumArguments indicate
+         *         that only the first arguments were stored.
+         */
+        static unsigned splitArguments(const char* line, unsigned length, QLatin1String* arguments);
+
+        /**
+         * Method that converts an argument to a host ID.
+         *
+         * \param[in]  argument The argument to be converted.
+         *
+         * \param[out] value    The converted value.
+         *
+         * \return Returns true if the argument is a valid decimal number.  Returns false otherwise.
+         */
+        static bool toUnsignedLong(QLatin1String argument, unsigned long& value);
 
         /**
          * Method that obtains a pointer to the pinger instance we are controlling.
@@ -91,6 +637,88 @@ class Connection:public QObject {
          * The local socket to receive the data.
          */
         QLocalSocket* socket;
+
+        /**
+         * Flag indicating that the connection switched to binary framing.
+         */
+        bool binary;
+
+        /**
+         * Flag indicating that the connection has received a command.  BINARY is only accepted as the first command.
+         */
+        bool started;
+
+        /**
+         * Buffer holding the payload of the binary frame being processed.  Reused across frames.
+         */
+        QByteArray frameBuffer;
+
+        /**
+         * Flag indicating that the connection receives sequenced events.
+         */
+        bool streaming;
+
+        /**
+         * Flag indicating that the remote side has used request tags.  Unsolicited text replies are then marked as
+         * events.
+         */
+        bool tagged;
+
+        /**
+         * The tag of the command being processed.
+         */
+        unsigned long requestTag;
+
+        /**
+         * The tag of the open batch command.
+         */
+        unsigned long batchTag;
+
+        /**
+         * Data waiting to be handed to the socket.
+         */
+        QByteArray outputBuffer;
+
+        /**
+         * Flag indicating that a flush of the output buffer has been scheduled.
+         */
+        bool flushScheduled;
+
+        /**
+         * The number of bytes handed to the socket.
+         */
+        unsigned long bytesWritten;
+
+        /**
+         * Flag indicating that the rest of an overlong line is being discarded.
+         */
+        bool discarding;
+
+        /**
+         * Flag indicating that the remote side asked to disconnect.  No further commands are processed.
+         */
+        bool closing;
+
+        /**
+         * Flag indicating that the connection was dropped for not keeping up.  Queued output is discarded rather than
+         * drained when the connection is closed.
+         */
+        bool dropped;
+
+        /**
+         * The batch command that is currently open.
+         */
+        BatchMode batchMode;
+
+        /**
+         * The items received for the open batch command.
+         */
+        QVector<Pinger::BatchItem> batchItems;
+
+        /**
+         * Flag indicating that the open batch command holds too many items and will be rejected.
+         */
+        bool batchOverflow;
 };
 
 #endif
@@ -0,0 +1,162 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref EventLog class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <cstdint>
+
+/**
+ * Class that keeps a bounded history of server state changes so that clients can resume after a lost connection.
+ *
+ * Every event is assigned a sequence number one above the previous event.  The upper bits of each sequence number
+ * hold an epoch chosen when the log is created, so sequence numbers from an earlier run are recognized as such
+ * rather than being compared against this run's counter.  Sequence numbers never depend on the wall clock once the
+ * log exists.  The log holds the most recent events in a fixed size ring, so appending never allocates once the ring
+ * is full and the oldest events are silently overwritten.
+ */
+class EventLog {
+    public:
+        /**
+         * Enumeration of logged state changes.
+         */
+        enum class Kind : std::uint8_t {
+            /**
+             * Indicates a server stopped responding and was flagged.
+             */
+            FAILED = 1,
+
+            /**
+             * Indicates a flagged server started responding again.
+             */
+            RECOVERED = 2
+        };
+
+        /**
+         * Trivial class holding a single logged event.
+         */
+        class Entry {
+            public:
+                /**
+                 * The event sequence number.
+                 */
+                std::uint64_t sequence;
+
+                /**
+                 * The ID of the server.
+                 */
+                unsigned long hostId;
+
+                /**
+                 * The name of the server at the time of the event, encoded as UTF-8.
+                 */
+                QByteArray serverName;
+
+                /**
+                 * The state change.
+                 */
+                Kind kind;
+        };
+
+        /**
+         * Value holding the bit position of the epoch within a sequence number.  The lower bits hold a counter
+         * starting at 1.
+         */
+        static constexpr unsigned epochShift = 40;
+
+        /**
+         * Constructor.  The epoch is drawn from the clock so that each run is likely to use a different epoch.
+         *
+         * \param[in] capacity The number of events to retain.
+         */
+        EventLog(unsigned capacity);
+
+        /**
+         * Method you can use to record an event.
+         *
+         * \param[in] kind       The state change.
+         *
+         * \param[in] hostId     The ID of the server.
+         *
+         * \param[in] serverName The name of the server, encoded as UTF-8.
+         *
+         * \return Returns the logged event.
+         */
+        const Entry& append(Kind kind, unsigned long hostId, const QByteArray& serverName);
+
+        /**
+         * Method you can use to obtain the sequence number of the oldest retained event.
+         *
+         * \return Returns the oldest retained sequence number.  Returns the next sequence number to be assigned if
+         *         no events are retained.
+         */
+        std::uint64_t firstSequence() const;
+
+        /**
+         * Method you can use to obtain the sequence number of the newest event.
+         *
+         * \return Returns the newest sequence number.  Returns one below \ref EventLog::firstSequence if no events
+         *         are retained.
+         */
+        std::uint64_t lastSequence() const;
+
+        /**
+         * Method you can use to obtain a retained event.
+         *
+         * \param[in] sequence The sequence number of the event.  Must lie between \ref EventLog::firstSequence and
+         *                     \ref EventLog::lastSequence.
+         *
+         * \return Returns the requested event.
+         */
+        const Entry& entry(std::uint64_t sequence) const;
+
+        /**
+         * Method you can use to determine if a sequence number was issued by this log.
+         *
+         * \param[in] sequence The sequence number to check.
+         *
+         * \return Returns true if the sequence number carries this log's epoch and has already been assigned.
+         *         Returns false for sequence numbers from an earlier run or that were never issued.
+         */
+        bool isIssued(std::uint64_t sequence) const;
+
+    private:
+        /**
+         * The ring of retained events.
+         */
+        QVector<Entry> entries;
+
+        /**
+         * The number of retained events.
+         */
+        unsigned numberEntries;
+
+        /**
+         * The sequence number to assign to the next event.
+         */
+        std::uint64_t nextSequence;
+};
+
+#endif
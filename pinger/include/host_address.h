@@ -0,0 +1,161 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref HostAddress class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef HOST_ADDRESS_H
+#define HOST_ADDRESS_H
+
+#include <QString>
+
+#include <cstring>
+
+#include <sys/socket.h>
+
+/**
+ * Class that holds a resolved IPv4 or IPv6 socket address.
+ */
+class HostAddress {
+    public:
+        /**
+         * Constructor.  Creates a null address.
+         */
+        inline HostAddress():currentLength(0) {
+            std::memset(&currentAddress, 0, sizeof(currentAddress));
+        }
+
+        /**
+         * Constructor
+         *
+         * \param[in] address The socket address to be copied.
+         *
+         * \param[in] length  The length of the socket address, in bytes.
+         */
+        HostAddress(const struct sockaddr* address, socklen_t length);
+
+        /**
+         * Copy constructor
+         *
+         * \param[in] other The instance to assign to this instance.
+         */
+        inline HostAddress(const HostAddress& other):currentLength(other.currentLength) {
+            std::memcpy(&currentAddress, &other.currentAddress, sizeof(currentAddress));
+        }
+
+        /**
+         * Method you can use to determine if this address is valid.
+         *
+         * \return Returns true if this address is null.  Returns false if the address is valid.
+         */
+        inline bool isNull() const {
+            return currentLength == 0;
+        }
+
+        /**
+         * Method you can use to obtain the address family.
+         *
+         * \return Returns the address family, either AF_INET or AF_INET6.  AF_UNSPEC is returned for null addresses.
+         */
+        inline int family() const {
+            return currentAddress.ss_family;
+        }
+
+        /**
+         * Method you can use to obtain the underlying socket address.
+         *
+         * \return Returns a pointer to the socket address.
+         */
+        inline const struct sockaddr* socketAddress() const {
+            return reinterpret_cast<const struct sockaddr*>(&currentAddress);
+        }
+
+        /**
+         * Method you can use to obtain the length of the underlying socket address.
+         *
+         * \return Returns the socket address length, in bytes.
+         */
+        inline socklen_t length() const {
+            return currentLength;
+        }
+
+        /**
+         * Method you can use to determine if a received socket address refers to the same host as this address.  Only
+         * the address family and IP address are compared.
+         *
+         * \param[in] address The socket address to compare against.
+         *
+         * \return Returns true if the addresses refer to the same host.  Returns false otherwise.
+         */
+        bool matches(const struct sockaddr* address) const;
+
+        /**
+         * Method you can use to convert this address to a numeric string, for logging.
+         *
+         * \return Returns the address in numeric form.
+         */
+        QString toString() const;
+
+        /**
+         * Static method that resolves a host name.  This method blocks until the resolution completes.
+         *
+         * \param[in]  hostName     The host name to be resolved.
+         *
+         * \param[out] errorMessage An optional string populated with a description of any error.
+         *
+         * \return Returns the resolved address.  A null address is returned on error.
+         */
+        static HostAddress resolve(const QString& hostName, QString* errorMessage = nullptr);
+
+        /**
+         * Static method that converts an IPv4 or IPv6 address literal.  No lookup is performed.
+         *
+         * \param[in] hostName The host name to be converted.
+         *
+         * \return Returns the converted address.  A null address is returned if the name is not an address literal.
+         */
+        static HostAddress fromLiteral(const QString& hostName);
+
+        /**
+         * Assignment operator.
+         *
+         * \param[in] other The instance to assign to this instance.
+         *
+         * \return Returns a reference to this instance.
+         */
+        inline HostAddress& operator=(const HostAddress& other) {
+            std::memcpy(&currentAddress, &other.currentAddress, sizeof(currentAddress));
+            currentLength = other.currentLength;
+
+            return *this;
+        }
+
+    private:
+        /**
+         * The socket address.
+         */
+        struct sockaddr_storage currentAddress;
+
+        /**
+         * The socket address length.
+         */
+        socklen_t currentLength;
+};
+
+#endif
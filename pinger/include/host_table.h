@@ -0,0 +1,348 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref HostTable class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef HOST_TABLE_H
+#define HOST_TABLE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "server_data.h"
+#include "latency_histogram.h"
+
+/**
+ * Class that holds the pinger's per-server state in dense, index-addressed arrays.
+ *
+ * Each server occupies one handle.  The fields touched while processing probe results are kept in separate arrays so
+ * that scans only pull in the bytes they use.  Server names are interned and kept as UTF-8 so that events can be
+ * encoded without converting the name.  Latency histograms are only allocated once a server first replies.  Released
+ * handles, names and histograms are reused, so a steady host population does not allocate.  Each handle carries a
+ * generation that advances when its server is erased, so work tagged with a context from an earlier occupant of a
+ * reused handle is recognized as stale.
+ */
+class HostTable {
+    public:
+        /**
+         * Type used to identify a server within the table.  Handles stay valid until the server is erased.
+         */
+        typedef unsigned Handle;
+
+        /**
+         * Value indicating an invalid handle.
+         */
+        static constexpr Handle invalidHandle = static_cast<Handle>(-1);
+
+        /**
+         * Type used to tag work, such as ping engine results, with the server it was issued for.  A context holds the
+         * handle and the handle's generation.
+         */
+        typedef std::uint64_t Context;
+
+        HostTable();
+
+        /**
+         * Method you can use to add a server to the table.
+         *
+         * \param[in] hostId     The ID of the server.  The ID must not already be in the table.
+         *
+         * \param[in] serverName The name of the server.
+         *
+         * \return Returns the handle assigned to the server.
+         */
+        Handle insert(unsigned long hostId, const QString& serverName);
+
+        /**
+         * Method you can use to remove a server from the table.
+         *
+         * \param[in] handle The handle of the server to be removed.
+         */
+        void erase(Handle handle);
+
+        /**
+         * Method you can use to locate a server.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \return Returns the handle of the server.  Returns \ref HostTable::invalidHandle if the server is not in
+         *         the table.
+         */
+        inline Handle find(unsigned long hostId) const {
+            return index.value(hostId, invalidHandle);
+        }
+
+        /**
+         * Method you can use to locate a server using a context that may be stale.  No ID lookup is performed.
+         *
+         * \param[in] hostId  The ID of the server.
+         *
+         * \param[in] context The context obtained from \ref HostTable::context when the work was issued.
+         *
+         * \return Returns the handle of the server.  Returns \ref HostTable::invalidHandle if the server has since
+         *         been erased, even if a server with the same ID was added again.
+         */
+        inline Handle find(unsigned long hostId, Context context) const {
+            Handle handle  = static_cast<Handle>(context);
+            bool   current = (
+                   handle < static_cast<Handle>(ids.size())
+                && ids.at(static_cast<int>(handle)) == hostId
+                && generations.at(static_cast<int>(handle)) == static_cast<std::uint32_t>(context >> 32)
+            );
+
+            return current ? handle : invalidHandle;
+        }
+
+        /**
+         * Method you can use to obtain the context used to tag work issued for a server.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the server's current context.
+         */
+        inline Context context(Handle handle) const {
+            return (static_cast<Context>(generations.at(static_cast<int>(handle))) << 32) | handle;
+        }
+
+        /**
+         * Method you can use to determine the number of servers in the table.
+         *
+         * \return Returns the number of servers.
+         */
+        inline unsigned long size() const {
+            return static_cast<unsigned long>(index.size());
+        }
+
+        /**
+         * Method you can use to determine the number of handles in use or free.  Handles below this value whose
+         * server ID is 0 are free.
+         *
+         * \return Returns one past the highest handle ever assigned.
+         */
+        inline Handle numberHandles() const {
+            return static_cast<Handle>(ids.size());
+        }
+
+        /**
+         * Method you can use to obtain a server's ID.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the server ID.  Returns 0 if the handle is free.
+         */
+        inline unsigned long hostId(Handle handle) const {
+            return ids.at(static_cast<int>(handle));
+        }
+
+        /**
+         * Method you can use to obtain a server's name.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the server name, encoded as UTF-8.
+         */
+        inline const QByteArray& serverName(Handle handle) const {
+            return names.at(static_cast<int>(nameIds.at(static_cast<int>(handle))));
+        }
+
+        /**
+         * Method you can use to check a server's name.  The check does not allocate for names that are plain ASCII.
+         *
+         * \param[in] handle     The handle of the server.
+         *
+         * \param[in] serverName The name to compare against.
+         *
+         * \return Returns true if the server has the supplied name.  Returns false if the names differ.
+         */
+        bool isNamed(Handle handle, const QString& serverName) const;
+
+        /**
+         * Method you can use to obtain a server's status.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the server status.
+         */
+        inline ServerData::Status status(Handle handle) const {
+            return statuses.at(static_cast<int>(handle));
+        }
+
+        /**
+         * Method you can use to update a server's status.
+         *
+         * \param[in] handle    The handle of the server.
+         *
+         * \param[in] newStatus The new server status.
+         */
+        inline void setStatus(Handle handle, ServerData::Status newStatus) {
+            statuses[static_cast<int>(handle)] = newStatus;
+        }
+
+        /**
+         * Method you can use to obtain a server's slot in the status table.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the status table slot.
+         */
+        inline unsigned statusSlot(Handle handle) const {
+            return statusSlots.at(static_cast<int>(handle));
+        }
+
+        /**
+         * Method you can use to set a server's slot in the status table.
+         *
+         * \param[in] handle        The handle of the server.
+         *
+         * \param[in] newStatusSlot The new status table slot.
+         */
+        inline void setStatusSlot(Handle handle, unsigned newStatusSlot) {
+            statusSlots[static_cast<int>(handle)] = newStatusSlot;
+        }
+
+        /**
+         * Method you can use to record a latency measured for a server.
+         *
+         * \param[in] handle  The handle of the server.
+         *
+         * \param[in] latency The measured latency, in milliseconds.  A negative value records a lost probe.
+         */
+        void addSample(Handle handle, double latency);
+
+        /**
+         * Method you can use to obtain the latencies measured for a server.
+         *
+         * \param[in] handle The handle of the server.
+         *
+         * \return Returns the server's latency histogram.  An empty histogram is returned if the server never replied.
+         */
+        const LatencyHistogram& latency(Handle handle) const;
+
+        /**
+         * Method you can use to determine the memory held by the table.
+         *
+         * \return Returns the approximate number of bytes held by the table.
+         */
+        std::size_t memoryUsage() const;
+
+    private:
+        /**
+         * Value indicating a server has no latency histogram.
+         */
+        static constexpr unsigned noHistogram = static_cast<unsigned>(-1);
+
+        /**
+         * Method that interns a server name.
+         *
+         * \param[in] serverName The server name.
+         *
+         * \return Returns the ID of the interned name.
+         */
+        unsigned internName(const QString& serverName);
+
+        /**
+         * Method that releases a reference to an interned name.
+         *
+         * \param[in] nameId The ID of the interned name.
+         */
+        void releaseName(unsigned nameId);
+
+        /**
+         * The server IDs, indexed by handle.  A value of 0 indicates a free handle.
+         */
+        QVector<unsigned long> ids;
+
+        /**
+         * The handle generations, indexed by handle.  Advanced each time a handle is released.
+         */
+        QVector<std::uint32_t> generations;
+
+        /**
+         * The server statuses, indexed by handle.
+         */
+        QVector<ServerData::Status> statuses;
+
+        /**
+         * The status table slots, indexed by handle.
+         */
+        QVector<unsigned> statusSlots;
+
+        /**
+         * The interned name IDs, indexed by handle.
+         */
+        QVector<unsigned> nameIds;
+
+        /**
+         * The latency histogram indexes, indexed by handle.
+         */
+        QVector<unsigned> histogramIds;
+
+        /**
+         * Released handles available for reuse.
+         */
+        QVector<Handle> freeHandles;
+
+        /**
+         * Index from server ID to handle.
+         */
+        QHash<unsigned long, Handle> index;
+
+        /**
+         * The latency histograms.
+         */
+        QVector<LatencyHistogram> histograms;
+
+        /**
+         * Released latency histograms available for reuse.
+         */
+        QVector<unsigned> freeHistograms;
+
+        /**
+         * The interned names, encoded as UTF-8 and indexed by name ID.
+         */
+        QVector<QByteArray> names;
+
+        /**
+         * The number of servers using each interned name.
+         */
+        QVector<unsigned> nameReferences;
+
+        /**
+         * Released name IDs available for reuse.
+         */
+        QVector<unsigned> freeNames;
+
+        /**
+         * Index from UTF-8 name to name ID.
+         */
+        QHash<QByteArray, unsigned> nameIndex;
+
+        /**
+         * The total length of the interned names, in bytes.
+         */
+        std::size_t nameBytes;
+};
+
+#endif
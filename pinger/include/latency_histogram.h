@@ -0,0 +1,236 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyHistogram class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+
+/**
+ * Class that tracks the distribution of round trip latencies measured for a single host, along with the host's packet
+ * loss and jitter.
+ *
+ * Latencies are recorded in microseconds into log-bucketed counters in the style of an HDR histogram.  Values below 16
+ * microseconds get their own bucket.  Larger values are split into 8 buckets per power of two, bounding the error of
+ * any reported percentile to 1/16 of the value.  Values of 16.7 seconds or more share the last bucket.
+ *
+ * Loss and jitter are tracked incrementally without keeping individual samples.  Jitter follows RFC 3550, section
+ * 6.4.1, applied to the difference between consecutive round trip times.
+ *
+ * Each instance occupies a fixed 388 bytes and never allocates.  Recording a sample is O(1).  When a counter
+ * saturates, every counter is halved which keeps the shape of the distribution while gradually aging out old samples.
+ */
+class LatencyHistogram {
+    public:
+        /**
+         * The number of bits used to split each power of two into buckets.
+         */
+        static constexpr unsigned subBucketBits = 3;
+
+        /**
+         * The number of buckets per power of two.
+         */
+        static constexpr unsigned subBuckets = 1U << subBucketBits;
+
+        /**
+         * The exponent of the smallest power of two, in microseconds, that is not tracked.
+         */
+        static constexpr unsigned maximumExponent = 24;
+
+        /**
+         * The number of buckets.
+         */
+        static constexpr unsigned numberBuckets = (maximumExponent - subBucketBits + 1) * subBuckets;
+
+        /**
+         * Constructor.  Creates an empty histogram.
+         */
+        LatencyHistogram();
+
+        /**
+         * Method you can use to record a latency sample.
+         *
+         * \param[in] latency The measured latency, in milliseconds.  A negative value records a lost probe.
+         */
+        void addSample(double latency);
+
+        /**
+         * Method you can use to discard every recorded sample.
+         */
+        void clear();
+
+        /**
+         * Method you can use to obtain the number of samples recorded.
+         *
+         * \return Returns the number of samples recorded since the histogram was created or cleared.
+         */
+        inline unsigned long numberSamples() const {
+            return samples;
+        }
+
+        /**
+         * Method you can use to obtain the most recently recorded latency.
+         *
+         * \return Returns the last latency, in milliseconds.  A value of 0 is returned if no samples were recorded.
+         */
+        inline double last() const {
+            return lastLatency;
+        }
+
+        /**
+         * Method you can use to obtain the smallest recorded latency.
+         *
+         * \return Returns the minimum latency, in milliseconds.  A value of 0 is returned if no samples were recorded.
+         */
+        inline double minimum() const {
+            return minimumLatency;
+        }
+
+        /**
+         * Method you can use to obtain the largest recorded latency.
+         *
+         * \return Returns the maximum latency, in milliseconds.  A value of 0 is returned if no samples were recorded.
+         */
+        inline double maximum() const {
+            return maximumLatency;
+        }
+
+        /**
+         * Method you can use to obtain the exponentially weighted moving average of the recorded latencies.  Each
+         * sample carries a weight of 1/8.
+         *
+         * \return Returns the average latency, in milliseconds.  A value of 0 is returned if no samples were recorded.
+         */
+        inline double average() const {
+            return averageLatency;
+        }
+
+        /**
+         * Method you can use to obtain the number of lost probes recorded.
+         *
+         * \return Returns the number of lost probes recorded since the histogram was created or cleared.
+         */
+        inline unsigned long numberLosses() const {
+            return losses;
+        }
+
+        /**
+         * Method you can use to obtain the exponentially weighted moving average of the packet loss.  Each probe
+         * carries a weight of 1/16.
+         *
+         * \return Returns the loss, as a percentage.
+         */
+        inline double lossRate() const {
+            return 100.0 * lossAverage;
+        }
+
+        /**
+         * Method you can use to obtain the interarrival jitter, as defined by RFC 3550.
+         *
+         * \return Returns the jitter, in milliseconds.  A value of 0 is returned if fewer than two samples were
+         *         recorded.
+         */
+        inline double jitter() const {
+            return jitterEstimate;
+        }
+
+        /**
+         * Method you can use to estimate a latency percentile.
+         *
+         * \param[in] fraction The fraction of samples that should fall at or below the returned value, from 0 to 1.
+         *
+         * \return Returns the estimated latency, in milliseconds.  A value of 0 is returned if no samples were
+         *         recorded.
+         */
+        double percentile(double fraction) const;
+
+    private:
+        /**
+         * Method that locates the bucket holding a value.
+         *
+         * \param[in] value The value, in microseconds.
+         *
+         * \return Returns the bucket index.
+         */
+        static unsigned bucketFor(std::uint32_t value);
+
+        /**
+         * Method that calculates the value at the middle of a bucket.
+         *
+         * \param[in] bucket The bucket index.
+         *
+         * \return Returns the value, in microseconds.
+         */
+        static std::uint32_t bucketValue(unsigned bucket);
+
+        /**
+         * The sample counters, one per bucket.
+         */
+        std::uint16_t counts[numberBuckets];
+
+        /**
+         * The sum of the sample counters.
+         */
+        std::uint32_t total;
+
+        /**
+         * The number of samples recorded.
+         */
+        std::uint32_t samples;
+
+        /**
+         * The last recorded latency, in milliseconds.
+         */
+        float lastLatency;
+
+        /**
+         * The smallest recorded latency, in milliseconds.
+         */
+        float minimumLatency;
+
+        /**
+         * The largest recorded latency, in milliseconds.
+         */
+        float maximumLatency;
+
+        /**
+         * The exponentially weighted moving average latency, in milliseconds.
+         */
+        float averageLatency;
+
+        /**
+         * The number of lost probes recorded.
+         */
+        std::uint32_t losses;
+
+        /**
+         * The exponentially weighted moving average of the loss, as a fraction.
+         */
+        float lossAverage;
+
+        /**
+         * The interarrival jitter, in milliseconds.
+         */
+        float jitterEstimate;
+};
+
+#endif
@@ -0,0 +1,1573 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref PingEngine class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef PING_ENGINE_H
+#define PING_ENGINE_H
+
+#include <QObject>
+#include <QMetaType>
+#include <QString>
+#include <QHash>
+#include <QVector>
+
+#include <atomic>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "host_address.h"
+
+class QTimer;
+class QSocketNotifier;
+
+/**
+ * Class that sends ICMP echo requests to a persistent table of hosts and collects the replies.  The engine is fully
+ * event driven and is intended to live in its own thread.  All public slots must be invoked through a queued
+ * connection from other threads.
+ *
+ * Hosts are held in one of several pools.  Adding, removing or moving a host between pools is O(1) and never requires
+ * the host name to be re-resolved.
+ *
+ * Probes are paced rather than sent in one burst per pool.  Every host carries its own interval and an absolute
+ * deadline for its next probe.  Hosts are held in a hierarchical timing wheel so that scheduling, rescheduling and
+ * removing a host are all O(1) regardless of how many hosts are held or how their intervals differ.  A short periodic
+ * tick advances the wheel and services every host that has come due, subject to a per-tick burst budget.  A host's
+ * deadline advances by exactly one interval per probe so the schedule does not drift with timer jitter.  Hosts that
+ * fall a full interval or more behind skip the missed probes and the skipped probes are counted rather than queued.
+ * Each probe carries its own deadline, derived from the host's smoothed round trip time and its variance, so a silent
+ * host is declared lost as soon as its own deadline passes.  Results are reported in batches as probes are answered or
+ * expire.
+ *
+ * Several engines can run side by side, one per shard.  Each engine owns its own sockets, uses its own ICMP
+ * identifier and installs a socket filter so that the kernel only delivers the replies addressed to it.
+ */
+class PingEngine:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Enumeration of supported host pools.
+         */
+        enum class Pool : std::uint8_t {
+            /**
+             * Pool holding hosts that have not yet been tested.
+             */
+            UNTESTED = 0,
+
+            /**
+             * Pool holding hosts that are actively monitored.
+             */
+            ACTIVE = 1,
+
+            /**
+             * Pool holding hosts that do not respond.
+             */
+            DEFUNCT = 2,
+
+            /**
+             * Pool holding monitored hosts that stopped responding and were flagged.
+             */
+            FLAGGED = 3,
+
+            /**
+             * Value indicating the number of pools.
+             */
+            NUMBER_POOLS = 4
+        };
+
+        /**
+         * Trivial class used to report the result of pinging a single host.
+         */
+        class Result {
+            public:
+                /**
+                 * The ID of the host that was pinged.
+                 */
+                unsigned long hostId;
+
+                /**
+                 * The context supplied when the host was added.
+                 */
+                std::uint64_t context;
+
+                /**
+                 * The measured round trip latency, in milliseconds.  A negative value indicates no reply.
+                 */
+                double latency;
+
+                /**
+                 * The time since the first probe of the host's current run of unanswered probes was sent, in
+                 * milliseconds.  The value is 0 for answered probes.
+                 */
+                double outage;
+
+                /**
+                 * The number of probes in the cycle this result completes.  A value of 0 indicates the host's cycle
+                 * is still in progress.  Confirmation probes each form a cycle of their own.
+                 */
+                unsigned cycleProbes;
+
+                /**
+                 * The number of probes answered in the cycle this result completes.
+                 */
+                unsigned cycleReplies;
+        };
+
+        /**
+         * Trivial class used to add hosts in bulk.
+         */
+        class HostEntry {
+            public:
+                /**
+                 * The ID of the host.
+                 */
+                unsigned long hostId;
+
+                /**
+                 * An opaque value returned with each result for this host.
+                 */
+                std::uint64_t context;
+
+                /**
+                 * The address of the host.
+                 */
+                HostAddress address;
+        };
+
+        /**
+         * The default number of packets submitted or reaped per system call.
+         */
+        static constexpr unsigned defaultBatchSize = 64;
+
+        /**
+         * The maximum number of packets submitted or reaped per system call.
+         */
+        static constexpr unsigned maximumBatchSize = 256;
+
+        /**
+         * The default maximum number of probes sent per tick.
+         */
+        static constexpr unsigned defaultBurstBudget = 512;
+
+        /**
+         * The default shortest time to wait for a reply, in milliseconds.
+         */
+        static constexpr unsigned defaultMinimumTimeout = 97;
+
+        /**
+         * The default number of confirmation probes sent after an active host first misses a reply.  Confirmation is
+         * opt-in as it adds probes on every transient loss.
+         */
+        static constexpr unsigned defaultConfirmProbes = 0;
+
+        /**
+         * The default minimum spacing between confirmation probes, in milliseconds.
+         */
+        static constexpr unsigned defaultConfirmSpacing = 499;
+
+        /**
+         * The default number of probes sent to each active host per cycle.
+         */
+        static constexpr unsigned defaultBurstProbes = 1;
+
+        /**
+         * The largest supported number of probes sent to each active host per cycle.
+         */
+        static constexpr unsigned maximumBurstProbes = 16;
+
+        /**
+         * The default minimum spacing between the probes of a cycle, in milliseconds.
+         */
+        static constexpr unsigned defaultBurstSpacing = 97;
+
+        /**
+         * Constructor.  The ICMP sockets are opened by the constructor.
+         *
+         * \param[in] shardIndex The index of the shard served by this engine.  Engines serving different shards must
+         *                       use different indexes.
+         *
+         * \param[in] parent     Pointer to the parent object.  Must be null if the engine is to be moved to another
+         *                       thread.
+         */
+        PingEngine(unsigned shardIndex = 0, QObject* parent = nullptr);
+
+        ~PingEngine() override;
+
+        /**
+         * Method you can use to determine if the engine was able to open at least one ICMP socket.
+         *
+         * \return Returns true if the engine is usable.  Returns false if no ICMP socket could be opened.
+         */
+        bool isOpen() const;
+
+        /**
+         * Method you can use to obtain a description of the last socket error.
+         *
+         * \return Returns a string describing the last error.
+         */
+        QString errorString() const;
+
+        /**
+         * Method you can use to obtain the index of the shard served by this engine.
+         *
+         * \return Returns the shard index.
+         */
+        inline unsigned shardIndex() const {
+            return shard;
+        }
+
+        /**
+         * Method you can use to obtain the number of hosts added to the engine.  This method is thread safe.
+         *
+         * \return Returns the number of host add operations.
+         */
+        inline unsigned long numberHostAdds() const {
+            return hostAdds.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of hosts removed from the engine.  This method is thread safe.
+         *
+         * \return Returns the number of host remove operations.
+         */
+        inline unsigned long numberHostRemoves() const {
+            return hostRemoves.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of hosts moved between pools.  This method is thread safe.
+         *
+         * \return Returns the number of host move operations.
+         */
+        inline unsigned long numberHostMoves() const {
+            return hostMoves.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of hosts held by the engine.  This method is thread safe.
+         *
+         * \return Returns the number of hosts.
+         */
+        inline unsigned long numberHosts() const {
+            return hostCount.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to determine the memory held by the engine's host table.  This method is thread safe.
+         *
+         * \return Returns the approximate number of bytes held by the host records and the host ID index.
+         */
+        inline unsigned long memoryUsage() const {
+            return hostMemory.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to check whether the engine has handed over results for a pool.  The receiving thread
+         * polls this method rather than being signalled, so handing results over never allocates.  Results stay
+         * pending until they are released with \ref PingEngine::releaseResults and no further results are handed
+         * over for the pool until then.  This method is thread safe.
+         *
+         * \param[in]  pool   The pool holding the hosts.
+         *
+         * \param[out] buffer Populated with the index of the buffer holding the results.  Only set if results are
+         *                    pending.
+         *
+         * \return Returns true if results are pending.  Returns false if there are no results to process.
+         */
+        inline bool pendingResults(PingEngine::Pool pool, unsigned& buffer) const {
+            const PoolState& poolState = pools[static_cast<unsigned>(pool)];
+
+            bool pending = poolState.reportPending.load(std::memory_order_acquire);
+            if (pending) {
+                buffer = poolState.reportedBuffer;
+            }
+
+            return pending;
+        }
+
+        /**
+         * Method you can use to obtain the results reported by \ref PingEngine::pendingResults.  This method may be
+         * called from the receiving thread until the results are released.
+         *
+         * \param[in] pool   The pool holding the hosts.
+         *
+         * \param[in] buffer The buffer index supplied by \ref PingEngine::pendingResults.
+         *
+         * \return Returns the results for each completed probe.  Hosts moved out of or removed from the pool while a
+         *         probe was in flight are not reported.
+         */
+        inline const QVector<Result>& reportedResults(PingEngine::Pool pool, unsigned buffer) const {
+            return pools[static_cast<unsigned>(pool)].results[buffer];
+        }
+
+        /**
+         * Method you call once the results reported for a pool have been processed.  The engine then reuses the
+         * buffer, so the results must not be accessed afterwards.  This method is thread safe.
+         *
+         * \param[in] pool The pool holding the hosts.
+         */
+        inline void releaseResults(PingEngine::Pool pool) {
+            pools[static_cast<unsigned>(pool)].reportPending.store(false, std::memory_order_release);
+        }
+
+        /**
+         * Method you can use to obtain the number of probes awaiting a reply, as of the last tick.  This method is
+         * thread safe.
+         *
+         * \return Returns the number of probes in flight.
+         */
+        inline unsigned long numberProbesInFlight() const {
+            return probesInFlight.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of times a host came due while its previous probe was still in
+         * flight.  This method is thread safe.
+         *
+         * \return Returns the number of probe overruns.
+         */
+        inline unsigned long numberProbeOverruns() const {
+            return probeOverruns.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of probes skipped because a host fell a full interval or more
+         * behind its schedule.  This method is thread safe.
+         *
+         * \return Returns the number of skipped probes.
+         */
+        inline unsigned long numberScheduleOverruns() const {
+            return scheduleOverruns.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of ticks that exhausted the burst budget and deferred probes to a
+         * later tick.  This method is thread safe.
+         *
+         * \return Returns the number of ticks that exhausted the burst budget.
+         */
+        inline unsigned long numberBudgetExhausted() const {
+            return budgetExhausted.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the largest delay between a probe's due time and the time it was sent during
+         * the last tick that sent probes.  This method is thread safe.
+         *
+         * \return Returns the send lag, in microseconds.
+         */
+        inline unsigned long lastSendLag() const {
+            return sendLag.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the largest delay between a probe's due time and the time it was sent.  This
+         * method is thread safe.
+         *
+         * \return Returns the worst send lag, in microseconds.
+         */
+        inline unsigned long worstSendLag() const {
+            return worstLag.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of echo requests sent.  This method is thread safe.
+         *
+         * \return Returns the number of echo requests sent.
+         */
+        inline unsigned long numberProbesSent() const {
+            return probesSent.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of echo replies matched to a request.  This method is thread safe.
+         *
+         * \return Returns the number of matched echo replies.
+         */
+        inline unsigned long numberRepliesReceived() const {
+            return repliesReceived.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of probes that expired without a reply.  This method is thread
+         * safe.
+         *
+         * \return Returns the number of expired probes.
+         */
+        inline unsigned long numberProbesExpired() const {
+            return probesExpired.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the total time probes spent awaiting an outcome, whether answered or expired.
+         * Divide by the sum of \ref PingEngine::numberRepliesReceived and \ref PingEngine::numberProbesExpired for
+         * the mean.  This method is thread safe.
+         *
+         * \return Returns the total time, in microseconds.
+         */
+        inline unsigned long long totalResolveTime() const {
+            return resolveTime.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the total time expired probes waited before being declared lost.  Divide by
+         * \ref PingEngine::numberProbesExpired for the mean.  This method is thread safe.
+         *
+         * \return Returns the total time, in microseconds.
+         */
+        inline unsigned long long totalExpiryTime() const {
+            return expiryTime.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of probes that were not sent because hosts had backed off.  Each
+         * probe sent at a backed off interval counts the probes the pool's interval would have sent in its place.
+         * This method is thread safe.
+         *
+         * \return Returns the number of probes saved.
+         */
+        inline unsigned long numberProbesSaved() const {
+            return probesSaved.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the CPU time consumed by the engine's thread, as of the last tick.  This
+         * method is thread safe.
+         *
+         * \return Returns the CPU time, in milliseconds.
+         */
+        inline unsigned long cpuTime() const {
+            return threadCpuTime.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Method you can use to obtain the number of socket system calls issued to send and receive packets.  This
+         * method is thread safe.
+         *
+         * \return Returns the number of socket system calls.
+         */
+        inline unsigned long numberSystemCalls() const {
+            return systemCalls.load(std::memory_order_relaxed);
+        }
+
+    public slots:
+        /**
+         * Slot that must be triggered from the engine's thread before the engine is used.
+         */
+        void initialize();
+
+        /**
+         * Slot you can trigger to add a host to the engine.
+         *
+         * \param[in] hostId  The ID of the host to be added.
+         *
+         * \param[in] context An opaque value returned with each result for this host.
+         *
+         * \param[in] pool    The pool to place the host into.
+         *
+         * \param[in] address The address of the host.
+         */
+        void addHost(unsigned long hostId, std::uint64_t context, PingEngine::Pool pool, const HostAddress& address);
+
+        /**
+         * Slot you can trigger to remove a host from the engine.
+         *
+         * \param[in] hostId The ID of the host to be removed.
+         */
+        void removeHost(unsigned long hostId);
+
+        /**
+         * Slot you can trigger to move a host to a different pool.
+         *
+         * \param[in] hostId The ID of the host to be moved.
+         *
+         * \param[in] pool   The new pool for the host.
+         */
+        void moveHost(unsigned long hostId, PingEngine::Pool pool);
+
+        /**
+         * Slot you can trigger to add many hosts to the engine at once.
+         *
+         * \param[in] pool    The pool to place the hosts into.
+         *
+         * \param[in] entries The hosts to be added.
+         */
+        void addHosts(PingEngine::Pool pool, const QVector<PingEngine::HostEntry>& entries);
+
+        /**
+         * Slot you can trigger to remove many hosts from the engine at once.  Unknown hosts are ignored.
+         *
+         * \param[in] hostIds The IDs of the hosts to be removed.
+         */
+        void removeHosts(const QVector<unsigned long>& hostIds);
+
+        /**
+         * Slot you can trigger to move many hosts to a different pool at once.  Unknown hosts are ignored.
+         *
+         * \param[in] hostIds The IDs of the hosts to be moved.
+         *
+         * \param[in] pool    The new pool for the hosts.
+         */
+        void moveHosts(const QVector<unsigned long>& hostIds, PingEngine::Pool pool);
+
+        /**
+         * Slot you can trigger to change the address of a host.  The host remains in its current pool.  A reply to a
+         * request already sent to the old address will be ignored.
+         *
+         * \param[in] hostId  The ID of the host to be updated.
+         *
+         * \param[in] address The new address of the host.
+         */
+        void updateHostAddress(unsigned long hostId, const HostAddress& address);
+
+        /**
+         * Slot you can trigger to start pinging a pool.  Every host in the pool is probed once per interval at a
+         * phase derived from its ID.  Hosts in the active pool with their own interval keep that interval.
+         *
+         * \param[in] pool                 The pool to be pinged.
+         *
+         * \param[in] intervalMilliseconds The default interval between probes to each host, in milliseconds.
+         *
+         * \param[in] timeoutMilliseconds  The maximum time to wait for each reply, in milliseconds.  Hosts with a
+         *                                 shorter interval wait at most 80% of their interval.  Hosts with measured
+         *                                 round trip times normally wait far less.
+         */
+        void schedulePool(
+            PingEngine::Pool pool,
+            unsigned long    intervalMilliseconds,
+            unsigned long    timeoutMilliseconds
+        );
+
+        /**
+         * Slot you can trigger to give a host its own probe interval.  The interval only applies while the host is in
+         * the active pool.  Hosts in other pools use the pool's interval.
+         *
+         * \param[in] hostId               The ID of the host to be updated.
+         *
+         * \param[in] intervalMilliseconds The new interval, in milliseconds.  A value of 0 restores the pool's
+         *                                 interval.
+         */
+        void setHostInterval(unsigned long hostId, unsigned long intervalMilliseconds);
+
+        /**
+         * Slot you can trigger to set the number of packets submitted or reaped per system call.  A value of 1 selects
+         * the per-packet sendto/recvfrom path.  Larger values use sendmmsg/recvmmsg.
+         *
+         * \param[in] newBatchSize The new batch size.  Values are clamped to \ref PingEngine::maximumBatchSize.
+         */
+        void setBatchSize(unsigned newBatchSize);
+
+        /**
+         * Slot you can trigger to set the maximum number of probes sent per tick.  Probes beyond the budget are
+         * deferred to the next tick.
+         *
+         * \param[in] newBurstBudget The new burst budget.  A value of 0 removes the limit.
+         */
+        void setBurstBudget(unsigned newBurstBudget);
+
+        /**
+         * Slot you can trigger to bound the time each probe waits for a reply.  Every host's timeout is derived from
+         * its smoothed round trip time and round trip time variance, as described in RFC 6298, and then clamped to
+         * these limits.  A host with no measurements waits the full pool timeout.
+         *
+         * \param[in] minimumMilliseconds The shortest time to wait for a reply, in milliseconds.
+         *
+         * \param[in] maximumMilliseconds The longest time to wait for a reply, in milliseconds.  A value of 0 leaves
+         *                                only the pool timeout in effect.
+         */
+        void setTimeoutLimits(unsigned long minimumMilliseconds, unsigned long maximumMilliseconds);
+
+        /**
+         * Slot you can trigger to configure confirmation probing.  When a host in the active pool misses its first
+         * reply it is re-probed at once, and then at the given spacing, outside its regular schedule.  Regular probes
+         * falling due while the host is being confirmed are skipped.  Confirmation ends early on the first reply.
+         *
+         * \param[in] numberProbes        The number of confirmation probes.  A value of 0 disables confirmation.
+         *
+         * \param[in] spacingMilliseconds The minimum spacing between confirmation probes, in milliseconds.  Each
+         *                                confirmation probe waits for the previous reply or timeout.
+         */
+        void setConfirmation(unsigned numberProbes, unsigned long spacingMilliseconds);
+
+        /**
+         * Slot you can trigger to send several probes to each active host per cycle.  The first probe is sent when the
+         * host comes due and the rest follow at the given spacing.  Every probe is reported, and the last one also
+         * reports how many of the cycle's probes were answered.  Each probe gets the host's full timeout, so a probe
+         * is only sent once the previous one has been answered or has timed out.
+         *
+         * \param[in] probesPerCycle      The number of probes per cycle.  Values are clamped between 1 and
+         *                                \ref PingEngine::maximumBurstProbes.
+         *
+         * \param[in] spacingMilliseconds The minimum spacing between the probes of a cycle, in milliseconds.
+         */
+        void setBurst(unsigned probesPerCycle, unsigned long spacingMilliseconds);
+
+        /**
+         * Slot you can trigger to let the hosts in a pool back off.  Every unanswered probe doubles the host's
+         * interval, up to the given limit.  A reply, or moving the host to another pool, restores the pool's
+         * interval.  Rescheduling the pool also restarts every host's back-off.
+         *
+         * \param[in] pool                         The pool to be updated.
+         *
+         * \param[in] maximumIntervalMilliseconds The longest interval a host backs off to, in milliseconds.  A value
+         *                                         of 0 disables back-off.
+         */
+        void setPoolBackoff(PingEngine::Pool pool, unsigned long maximumIntervalMilliseconds);
+
+    private slots:
+        /**
+         * Slot that is triggered periodically to send due probes, expire unanswered probes and report results.
+         */
+        void tick();
+
+        /**
+         * Slot that is triggered when the IPv4 socket has data available.
+         */
+        void ipv4Readable();
+
+        /**
+         * Slot that is triggered when the IPv6 socket has data available.
+         */
+        void ipv6Readable();
+
+    private:
+        /**
+         * Magic value placed into every echo request so that we can ignore replies to other processes.
+         */
+        static constexpr std::uint32_t payloadMagic = 0x53535047;
+
+        /**
+         * The size of the socket send and receive buffers we request, in bytes.  Large buffers let us absorb the reply
+         * burst from a full pool without dropping packets.
+         */
+        static constexpr int socketBufferSize = 4 * 1024 * 1024;
+
+        /**
+         * The space reserved for each packet in a packet ring, in bytes.  Received packets larger than this are
+         * truncated, which is harmless since we only inspect the headers and our own payload.
+         */
+        static constexpr unsigned packetSlotSize = 256;
+
+        /**
+         * The tick interval, in milliseconds.  This value sets the pacing resolution.
+         */
+        static constexpr unsigned tickInterval = 10;
+
+        /**
+         * The number of bits of the tick count resolved by each level of the timing wheel.
+         */
+        static constexpr unsigned wheelBits = 8;
+
+        /**
+         * The number of slots in each level of the timing wheel.
+         */
+        static constexpr unsigned wheelSlots = 1U << wheelBits;
+
+        /**
+         * Value used to terminate the host lists held by the timing wheel.
+         */
+        static constexpr unsigned noHost = static_cast<unsigned>(-1);
+
+        /**
+         * The number of levels in the timing wheel.  With a 10 mSec tick the wheel spans more than a year.
+         */
+        static constexpr unsigned wheelLevels = 4;
+
+        /**
+         * The largest number of times a host's timeout is doubled after consecutive losses.
+         */
+        static constexpr unsigned maximumBackoff = 6;
+
+        /**
+         * Trivial class holding the payload carried by each echo request.
+         */
+        class Payload {
+            public:
+                /**
+                 * The magic value, always \ref PingEngine::payloadMagic.
+                 */
+                std::uint32_t magic;
+
+                /**
+                 * The probe token the request was sent under.
+                 */
+                std::uint32_t token;
+
+                /**
+                 * The ID of the host the request was sent to.
+                 */
+                std::uint64_t hostId;
+        };
+
+        /**
+         * Trivial class holding the engine's view of a single host.
+         */
+        class Host {
+            public:
+                /**
+                 * The ID of the host.
+                 */
+                unsigned long hostId;
+
+                /**
+                 * The index of this host within the host table.
+                 */
+                unsigned handle;
+
+                /**
+                 * The host address.
+                 */
+                HostAddress address;
+
+                /**
+                 * The context returned with each result for this host.
+                 */
+                std::uint64_t context;
+
+                /**
+                 * The pool holding this host.
+                 */
+                Pool pool;
+
+                /**
+                 * The interval between probes, in microseconds.  A value of 0 indicates the host is not probed.
+                 */
+                std::int64_t interval;
+
+                /**
+                 * The interval requested for this host, in microseconds.  A value of 0 indicates the pool's interval
+                 * is used.
+                 */
+                std::int64_t customInterval;
+
+                /**
+                 * The maximum time to wait for a reply, in microseconds.
+                 */
+                std::int64_t timeout;
+
+                /**
+                 * The smoothed round trip time, in microseconds.  A negative value indicates no reply has been
+                 * measured yet.
+                 */
+                std::int64_t smoothedRtt;
+
+                /**
+                 * The round trip time variance, in microseconds.
+                 */
+                std::int64_t rttVariance;
+
+                /**
+                 * The number of times the timeout has been doubled since the last reply.
+                 */
+                unsigned backoff;
+
+                /**
+                 * The number of confirmation probes still to be sent.
+                 */
+                unsigned confirmRemaining;
+
+                /**
+                 * The time the next confirmation probe is due, in microseconds.
+                 */
+                std::int64_t confirmAt;
+
+                /**
+                 * Flag indicating the probe in flight is a confirmation probe.
+                 */
+                bool confirmation;
+
+                /**
+                 * The time the first probe of the current run of unanswered probes was sent, in microseconds.  A value
+                 * of 0 indicates the last probe was answered.
+                 */
+                std::int64_t lossStartedAt;
+
+                /**
+                 * The number of probes of the current cycle still to be sent.
+                 */
+                unsigned burstRemaining;
+
+                /**
+                 * The time the next probe of the current cycle is due, in microseconds.
+                 */
+                std::int64_t burstAt;
+
+                /**
+                 * The number of probes sent in the current cycle.
+                 */
+                unsigned cycleSent;
+
+                /**
+                 * The number of probes answered in the current cycle.
+                 */
+                unsigned cycleReplies;
+
+                /**
+                 * The time the first probe of the current cycle was sent, in microseconds.
+                 */
+                std::int64_t cycleStartedAt;
+
+                /**
+                 * The time the next probe is due, in microseconds.
+                 */
+                std::int64_t dueAt;
+
+                /**
+                 * The time the probe in flight expires, in microseconds.
+                 */
+                std::int64_t deadline;
+
+                /**
+                 * The tick at which the timing wheel will next service this host.
+                 */
+                std::int64_t wheelTick;
+
+                /**
+                 * The timing wheel level holding this host.  A value of \ref PingEngine::wheelLevels indicates the host
+                 * is not in the wheel.
+                 */
+                unsigned wheelLevel;
+
+                /**
+                 * The timing wheel slot holding this host.
+                 */
+                unsigned wheelSlot;
+
+                /**
+                 * The next host in the same timing wheel slot.  A value of \ref PingEngine::noHost ends the list.
+                 */
+                unsigned wheelNext;
+
+                /**
+                 * The previous host in the same timing wheel slot.  A value of \ref PingEngine::noHost indicates this
+                 * host is at the head of the list.
+                 */
+                unsigned wheelPrevious;
+
+                /**
+                 * The token of the probe in flight.  A value of 0 indicates no probe is in flight.
+                 */
+                std::uint32_t token;
+
+                /**
+                 * The time the last echo request was sent, in microseconds.
+                 */
+                std::int64_t sentAt;
+
+                /**
+                 * The latency measured by the last completed probe, in milliseconds.  A negative value indicates no
+                 * reply.
+                 */
+                double latency;
+        };
+
+        /**
+         * Trivial class holding the state of a single pool.
+         */
+        class PoolState {
+            public:
+                /**
+                 * The number of hosts in this pool.
+                 */
+                unsigned long numberMembers;
+
+                /**
+                 * The default interval between probes to each host, in microseconds.  A value of 0 indicates the
+                 * pool is not being pinged.
+                 */
+                std::int64_t interval;
+
+                /**
+                 * The maximum time to wait for a reply, in microseconds.
+                 */
+                std::int64_t timeout;
+
+                /**
+                 * The longest interval a host backs off to, in microseconds.  Values no larger than the interval
+                 * disable back-off.
+                 */
+                std::int64_t maximumInterval;
+
+                /**
+                 * The result buffers.  One buffer collects results while the other is held by the receiver.  The
+                 * buffers are never copied or shared, so clearing a released buffer keeps its storage.
+                 */
+                QVector<Result> results[2];
+
+                /**
+                 * The index of the buffer collecting results.
+                 */
+                unsigned fillBuffer;
+
+                /**
+                 * The index of the buffer handed to the receiver.  Written before \ref PoolState::reportPending is set.
+                 */
+                unsigned reportedBuffer;
+
+                /**
+                 * Flag set while the receiver holds the other buffer.  Cleared from the receiving thread by
+                 * \ref PingEngine::releaseResults.
+                 */
+                std::atomic<bool> reportPending;
+        };
+
+        /**
+         * Trivial class holding a preallocated ring of packet buffers used for batched system calls.
+         */
+        class PacketRing {
+            public:
+                /**
+                 * The packet buffers.
+                 */
+                std::uint8_t packets[maximumBatchSize][packetSlotSize];
+
+                /**
+                 * The peer addresses.
+                 */
+                struct sockaddr_storage addresses[maximumBatchSize];
+
+                /**
+                 * The I/O vectors, one per packet.
+                 */
+                struct iovec vectors[maximumBatchSize];
+
+                /**
+                 * The message headers, one per packet.
+                 */
+                struct mmsghdr messages[maximumBatchSize];
+
+                /**
+                 * The number of packets queued in the ring.
+                 */
+                unsigned count;
+        };
+
+        /**
+         * Method that adds a host to the host table.  Any existing host with the same ID is replaced.
+         *
+         * \param[in] hostId      The ID of the host to be added.
+         *
+         * \param[in] context     An opaque value returned with each result for this host.
+         *
+         * \param[in] pool        The pool to place the host into.
+         *
+         * \param[in] address     The address of the host.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         */
+        void insertHost(
+            unsigned long      hostId,
+            std::uint64_t      context,
+            Pool               pool,
+            const HostAddress& address,
+            std::int64_t       currentTime
+        );
+
+        /**
+         * Method that locates a host in the host table.
+         *
+         * \param[in] hostId The ID of the host.
+         *
+         * \return Returns a pointer to the host.  A null pointer is returned if the host is unknown.
+         */
+        Host* findHost(unsigned long hostId);
+
+        /**
+         * Method that removes a host from the host table.
+         *
+         * \param[in] hostId The ID of the host to be removed.
+         *
+         * \return Returns true if the host was removed.  Returns false if the host is unknown.
+         */
+        bool eraseHost(unsigned long hostId);
+
+        /**
+         * Method that publishes the host count and host table memory usage after hosts are added or removed.
+         */
+        void publishHostCount();
+
+        /**
+         * Method that moves a host to a different pool.
+         *
+         * \param[in] hostId      The ID of the host to be moved.
+         *
+         * \param[in] pool        The new pool for the host.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         *
+         * \return Returns true if the host was moved.  Returns false if the host is unknown or already in the pool.
+         */
+        bool relocateHost(unsigned long hostId, Pool pool, std::int64_t currentTime);
+
+        /**
+         * Method that places a host into a pool.
+         *
+         * \param[in] hostId      The ID of the host.
+         *
+         * \param[in] host        The host to be placed.
+         *
+         * \param[in] pool        The pool to receive the host.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         */
+        void insertIntoPool(unsigned long hostId, Host& host, Pool pool, std::int64_t currentTime);
+
+        /**
+         * Method that removes a host from its pool.  Any probe in flight is abandoned.
+         *
+         * \param[in] host The host to be removed.
+         */
+        void removeFromPool(Host& host);
+
+        /**
+         * Method that calculates the interval a host is probed at before any back-off.
+         *
+         * \param[in] host The host.
+         *
+         * \return Returns the interval, in microseconds.  A value of 0 indicates the host is not probed.
+         */
+        std::int64_t baseInterval(const Host& host) const;
+
+        /**
+         * Method that recalculates a host's interval and timeout and reschedules its next probe.
+         *
+         * \param[in] hostId      The ID of the host.
+         *
+         * \param[in] host        The host to be rescheduled.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         */
+        void updateSchedule(unsigned long hostId, Host& host, std::int64_t currentTime);
+
+        /**
+         * Method that calculates the first time at or after a given time that falls on a host's phase.  The phase is
+         * derived from a hash of the host ID so that hosts sharing an interval are spread evenly across it.
+         *
+         * \param[in] hostId      The ID of the host.
+         *
+         * \param[in] interval    The host's interval, in microseconds.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         *
+         * \return Returns the due time, in microseconds.
+         */
+        std::int64_t phaseTime(unsigned long hostId, std::int64_t interval, std::int64_t currentTime) const;
+
+        /**
+         * Method that places a host into the timing wheel at its next probe deadline or due time, whichever comes
+         * first.  Hosts with nothing to do are left out of the wheel.
+         *
+         * \param[in] host The host to be scheduled.  The host must not already be in the wheel.
+         */
+        void scheduleHost(Host& host);
+
+        /**
+         * Method that places a host into the timing wheel slot for a given tick.
+         *
+         * \param[in] host       The host to be placed.
+         *
+         * \param[in] targetTick The tick at which the host should be serviced.  Ticks already passed are serviced on
+         *                       the next tick.
+         */
+        void insertIntoWheel(Host& host, std::int64_t targetTick);
+
+        /**
+         * Method that removes a host from the timing wheel.  Hosts not in the wheel are ignored.
+         *
+         * \param[in] host The host to be removed.
+         */
+        void removeFromWheel(Host& host);
+
+        /**
+         * Method that moves the hosts in the current slot of an upper wheel level down to the lower levels.
+         *
+         * \param[in] level The level to be cascaded.
+         *
+         * \return Returns the index of the slot that was cascaded.
+         */
+        unsigned cascade(unsigned level);
+
+        /**
+         * Method that advances the timing wheel to the current time, servicing every host that has come due.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         *
+         * \param[in] budget      The number of probes we may still send this tick.  Updated by this method.
+         *
+         * \return Returns true if the budget was exhausted before every due host was serviced.
+         */
+        bool advanceWheel(std::int64_t currentTime, unsigned long& budget);
+
+        /**
+         * Method that services a single host taken from the timing wheel.  Expired probes are reported, a probe is
+         * sent if the host is due and the host is returned to the wheel.
+         *
+         * \param[in] hostId      The ID of the host.
+         *
+         * \param[in] host        The host to be serviced.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         *
+         * \param[in] budget      The number of probes we may still send this tick.  Updated by this method.
+         *
+         * \return Returns true if the host was serviced.  Returns false if the host was due but the budget was
+         *         exhausted.
+         */
+        bool serviceHost(unsigned long hostId, Host& host, std::int64_t currentTime, unsigned long& budget);
+
+        /**
+         * Method that sends a probe to a single host.
+         *
+         * \param[in] hostId      The ID of the host to be probed.
+         *
+         * \param[in] host        The host to be probed.
+         *
+         * \param[in] currentTime The current time, in microseconds.
+         *
+         * \param[in] timeout     The time to wait for a reply, in microseconds.
+         */
+        void sendProbe(unsigned long hostId, Host& host, std::int64_t currentTime, std::int64_t timeout);
+
+        /**
+         * Method that calculates how long the next probe to a host should wait for a reply.
+         *
+         * \param[in] host The host to be probed.
+         *
+         * \return Returns the timeout, in microseconds.
+         */
+        std::int64_t probeTimeout(const Host& host) const;
+
+        /**
+         * Method that completes the probe in flight for a host, updates the host's round trip time estimates and
+         * queues its result.
+         *
+         * \param[in] hostId      The ID of the host.
+         *
+         * \param[in] host        The host.
+         *
+         * \param[in] completedAt The time the reply arrived or the probe was given up on, in microseconds.
+         *
+         * \param[in] answered    If true, the host replied.  If false, the probe is reported as lost.
+         */
+        void completeProbe(unsigned long hostId, Host& host, std::int64_t completedAt, bool answered);
+
+        /**
+         * Method that sends a single echo request.
+         *
+         * \param[in] hostId The ID of the host to be pinged.
+         *
+         * \param[in] host   The host to be pinged.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool sendEchoRequest(unsigned long hostId, const Host& host);
+
+        /**
+         * Method that builds an echo request and queues it in the transmit ring for the host's address family.  The
+         * ring is flushed when it fills.
+         *
+         * \param[in] hostId The ID of the host to be pinged.
+         *
+         * \param[in] host   The host to be pinged.
+         *
+         * \return Returns the number of packets sent if the ring was flushed.
+         */
+        unsigned queueEchoRequest(unsigned long hostId, const Host& host);
+
+        /**
+         * Method that sends every packet queued in a transmit ring.
+         *
+         * \param[in] ring             The ring to be flushed.
+         *
+         * \param[in] socketDescriptor The socket to send the packets on.
+         *
+         * \return Returns the number of packets sent.
+         */
+        unsigned flushRing(PacketRing& ring, int socketDescriptor);
+
+        /**
+         * Method that builds an echo request.
+         *
+         * \param[in]  hostId The ID of the host to be pinged.
+         *
+         * \param[in]  host   The host to be pinged.
+         *
+         * \param[out] packet The buffer to receive the packet.  Must hold at least \ref PingEngine::packetSlotSize
+         *                    bytes.
+         *
+         * \return Returns the packet length, in bytes.
+         */
+        unsigned buildEchoRequest(unsigned long hostId, const Host& host, std::uint8_t* packet);
+
+        /**
+         * Method that drains a socket one packet at a time.
+         *
+         * \param[in] socketDescriptor The socket to be drained.
+         *
+         * \param[in] family           The address family of the socket.
+         */
+        void receivePackets(int socketDescriptor, int family);
+
+        /**
+         * Method that drains a socket in batches.
+         *
+         * \param[in] socketDescriptor The socket to be drained.
+         *
+         * \param[in] family           The address family of the socket.
+         */
+        void receiveBatches(int socketDescriptor, int family);
+
+        /**
+         * Method that processes a single received packet.
+         *
+         * \param[in] packet     The received packet.
+         *
+         * \param[in] length     The packet length, in bytes.
+         *
+         * \param[in] family     The address family of the socket that received the packet.
+         *
+         * \param[in] source     The address the packet was received from.
+         *
+         * \param[in] receivedAt The time the packet was received, in microseconds.
+         */
+        void processPacket(
+            const std::uint8_t*    packet,
+            unsigned               length,
+            int                    family,
+            const struct sockaddr* source,
+            std::int64_t           receivedAt
+        );
+
+        /**
+         * Method that processes a received echo reply.
+         *
+         * \param[in] payload    The payload carried by the reply.
+         *
+         * \param[in] length     The payload length, in bytes.
+         *
+         * \param[in] source     The address the reply was received from.
+         *
+         * \param[in] receivedAt The time the reply was received, in microseconds.
+         */
+        void processEchoReply(
+            const std::uint8_t*    payload,
+            unsigned               length,
+            const struct sockaddr* source,
+            std::int64_t           receivedAt
+        );
+
+        /**
+         * Method that opens a raw ICMP socket.
+         *
+         * \param[in] family   The address family, AF_INET or AF_INET6.
+         *
+         * \param[in] protocol The protocol, IPPROTO_ICMP or IPPROTO_ICMPV6.
+         *
+         * \return Returns the socket descriptor.  A negative value is returned on error.
+         */
+        int openSocket(int family, int protocol);
+
+        /**
+         * Method that attaches a socket filter that drops everything other than echo replies carrying our identifier.
+         * Raw ICMP sockets receive a copy of every ICMP message so the filter keeps the per-shard receive cost
+         * proportional to the shard's own traffic.
+         *
+         * \param[in] socketDescriptor The socket to receive the filter.
+         *
+         * \param[in] family           The address family, AF_INET or AF_INET6.
+         */
+        void attachFilter(int socketDescriptor, int family);
+
+        /**
+         * Method that obtains the current monotonic time.
+         *
+         * \return Returns the current time in microseconds.
+         */
+        static std::int64_t now();
+
+        /**
+         * Method that obtains the CPU time consumed by the calling thread.
+         *
+         * \return Returns the CPU time in microseconds.
+         */
+        static std::int64_t threadTime();
+
+        /**
+         * Method that calculates an internet checksum.
+         *
+         * \param[in] data   The data to be checksummed.
+         *
+         * \param[in] length The length of the data, in bytes.
+         *
+         * \return Returns the checksum, in network byte order.
+         */
+        static std::uint16_t checksum(const std::uint8_t* data, unsigned length);
+
+        /**
+         * The IPv4 socket descriptor.
+         */
+        int ipv4Socket;
+
+        /**
+         * The IPv6 socket descriptor.
+         */
+        int ipv6Socket;
+
+        /**
+         * Notifier for the IPv4 socket.
+         */
+        QSocketNotifier* ipv4Notifier;
+
+        /**
+         * Notifier for the IPv6 socket.
+         */
+        QSocketNotifier* ipv6Notifier;
+
+        /**
+         * Timer used to trigger ticks.
+         */
+        QTimer* tickTimer;
+
+        /**
+         * The last reported socket error.
+         */
+        QString lastError;
+
+        /**
+         * The index of the shard served by this engine.
+         */
+        unsigned shard;
+
+        /**
+         * The ICMP identifier placed into every echo request.
+         */
+        std::uint16_t identifier;
+
+        /**
+         * The token to assign to the next probe.
+         */
+        std::uint32_t nextToken;
+
+        /**
+         * The number of packets submitted or reaped per system call.
+         */
+        unsigned batchSize;
+
+        /**
+         * The maximum number of probes sent per tick.  A value of 0 indicates no limit.
+         */
+        unsigned burstBudget;
+
+        /**
+         * The shortest time to wait for a reply, in microseconds.
+         */
+        std::int64_t minimumTimeout;
+
+        /**
+         * The longest time to wait for a reply, in microseconds.  A value of 0 indicates no limit beyond the pool
+         * timeout.
+         */
+        std::int64_t maximumTimeout;
+
+        /**
+         * The number of confirmation probes sent after an active host first misses a reply.
+         */
+        unsigned confirmProbes;
+
+        /**
+         * The spacing between confirmation probes, in microseconds.
+         */
+        std::int64_t confirmSpacing;
+
+        /**
+         * The number of probes sent to each active host per cycle.
+         */
+        unsigned burstProbes;
+
+        /**
+         * The spacing between the probes of a cycle, in microseconds.
+         */
+        std::int64_t burstSpacing;
+
+        /**
+         * The number of probes awaiting a reply.
+         */
+        unsigned long inFlight;
+
+        /**
+         * Transmit ring for IPv4 echo requests.
+         */
+        PacketRing ipv4TransmitRing;
+
+        /**
+         * Transmit ring for IPv6 echo requests.
+         */
+        PacketRing ipv6TransmitRing;
+
+        /**
+         * Receive ring shared by both sockets.
+         */
+        PacketRing receiveRing;
+
+        /**
+         * The host table.  Entries are addressed by handle and reused once released.
+         */
+        QVector<Host> hosts;
+
+        /**
+         * Released host table entries available for reuse.
+         */
+        QVector<unsigned> freeHosts;
+
+        /**
+         * Index from host ID to host table entry.
+         */
+        QHash<unsigned long, unsigned> hostIndex;
+
+        /**
+         * The pool states.
+         */
+        PoolState pools[static_cast<unsigned>(Pool::NUMBER_POOLS)];
+
+        /**
+         * The timing wheel, indexed by level and slot.  Each slot holds the head of a list linked through the hosts
+         * so that hosts move between slots without allocating.
+         */
+        unsigned wheel[wheelLevels][wheelSlots];
+
+        /**
+         * The time corresponding to tick 0 of the timing wheel, in microseconds.
+         */
+        std::int64_t wheelEpoch;
+
+        /**
+         * The next tick to be serviced by the timing wheel.
+         */
+        std::int64_t wheelTick;
+
+        /**
+         * The largest send lag measured during the current tick, in microseconds.
+         */
+        std::int64_t tickLag;
+
+        /**
+         * Counter of host add operations.
+         */
+        std::atomic<unsigned long> hostAdds;
+
+        /**
+         * Counter of host remove operations.
+         */
+        std::atomic<unsigned long> hostRemoves;
+
+        /**
+         * Counter of host move operations.
+         */
+        std::atomic<unsigned long> hostMoves;
+
+        /**
+         * The number of hosts held by the engine.
+         */
+        std::atomic<unsigned long> hostCount;
+
+        /**
+         * The approximate memory held by the host records and the host ID index, in bytes.
+         */
+        std::atomic<unsigned long> hostMemory;
+
+        /**
+         * The number of probes awaiting a reply, as of the last tick.
+         */
+        std::atomic<unsigned long> probesInFlight;
+
+        /**
+         * Counter of hosts that came due while their previous probe was still in flight.
+         */
+        std::atomic<unsigned long> probeOverruns;
+
+        /**
+         * Counter of probes skipped because a host fell a full interval or more behind.
+         */
+        std::atomic<unsigned long> scheduleOverruns;
+
+        /**
+         * Counter of ticks that exhausted the burst budget.
+         */
+        std::atomic<unsigned long> budgetExhausted;
+
+        /**
+         * The largest send lag measured during the last tick that sent probes, in microseconds.
+         */
+        std::atomic<unsigned long> sendLag;
+
+        /**
+         * The largest send lag measured, in microseconds.
+         */
+        std::atomic<unsigned long> worstLag;
+
+        /**
+         * Counter of echo requests sent.
+         */
+        std::atomic<unsigned long> probesSent;
+
+        /**
+         * Counter of echo replies matched to a request.
+         */
+        std::atomic<unsigned long> repliesReceived;
+
+        /**
+         * Counter of probes that expired without a reply.
+         */
+        std::atomic<unsigned long> probesExpired;
+
+        /**
+         * Total time probes spent awaiting an outcome, in microseconds.
+         */
+        std::atomic<unsigned long long> resolveTime;
+
+        /**
+         * Total time expired probes waited before being declared lost, in microseconds.
+         */
+        std::atomic<unsigned long long> expiryTime;
+
+        /**
+         * Counter of probes not sent because hosts had backed off.
+         */
+        std::atomic<unsigned long> probesSaved;
+
+        /**
+         * The CPU time consumed by the engine's thread, in milliseconds.
+         */
+        std::atomic<unsigned long> threadCpuTime;
+
+        /**
+         * Counter of socket system calls.
+         */
+        std::atomic<unsigned long> systemCalls;
+};
+
+Q_DECLARE_METATYPE(PingEngine::Pool)
+Q_DECLARE_METATYPE(PingEngine::Result)
+Q_DECLARE_METATYPE(PingEngine::HostEntry)
+
+#endif
@@ -26,18 +26,29 @@
 #include <QCoreApplication>
 #include <QObject>
 #include <QString>
+#include <QByteArray>
 #include <QSet>
 #include <QSharedMemory>
 #include <QSystemSemaphore>
 #include <QHash>
+#include <QVector>
+#include <QList>
+#include <QElapsedTimer>
 
-#include <oping.h>
+#include <cstdint>
 
 #include "server_data.h"
+#include "host_table.h"
+#include "event_log.h"
+#include "status_table.h"
+#include "host_address.h"
+#include "ping_engine.h"
 
 class QLocalServer;
 class QTimer;
+class QThread;
 class Connection;
+class ResolverCache;
 
 /**
  * The pinger server application class.
@@ -48,12 +59,36 @@ class Pinger:public QObject {
     Q_OBJECT
 
     public:
+        /**
+         * The default number of consecutive missed replies before a server is flagged.
+         */
+        static constexpr unsigned defaultLossThreshold = 4;
+
+        /**
+         * The largest supported number of consecutive missed replies before a server is flagged.  Each miss short of
+         * the threshold is tracked by one of the inactive server states.
+         */
+        static constexpr unsigned maximumLossThreshold = 5;
+
+        /**
+         * The default loss, as a percentage of a cycle's probes, at which the cycle counts as a missed reply.
+         */
+        static constexpr unsigned defaultCycleLossLimit = 100;
+
+        /**
+         * The default interval used to probe flagged servers, in milliseconds.  Value is the closest prime value above
+         * 15 seconds.
+         */
+        static constexpr unsigned defaultFlaggedPingInterval = 15013;
+
         /**
          * Constructor
          *
-         * \param[in] parent Pointer to the parent object.
+         * \param[in] numberShards The number of ping engine shards to run.  Each shard runs in its own thread.
+         *
+         * \param[in] parent       Pointer to the parent object.
          */
-        Pinger(QObject* parent = nullptr);
+        Pinger(unsigned numberShards = 1, QObject* parent = nullptr);
 
         ~Pinger() override;
 
@@ -73,6 +108,119 @@ class Pinger:public QObject {
          */
         QString errorString() const;
 
+        /**
+         * Method you can use to publish server status into a shared memory table that other processes can map.
+         *
+         * \param[in] name     The shared memory object name.
+         *
+         * \param[in] capacity The maximum number of servers in the table.  Servers beyond this limit are not published.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool openStatusTable(const QString& name, unsigned capacity = StatusTable::defaultCapacity);
+
+        /**
+         * Method you can use to set the maximum number of host name lookups performed concurrently.
+         *
+         * \param[in] newMaximumLookups The new maximum number of concurrent lookups.
+         */
+        void setMaximumLookups(unsigned newMaximumLookups);
+
+        /**
+         * Method you can use to set the number of packets each ping engine shard submits or reaps per system call.
+         *
+         * \param[in] newBatchSize The new batch size.  A value of 1 selects the per-packet path.
+         */
+        void setBatchSize(unsigned newBatchSize);
+
+        /**
+         * Method you can use to set the maximum number of probes each ping engine shard sends per pacing tick.
+         *
+         * \param[in] newBurstBudget The new burst budget.  A value of 0 removes the limit.
+         */
+        void setBurstBudget(unsigned newBurstBudget);
+
+        /**
+         * Method you can use to bound the time each probe waits for a reply.  Within these limits every server's
+         * timeout follows its own measured round trip times.
+         *
+         * \param[in] minimumMilliseconds The shortest time to wait for a reply, in milliseconds.
+         *
+         * \param[in] maximumMilliseconds The longest time to wait for a reply, in milliseconds.  A value of 0 leaves
+         *                                the default of 80% of the probe interval.
+         */
+        void setTimeoutLimits(unsigned long minimumMilliseconds, unsigned long maximumMilliseconds);
+
+        /**
+         * Method you can use to configure how quickly a silent server is confirmed as down.  After its first missed
+         * reply an active server is re-probed at once and then at the given spacing, outside its regular schedule.
+         *
+         * \param[in] numberProbes        The number of confirmation probes.  A value of 0 disables confirmation.
+         *
+         * \param[in] spacingMilliseconds The spacing between confirmation probes, in milliseconds.
+         */
+        void setConfirmation(unsigned numberProbes, unsigned long spacingMilliseconds);
+
+        /**
+         * Method you can use to send several probes to each active server per cycle so that loss and jitter can be
+         * measured.
+         *
+         * \param[in] probesPerCycle      The number of probes per cycle.  A value of 1 sends a single probe.
+         *
+         * \param[in] spacingMilliseconds The spacing between the probes of a cycle, in milliseconds.
+         */
+        void setBurst(unsigned probesPerCycle, unsigned long spacingMilliseconds);
+
+        /**
+         * Method you can use to set the loss at which a cycle counts as a missed reply.  Cycles with less loss count
+         * as answered.
+         *
+         * \param[in] newCycleLossLimit The new limit, as a percentage of the cycle's probes.  Values are clamped
+         *                              between 1 and 100.
+         */
+        void setCycleLossLimit(unsigned newCycleLossLimit);
+
+        /**
+         * Method you can use to set the number of consecutive missed replies, confirmation probes included, before a
+         * server is flagged.
+         *
+         * \param[in] newLossThreshold The new loss threshold.  Values are clamped between 1 and
+         *                             \ref Pinger::maximumLossThreshold.
+         */
+        void setLossThreshold(unsigned newLossThreshold);
+
+        /**
+         * Method you can use to set how often flagged servers are probed.  Flagged servers are held apart from the
+         * active servers so that a large outage does not slow down monitoring of the healthy ones.
+         *
+         * \param[in] newInterval The new interval, in milliseconds.
+         */
+        void setFlaggedPingInterval(unsigned long newInterval);
+
+        /**
+         * Method you can use to set the longest interval defunct servers back off to.  Each unanswered probe doubles
+         * a defunct server's interval, starting from the retry interval, until this limit is reached.
+         *
+         * \param[in] newLimit The new limit, in milliseconds.  A value of 0 probes every defunct server at the retry
+         *                     interval.
+         */
+        void setDefunctBackoffLimit(unsigned long newLimit);
+
+        /**
+         * Method you can use to set the number of bytes that may be queued for a client before it is dropped as a
+         * slow consumer.
+         *
+         * \param[in] newOutputLimit The new output limit, in bytes.  A value of 0 removes the limit.
+         */
+        void setOutputLimit(unsigned long newOutputLimit);
+
+        /**
+         * Method you can use to obtain the number of bytes that may be queued for a client before it is dropped.
+         *
+         * \return Returns the output limit, in bytes.  A value of 0 indicates no limit.
+         */
+        unsigned long outputLimit() const;
+
     private slots:
         /**
          * Slot that is triggered whenever a new connection is established.
@@ -83,10 +231,18 @@ class Pinger:public QObject {
          * Slot that is triggered to remove a connection.
          *
          * \param[in] connection The connection to be removed.  The connection will be deleted by this call after
-         *                       processing.
+         *                       processing.  Connections that were already removed are ignored.
          */
         void disconnect(Connection* connection);
 
+        /**
+         * Slot that is triggered when a connection falls too far behind on its output.  The connection is removed
+         * once control returns to the event loop.
+         *
+         * \param[in] connection The connection to be dropped.
+         */
+        void dropSlowConsumer(Connection* connection);
+
         /**
          * Slot that is triggered when a new server is to be added.
          *
@@ -107,6 +263,33 @@ class Pinger:public QObject {
          */
         void removeServer(unsigned long hostId, Connection* connection);
 
+        /**
+         * Slot that is triggered when the resolver cache finds a new address for one or more servers.
+         *
+         * \param[in] hostIds The IDs of the servers to be updated.
+         *
+         * \param[in] address The new address.
+         */
+        void addressChanged(const QList<unsigned long>& hostIds, const HostAddress& address);
+
+        /**
+         * Slot that is triggered when a queued host name lookup completes.
+         *
+         * \param[in] hostId       The ID of the server that requested the lookup.
+         *
+         * \param[in] hostName     The name that was resolved.
+         *
+         * \param[in] address      The resolved address.  A null address indicates the lookup failed.
+         *
+         * \param[in] errorMessage A description of the error, if the lookup failed.
+         */
+        void lookupCompleted(
+            unsigned long      hostId,
+            const QString&     hostName,
+            const HostAddress& address,
+            const QString&     errorMessage
+        );
+
         /**
          * Slot that is added when a server should be marked as defunct for ping operations.
          *
@@ -117,21 +300,238 @@ class Pinger:public QObject {
         void markDefunct(unsigned long hostId, Connection* connection);
 
         /**
-         * Slot that is triggered to perform a single ping on untested servers.
+         * Slot that is triggered to give a server its own probe interval.  The interval applies while the server is
+         * active.
+         *
+         * \param[in] hostId     The ID of the server to be updated.
+         *
+         * \param[in] interval   The new interval, in milliseconds.  A value of 0 restores the default interval.
+         *
+         * \param[in] connection The connection that issued the request.
          */
-        void doUntestedPing();
+        void setServerInterval(unsigned long hostId, unsigned long interval, Connection* connection);
 
         /**
-         * Slot that is triggered to perform a single ping on active servers.
+         * Slot that is triggered periodically to process the results handed over by each ping engine shard.
          */
-        void doActivePing();
+        void collectResults();
 
         /**
-         * Slot that is triggered to perform a single ping of our defunct servers.
+         * Slot that is triggered periodically to measure how quickly this thread services events.
          */
-        void doDefunctPing();
+        void checkResponsiveness();
 
     private:
+        /**
+         * Enumeration of per-item outcomes reported for batch commands.  Each outcome is reported as a single
+         * character.
+         */
+        enum class BatchStatus : char {
+            /**
+             * Indicates the item was applied.
+             */
+            OK = 'O',
+
+            /**
+             * Indicates the server name could not be resolved.
+             */
+            FAILED = 'F',
+
+            /**
+             * Indicates the ID is already in use by a different server.
+             */
+            DUPLICATE_ID = 'I',
+
+            /**
+             * Indicates the server has already been added.
+             */
+            DUPLICATE_REQUEST = 'R',
+
+            /**
+             * Indicates the ID is not in use.
+             */
+            NO_SERVER = 'N',
+
+            /**
+             * Indicates the server is already defunct.
+             */
+            ALREADY_DEFUNCT = 'A',
+
+            /**
+             * Indicates the server was still waiting on a host name lookup and was dropped.
+             */
+            CANCELLED = 'C',
+
+            /**
+             * Indicates the server was already present with the same name and was left untouched.
+             */
+            KEPT = 'K',
+
+            /**
+             * Indicates the server was present under a different name and has been replaced.
+             */
+            RENAMED = 'M',
+
+            /**
+             * Indicates the item could not be parsed.
+             */
+            MALFORMED = 'E',
+
+            /**
+             * Indicates the item is waiting on a host name lookup.  Never reported.
+             */
+            PENDING = 'P'
+        };
+
+        /**
+         * Trivial class holding a single item of a batch command.
+         */
+        class BatchItem {
+            public:
+                /**
+                 * The server ID.  A value of 0 indicates the item could not be parsed.
+                 */
+                unsigned long hostId;
+
+                /**
+                 * The server name.  Empty for commands that do not take a name.
+                 */
+                QString serverName;
+        };
+
+        /**
+         * Trivial class tracking the outcome of a batch command.  Batch commands that add servers are held until
+         * every host name lookup completes.
+         */
+        class Batch {
+            public:
+                /**
+                 * The connection that issued the command.  Set to null if the connection is lost.
+                 */
+                Connection* connection;
+
+                /**
+                 * The request tag to echo in the reply.
+                 */
+                unsigned long tag;
+
+                /**
+                 * The outcome of each item, in item order.
+                 */
+                QByteArray statuses;
+
+                /**
+                 * The number of items still waiting on a host name lookup.
+                 */
+                unsigned long numberPending;
+
+                /**
+                 * Flag indicating the batch is a sync command.
+                 */
+                bool sync;
+
+                /**
+                 * The number of servers removed because they were missing from a sync command.
+                 */
+                unsigned long numberRemoved;
+        };
+
+        /**
+         * Enumeration of event subscription requests.
+         */
+        enum class Subscription : std::uint8_t {
+            /**
+             * Stops all unsolicited reports.
+             */
+            NONE = 0,
+
+            /**
+             * Reports events for every server, replacing any other subscriptions.  New connections start with this
+             * subscription.
+             */
+            ALL = 1,
+
+            /**
+             * Reports events for the servers registered on the connection, replacing any other subscriptions.
+             */
+            OWN = 2,
+
+            /**
+             * Adds a range of server IDs to the current subscriptions.  Ends a \ref Subscription::ALL subscription.
+             */
+            RANGE = 3
+        };
+
+        /**
+         * Trivial class holding a subscription to a range of server IDs.
+         */
+        class RangeSubscription {
+            public:
+                /**
+                 * The first server ID in the range.
+                 */
+                unsigned long firstId;
+
+                /**
+                 * The last server ID in the range.
+                 */
+                unsigned long lastId;
+
+                /**
+                 * The subscribed connection.
+                 */
+                Connection* connection;
+        };
+
+        /**
+         * Trivial class holding one segment of the range subscription index.  A segment covers the server IDs from
+         * its first ID up to, but not including, the first ID of the next segment.
+         */
+        class RangeSegment {
+            public:
+                /**
+                 * The first server ID covered by the segment.
+                 */
+                unsigned long firstId;
+
+                /**
+                 * The connections subscribed to every server ID in the segment.  Empty for gaps between ranges.
+                 */
+                QVector<Connection*> connections;
+        };
+
+        /**
+         * Trivial class that tracks a server waiting on a host name lookup.
+         */
+        class PendingServer {
+            public:
+                /**
+                 * The server name.
+                 */
+                QString serverName;
+
+                /**
+                 * The connection that requested the server.  Set to null if the connection is lost or if the server
+                 * was requested by a batch command.
+                 */
+                Connection* connection;
+
+                /**
+                 * The request tag to echo in the reply.
+                 */
+                unsigned long tag;
+
+                /**
+                 * The batch that requested the server.  A value of 0 indicates the server was requested individually.
+                 */
+                unsigned long batchId;
+
+                /**
+                 * The index of the server within the batch.
+                 */
+                unsigned batchIndex;
+        };
+
         /**
          * The untested ping interval, in milliseconds.  Value is the closest prime value above 30 seconds.
          */
@@ -143,71 +543,415 @@ class Pinger:public QObject {
         static constexpr unsigned activePingInterval = 5003;
 
         /**
-         * The defunct ping interval, in milliseconds.  The value is the closest prime value pushing us above 5 hours.
+         * The longest interval defunct servers back off to by default, in milliseconds.  The value is the closest
+         * prime value pushing us above 5 hours.
          */
         static constexpr unsigned defunctPingInterval = 18000041;
 
         /**
-         * Method that adds a new untested server.
+         * The interval used to re-test defunct servers, in milliseconds.  Value is the closest prime value above 10
+         * seconds.
+         */
+        static constexpr unsigned defunctRetryInterval = 10007;
+
+        /**
+         * The shortest probe interval a server may request, in milliseconds.  Value is the closest prime value below
+         * 1 second.
+         */
+        static constexpr unsigned minimumPingInterval = 997;
+
+        /**
+         * The default number of bytes that may be queued for a client before it is dropped, 16 MiB.
+         */
+        static constexpr unsigned long defaultOutputLimit = 16 * 1024 * 1024;
+
+        /**
+         * The number of state change events retained for clients that resume after a lost connection.
+         */
+        static constexpr unsigned eventLogCapacity = 65536;
+
+        /**
+         * The time we wait for ping replies, in milliseconds.
+         */
+        static constexpr unsigned pingTimeout = (8 * activePingInterval) / 10;
+
+        /**
+         * The interval used to measure event loop responsiveness, in milliseconds.
+         */
+        static constexpr unsigned responsivenessCheckInterval = 97;
+
+        /**
+         * The maximum event loop latency we tolerate before complaining, in milliseconds.  Commands from the polling
+         * server are serviced by this event loop so this value bounds command round-trip latency.
+         */
+        static constexpr unsigned maximumEventLoopLatency = 50;
+
+        /**
+         * The interval used to poll the ping engine shards for results, in milliseconds.  Roughly one engine tick.
+         */
+        static constexpr unsigned resultPollInterval = 11;
+
+        /**
+         * Method that locates the index of the ping engine shard that owns a server.
          *
-         * \param[in] serverData The server data for the server to be added.
+         * \param[in] hostId The ID of the server.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \return Returns the shard index.
          */
-        bool addUntestedServer(ServerData* serverData);
+        unsigned shardFor(unsigned long hostId) const;
 
         /**
-         * Method that adds a new active server.
+         * Method that locates the ping engine shard that owns a server.
          *
-         * \param[in] serverData The server data for the server to be added.
+         * \param[in] hostId The ID of the server.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \return Returns a pointer to the owning engine.
          */
-        bool addActiveServer(ServerData* serverData);
+        PingEngine* engineFor(unsigned long hostId) const;
 
         /**
-         * Method that adds a new defunct server.
+         * Method that processes probe results for untested servers.
          *
-         * \param[in] serverData The server data for the server to be added.
+         * \param[in] results The per-host results.
+         */
+        void processUntestedResults(const QVector<PingEngine::Result>& results);
+
+        /**
+         * Method that processes probe results for active servers.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \param[in] results The per-host results.
          */
-        bool addDefunctServer(ServerData* serverData);
+        void processActiveResults(const QVector<PingEngine::Result>& results);
 
         /**
-         * Method that rebuilds the untested server list.
+         * Method that processes probe results for defunct servers.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \param[in] results The per-host results.
          */
-        bool rebuildUntestedServerList();
+        void processDefunctResults(const QVector<PingEngine::Result>& results);
 
         /**
-         * Method that rebuilds the active server list.
+         * Method that processes probe results for flagged servers.  A server that answers is reported as recovered
+         * and returned to the active pool.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \param[in] results The per-host results.
          */
-        bool rebuildActiveServerList();
+        void processFlaggedResults(const QVector<PingEngine::Result>& results);
 
         /**
-         * Method that rebuilds the defunct server list.
+         * Method that adds a batch of servers.  A single reply is sent once every server has been resolved.
          *
-         * \return Returns true on success.  Returns false on error.
+         * \param[in] items      The servers to be added.
+         *
+         * \param[in] connection The connection that issued the request.
          */
-        bool rebuildDefunctServerList();
+        void addServers(const QVector<BatchItem>& items, Connection* connection);
 
         /**
-         * Method that is called to report a server failed ping.
+         * Method that removes a batch of servers.
          *
-         * \param[in] server The server that failed the ping operation.
+         * \param[in] items      The servers to be removed.
+         *
+         * \param[in] connection The connection that issued the request.
          */
-        void reportFailedServer(ServerData* server);
+        void removeServers(const QVector<BatchItem>& items, Connection* connection);
 
         /**
-         * Method that creates a ping object.
+         * Method that marks a batch of servers as defunct.
+         *
+         * \param[in] items      The servers to be marked as defunct.
          *
-         * \return Returns a newly created and configured ping object.
+         * \param[in] connection The connection that issued the request.
          */
-        static pingobj_t* createPingObject();
+        void markServersDefunct(const QVector<BatchItem>& items, Connection* connection);
+
+        /**
+         * Method that brings the server table in line with a complete list of desired servers.  Listed servers that
+         * are missing are added, listed servers whose name changed are replaced and servers that are not listed are
+         * removed.  Servers that are unchanged keep their current status.  A single reply is sent once every new
+         * server has been resolved.
+         *
+         * \param[in] items      The complete list of desired servers.
+         *
+         * \param[in] connection The connection that issued the request.
+         */
+        void syncServers(const QVector<BatchItem>& items, Connection* connection);
+
+        /**
+         * Method that switches a connection to sequenced events and replays the logged events it missed.  Only
+         * events matching the connection's subscriptions are replayed.
+         *
+         * \param[in] lastSequence The sequence number of the last event the client received.  A value of 0 replays
+         *                         every retained event.  A value not issued by this run reports a log reset and
+         *                         replays every retained event.
+         *
+         * \param[in] connection   The connection that issued the request.
+         */
+        void resumeEvents(std::uint64_t lastSequence, Connection* connection);
+
+        /**
+         * Method that changes which unsolicited reports a connection receives.
+         *
+         * \param[in] subscription The subscription to be applied.
+         *
+         * \param[in] firstId      The first server ID of a range subscription.  Ignored otherwise.
+         *
+         * \param[in] lastId       The last server ID of a range subscription.  Ignored otherwise.
+         *
+         * \param[in] connection   The connection that issued the request.
+         *
+         * \param[in] clientName   An optional name identifying the client across connections.  Used by owner
+         *                         subscriptions to take back the servers a previous connection with the same name
+         *                         owned when it closed.  Ignored otherwise.
+         */
+        void subscribe(
+            Subscription      subscription,
+            unsigned long     firstId,
+            unsigned long     lastId,
+            Connection*       connection,
+            const QByteArray& clientName = QByteArray()
+        );
+
+        /**
+         * Method that checks a new server against the existing servers and starts resolving its name.
+         *
+         * \param[in]  hostId     The ID of the server.
+         *
+         * \param[in]  serverName The server name.
+         *
+         * \param[in]  connection The connection to reply to once the name is resolved.
+         *
+         * \param[in]  batchId    The batch requesting the server.  A value of 0 indicates no batch.
+         *
+         * \param[in]  batchIndex The index of the server within the batch.
+         *
+         * \param[out] address    Populated with the server address if the name was resolved immediately.
+         *
+         * \return Returns \ref Pinger::BatchStatus::OK if the name was resolved immediately,
+         *         \ref Pinger::BatchStatus::PENDING if a lookup was started or the reason the server was rejected.
+         */
+        BatchStatus beginAddServer(
+            unsigned long  hostId,
+            const QString& serverName,
+            Connection*    connection,
+            unsigned long  batchId,
+            unsigned       batchIndex,
+            HostAddress&   address
+        );
+
+        /**
+         * Method that assigns a server a slot in the status table.  The first server left out because the table is
+         * full is reported on the console.
+         *
+         * \param[in] handle The server's handle.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \param[in] status The server's current status.
+         */
+        void assignStatusSlot(HostTable::Handle handle, unsigned long hostId, ServerData::Status status);
+
+        /**
+         * Method that records a resolved server.  The server is not added to a ping engine by this method.
+         *
+         * \param[in] hostId       The ID of the server.
+         *
+         * \param[in] serverName   The server name.
+         *
+         * \param[in] address      The server address.  A null address indicates the lookup failed.
+         *
+         * \param[in] errorMessage A description of the error, if the lookup failed.
+         *
+         * \return Returns the handle assigned to the server.  Returns \ref HostTable::invalidHandle if the lookup
+         *         failed.
+         */
+        HostTable::Handle recordServer(
+            unsigned long      hostId,
+            const QString&     serverName,
+            const HostAddress& address,
+            const QString&     errorMessage
+        );
+
+        /**
+         * Method that forgets a server.  The server is not removed from its ping engine by this method.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \return Returns \ref Pinger::BatchStatus::OK if a live server was dropped,
+         *         \ref Pinger::BatchStatus::CANCELLED if a server waiting on a lookup was dropped, after answering
+         *         the request that added it, or
+         *         \ref Pinger::BatchStatus::NO_SERVER if the ID is not in use.
+         */
+        BatchStatus dropServer(unsigned long hostId);
+
+        /**
+         * Method that marks a server as defunct.  The server is not moved to the defunct pool by this method.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \return Returns \ref Pinger::BatchStatus::OK on success or the reason the request was rejected.
+         */
+        BatchStatus setServerDefunct(unsigned long hostId);
+
+        /**
+         * Method that records the outcome of a batch item that was waiting on a host name lookup.  The batch reply is
+         * sent once the last item completes.
+         *
+         * \param[in] batchId    The ID of the batch.
+         *
+         * \param[in] batchIndex The index of the item within the batch.
+         *
+         * \param[in] status     The outcome of the item.
+         */
+        void completeBatchItem(unsigned long batchId, unsigned batchIndex, BatchStatus status);
+
+        /**
+         * Method that queues servers to be added to each ping engine shard.  Each shard receives a single call.
+         *
+         * \param[in] additions The servers to be added, indexed by shard.
+         */
+        void queueAdditions(const QVector<QVector<PingEngine::HostEntry>>& additions);
+
+        /**
+         * Method that queues servers to be removed from each ping engine shard.  Each shard receives a single call.
+         *
+         * \param[in] removals The IDs of the servers to be removed, indexed by shard.
+         */
+        void queueRemovals(const QVector<QVector<unsigned long>>& removals);
+
+        /**
+         * Method that holds a batch until its host name lookups complete or replies immediately if there are none.
+         *
+         * \param[in] batch The batch to be held or reported.
+         */
+        void submitBatch(const Batch& batch);
+
+        /**
+         * Method that sends the reply for a batch command.
+         *
+         * \param[in] batch The completed batch.  No reply is sent if the batch connection is null.
+         */
+        void sendBatchReply(const Batch& batch);
+
+        /**
+         * Method that adds a resolved server and replies to the requesting connection.
+         *
+         * \param[in] hostId       The ID of the server.
+         *
+         * \param[in] serverName   The server name.
+         *
+         * \param[in] address      The server address.  A null address indicates the lookup failed.
+         *
+         * \param[in] errorMessage A description of the error, if the lookup failed.
+         *
+         * \param[in] connection   The connection to reply to.  No reply is sent if this value is null.
+         *
+         * \param[in] tag          The request tag to echo in the reply.
+         */
+        void insertServer(
+            unsigned long      hostId,
+            const QString&     serverName,
+            const HostAddress& address,
+            const QString&     errorMessage,
+            Connection*        connection,
+            unsigned long      tag
+        );
+
+        /**
+         * Method that moves a server to a new engine pool.
+         *
+         * \param[in] hostId The ID of the server to be moved.
+         *
+         * \param[in] pool   The new pool for the server.
+         */
+        void moveServer(unsigned long hostId, PingEngine::Pool pool);
+
+        /**
+         * Method that is called to log a server state change and report it to the subscribed connections.
+         *
+         * \param[in] kind   The state change.
+         *
+         * \param[in] handle The handle of the server that changed state.
+         */
+        void reportEvent(EventLog::Kind kind, HostTable::Handle handle);
+
+        /**
+         * Method that determines if a connection is subscribed to events for a server.
+         *
+         * \param[in] connection The connection to check.
+         *
+         * \param[in] hostId     The ID of the server.
+         *
+         * \return Returns true if the connection should receive events for the server.
+         */
+        bool isSubscribed(const Connection* connection, unsigned long hostId) const;
+
+        /**
+         * Method that records the connection that registered a server so that it can receive events for the server.
+         *
+         * \param[in] hostId     The ID of the server.
+         *
+         * \param[in] connection The connection that registered the server.
+         */
+        void setOwner(unsigned long hostId, Connection* connection);
+
+        /**
+         * Method that forgets the connection that registered a server.
+         *
+         * \param[in] hostId The ID of the server.
+         */
+        void clearOwner(unsigned long hostId);
+
+        /**
+         * Method that removes every range subscription held by a connection.
+         *
+         * \param[in] connection The connection to be unsubscribed.
+         */
+        void removeRangeSubscriptions(Connection* connection);
+
+        /**
+         * Method that rebuilds the range subscription index after the range subscriptions change.
+         */
+        void rebuildRangeIndex();
+
+        /**
+         * Method that locates the range subscription index segment covering a server.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \return Returns the segment covering the server.  A null pointer is returned if no range covers the
+         *         server.
+         */
+        const RangeSegment* findRangeSegment(unsigned long hostId) const;
+
+        /**
+         * Method that is called to report the latencies measured for a server to a connection.  Latencies are
+         * reported in milliseconds.
+         *
+         * \param[in] hostId     The ID of the server.
+         *
+         * \param[in] connection The connection that requested the latencies.
+         */
+        void reportLatency(unsigned long hostId, Connection* connection);
+
+        /**
+         * Method that is called to report pinger statistics to a connection.
+         *
+         * \param[in] connection The connection that requested the statistics.
+         */
+        void reportStatistics(Connection* connection);
+
+        /**
+         * Method that is called when a ping engine shard has completed a batch of probes.  The results are read in
+         * place and released back to the engine once processed.
+         *
+         * \param[in] engine The shard reporting the results.
+         *
+         * \param[in] pool   The pool holding the probed servers.
+         *
+         * \param[in] buffer The index of the engine's result buffer holding the results.
+         */
+        void probesCompleted(PingEngine* engine, PingEngine::Pool pool, unsigned buffer);
 
         /**
          * The local socket server instance.
@@ -215,19 +959,41 @@ class Pinger:public QObject {
         QLocalServer* localServer;
 
         /**
-         * The untested ping timer.
+         * Timer used to measure event loop responsiveness.
+         */
+        QTimer* responsivenessTimer;
+
+        /**
+         * Timer used to poll the ping engine shards for results.
          */
-        QTimer* untestedPingTimer;
+        QTimer* resultTimer;
 
         /**
-         * The active ping timer.
+         * Elapsed timer used to measure event loop responsiveness.
          */
-        QTimer* activePingTimer;
+        QElapsedTimer responsivenessElapsedTimer;
 
         /**
-         * The defunct ping timer.
+         * Elapsed timer measuring how long the pinger has been running.
          */
-        QTimer* defunctPingTimer;
+        QElapsedTimer uptimeTimer;
+
+        /**
+         * The threads running the ping engine shards.
+         */
+        QVector<QThread*> engineThreads;
+
+        /**
+         * The ping engine shards, indexed by shard.  Each engine lives in the matching entry of
+         * \ref Pinger::engineThreads and must only be accessed through queued invocations or its thread safe
+         * accessors.
+         */
+        QVector<PingEngine*> engines;
+
+        /**
+         * The resolver cache used to look up server addresses.
+         */
+        ResolverCache* resolverCache;
 
         /**
          * The list of active connections.
@@ -235,39 +1001,123 @@ class Pinger:public QObject {
         QSet<Connection*> connections;
 
         /**
-         * Ping object holding just our untested servers.
+         * The connections that receive events for every server.
+         */
+        QSet<Connection*> allSubscribers;
+
+        /**
+         * The connections that receive events for the servers they registered.
+         */
+        QSet<Connection*> ownerSubscribers;
+
+        /**
+         * The connection that registered each server, keyed by host ID.
+         */
+        QHash<unsigned long, Connection*> hostOwners;
+
+        /**
+         * The servers registered by each connection.  Lets a disconnect release only the servers the connection
+         * owns.
+         */
+        QHash<Connection*, QSet<unsigned long>> ownedHosts;
+
+        /**
+         * The client name given by each connection with an owner subscription.
+         */
+        QHash<Connection*, QByteArray> clientNames;
+
+        /**
+         * The servers owned by named clients when their connection closed, keyed by client name.  A later
+         * connection with the same name takes them back.
+         */
+        QHash<QByteArray, QSet<unsigned long>> detachedHosts;
+
+        /**
+         * The range subscriptions across all connections.
+         */
+        QVector<RangeSubscription> rangeSubscriptions;
+
+        /**
+         * Index of the range subscriptions, sorted by first server ID.  Rebuilt whenever the range subscriptions
+         * change so reports locate their subscribers with a binary search.
+         */
+        QVector<RangeSegment> rangeSegments;
+
+        /**
+         * The recent server state changes.
+         */
+        EventLog eventLog;
+
+        /**
+         * The shared memory status table.
+         */
+        StatusTable statusTable;
+
+        /**
+         * The live servers.
+         */
+        HostTable hostTable;
+
+        /**
+         * Servers waiting on a host name lookup, keyed by host ID.
+         */
+        QHash<unsigned long, PendingServer> pendingServers;
+
+        /**
+         * Batch add commands waiting on host name lookups, keyed by batch ID.
+         */
+        QHash<unsigned long, Batch> batches;
+
+        /**
+         * The ID to assign to the next batch add command.
+         */
+        unsigned long nextBatchId;
+
+        /**
+         * The number of bytes that may be queued for a client before it is dropped.
+         */
+        unsigned long currentOutputLimit;
+
+        /**
+         * The number of bytes written to connections that have since closed.
+         */
+        unsigned long closedBytesWritten;
+
+        /**
+         * The number of connections dropped because they could not keep up with their output.
          */
-        pingobj_t* untestedPingObject;
+        unsigned long numberSlowConsumers;
 
         /**
-         * Ping object holding only the active server.
+         * The number of consecutive missed replies before a server is flagged.
          */
-        pingobj_t* activePingObject;
+        unsigned lossThreshold;
 
         /**
-         * Ping object holding just our defunct servers.
+         * The loss, as a percentage of a cycle's probes, at which the cycle counts as a missed reply.
          */
-        pingobj_t* defunctPingObject;
+        unsigned cycleLossLimit;
 
         /**
-         * Hash used to track servers/
+         * The number of outages detected.
          */
-        QHash<unsigned long, ServerData> serverData;
+        unsigned long numberOutagesDetected;
 
         /**
-         * Flag indicating that the untested polling list needs to be updated.
+         * The total time taken to detect outages, in milliseconds.  Each outage is timed from the first unanswered
+         * probe.
          */
-        bool untestedPingListNeedsUpdate;
+        double totalDetectTime;
 
         /**
-         * Flag indicating that the active polling list needs to be updated.
+         * The most recently measured event loop latency, in milliseconds.
          */
-        bool activePingListNeedsUpdate;
+        unsigned long lastEventLoopLatency;
 
         /**
-         * Flag indicating that the defunct ping list needs to be updated.
+         * The worst event loop latency measured while probes were in flight, in milliseconds.
          */
-        bool defunctPingListNeedsUpdate;
+        unsigned long worstInFlightEventLoopLatency;
 };
 
 #endif
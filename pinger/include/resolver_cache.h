@@ -0,0 +1,427 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref ResolverCache class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef RESOLVER_CACHE_H
+#define RESOLVER_CACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QRunnable>
+#include <QElapsedTimer>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "host_address.h"
+
+class QTimer;
+class QThreadPool;
+
+/**
+ * Class that resolves and caches host addresses, keyed by host name.  Lookups run on a pool of worker threads so the
+ * caller's event loop is never blocked by the system resolver.  Entries that are in use are re-resolved in the
+ * background once their time-to-live expires.  Hosts whose address changes are reported through the
+ * \ref ResolverCache::addressChanged signal.
+ *
+ * The system resolver does not expose record TTLs so a fixed time-to-live is used for every entry.  Names that are
+ * IP address literals bypass the cache entirely.
+ */
+class ResolverCache:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Constructor
+         *
+         * \param[in] parent Pointer to the parent object.
+         */
+        ResolverCache(QObject* parent = nullptr);
+
+        ~ResolverCache() override;
+
+        /**
+         * Method you can use to set the maximum number of lookups performed concurrently.
+         *
+         * \param[in] newMaximumLookups The new maximum number of concurrent lookups.
+         */
+        void setMaximumLookups(unsigned newMaximumLookups);
+
+        /**
+         * Method you can use to obtain the maximum number of lookups performed concurrently.
+         *
+         * \return Returns the maximum number of concurrent lookups.
+         */
+        unsigned maximumLookups() const;
+
+        /**
+         * Method you can use to obtain the address of a host and record that a host ID is using it.  Address literals
+         * and cached names are returned immediately.  Other names are queued for resolution on a worker thread and
+         * the result is reported through the \ref ResolverCache::lookupCompleted signal.  Concurrent requests for the
+         * same name share a single lookup.
+         *
+         * \param[in]  hostName The host name to look up.
+         *
+         * \param[in]  hostId   The ID of the host that will use the address.
+         *
+         * \param[out] address  Populated with the host address if it is available immediately.
+         *
+         * \return Returns true if the address is available immediately.  Returns false if a lookup was queued.
+         */
+        bool acquire(const QString& hostName, unsigned long hostId, HostAddress& address);
+
+        /**
+         * Method you can use to indicate that a host ID no longer uses an address.  The entry remains cached until
+         * it expires so that a quickly re-added host will not trigger another lookup.
+         *
+         * \param[in] hostName The host name that was looked up.
+         *
+         * \param[in] hostId   The ID of the host that was using the address.
+         */
+        void release(const QString& hostName, unsigned long hostId);
+
+        /**
+         * Method you can use to obtain the number of lookups satisfied from the cache.
+         *
+         * \return Returns the number of cache hits.
+         */
+        inline unsigned long numberHits() const {
+            return hits;
+        }
+
+        /**
+         * Method you can use to obtain the number of lookups that required the system resolver.
+         *
+         * \return Returns the number of cache misses.
+         */
+        inline unsigned long numberMisses() const {
+            return misses;
+        }
+
+        /**
+         * Method you can use to determine the memory held by the cache.
+         *
+         * \return Returns the approximate number of bytes held by the cache entries and pending lookups.
+         */
+        std::size_t memoryUsage() const;
+
+        /**
+         * Method you can use to obtain the number of lookups satisfied by parsing an address literal.
+         *
+         * \return Returns the number of address literal lookups.
+         */
+        inline unsigned long numberLiterals() const {
+            return literals;
+        }
+
+        /**
+         * Method you can use to obtain the number of background refreshes performed.
+         *
+         * \return Returns the number of background refreshes.
+         */
+        inline unsigned long numberRefreshes() const {
+            return refreshes;
+        }
+
+        /**
+         * Method you can use to obtain the number of background refreshes that found a new address.
+         *
+         * \return Returns the number of address changes.
+         */
+        inline unsigned long numberChanges() const {
+            return changes;
+        }
+
+        /**
+         * Method you can use to obtain the number of cached names.
+         *
+         * \return Returns the number of cached names.
+         */
+        inline unsigned long numberEntries() const {
+            return static_cast<unsigned long>(entries.size());
+        }
+
+        /**
+         * Method you can use to obtain the number of names waiting on or undergoing an initial lookup.
+         *
+         * \return Returns the lookup queue depth.
+         */
+        inline unsigned long queueDepth() const {
+            return static_cast<unsigned long>(lookups.size());
+        }
+
+        /**
+         * Method you can use to obtain the number of host IDs waiting on an initial lookup.
+         *
+         * \return Returns the number of waiting host IDs.
+         */
+        inline unsigned long numberWaitingHosts() const {
+            return waitingHosts;
+        }
+
+        /**
+         * Method you can use to obtain the total number of initial lookups completed.
+         *
+         * \return Returns the number of completed lookups.
+         */
+        inline unsigned long numberResolved() const {
+            return resolved;
+        }
+
+        /**
+         * Method you can use to obtain the recent lookup throughput.
+         *
+         * \return Returns the number of host IDs resolved per second over the most recent sampling window.  A value
+         *         of zero is returned if no lookups have completed recently.
+         */
+        double resolvedPerSecond() const;
+
+    signals:
+        /**
+         * Signal that is emitted when a queued lookup completes.  The signal is emitted once for each host ID that
+         * requested the name.  On success, the host ID has been recorded as a user of the address.
+         *
+         * \param[in] hostId       The ID of the host that requested the lookup.
+         *
+         * \param[in] hostName     The name that was resolved.
+         *
+         * \param[in] address      The resolved address.  A null address indicates the lookup failed.
+         *
+         * \param[in] errorMessage A description of the error, if the lookup failed.
+         */
+        void lookupCompleted(
+            unsigned long      hostId,
+            const QString&     hostName,
+            const HostAddress& address,
+            const QString&     errorMessage
+        );
+
+        /**
+         * Signal that is emitted when a background refresh finds a new address for a name.
+         *
+         * \param[in] hostIds The IDs of the hosts using the name.
+         *
+         * \param[in] address The new address.
+         */
+        void addressChanged(const QList<unsigned long>& hostIds, const HostAddress& address);
+
+    private slots:
+        /**
+         * Slot that is triggered periodically to refresh expired entries and discard unused ones.
+         */
+        void checkEntries();
+
+    private:
+        /**
+         * The time-to-live of a cache entry, in seconds.
+         */
+        static constexpr unsigned timeToLive = 3607;
+
+        /**
+         * The time to wait before retrying a failed background refresh, in seconds.
+         */
+        static constexpr unsigned retryInterval = 307;
+
+        /**
+         * The interval between checks for expired entries, in milliseconds.
+         */
+        static constexpr unsigned checkInterval = 10007;
+
+        /**
+         * The default number of concurrent lookups.
+         */
+        static constexpr unsigned defaultMaximumLookups = 16;
+
+        /**
+         * The minimum window used to measure lookup throughput, in milliseconds.
+         */
+        static constexpr unsigned rateWindow = 1009;
+
+        /**
+         * Trivial class holding a single cache entry.
+         */
+        class Entry {
+            public:
+                /**
+                 * The cached address.
+                 */
+                HostAddress address;
+
+                /**
+                 * The time the entry expires, in seconds since the epoch.
+                 */
+                std::int64_t expiresAt;
+
+                /**
+                 * The IDs of the hosts using this entry.
+                 */
+                QSet<unsigned long> users;
+
+                /**
+                 * Flag indicating that a background refresh is in flight.
+                 */
+                bool refreshing;
+        };
+
+        /**
+         * Runnable used to resolve a name on a pool thread.
+         */
+        class LookupTask:public QRunnable {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] cache    The cache to receive the result.
+                 *
+                 * \param[in] hostName The name to be resolved.
+                 */
+                LookupTask(ResolverCache* cache, const QString& hostName);
+
+                ~LookupTask() override;
+
+                /**
+                 * Method that performs the lookup.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The cache to receive the result.
+                 */
+                ResolverCache* cache;
+
+                /**
+                 * The name to be resolved.
+                 */
+                QString hostName;
+        };
+
+        /**
+         * Method that is called on the cache's thread when a lookup completes.
+         *
+         * \param[in] hostName     The name that was resolved.
+         *
+         * \param[in] address      The resolved address.  A null address indicates the lookup failed.
+         *
+         * \param[in] errorMessage A description of the error, if the lookup failed.
+         */
+        void lookupFinished(const QString& hostName, const HostAddress& address, const QString& errorMessage);
+
+        /**
+         * Method that completes a background refresh.
+         *
+         * \param[in] hostName The name that was resolved.
+         *
+         * \param[in] entry    The entry that was refreshed.
+         *
+         * \param[in] address  The resolved address.  A null address indicates the lookup failed.
+         */
+        void refreshCompleted(const QString& hostName, Entry& entry, const HostAddress& address);
+
+        /**
+         * Method that updates the throughput measurement.
+         *
+         * \param[in] numberHosts The number of host IDs just resolved.
+         */
+        void updateRate(unsigned long numberHosts);
+
+        /**
+         * Method that obtains the current time.
+         *
+         * \return Returns the current time in seconds since the epoch.
+         */
+        static std::int64_t now();
+
+        /**
+         * The cache entries, keyed by host name.
+         */
+        QHash<QString, Entry> entries;
+
+        /**
+         * The host IDs waiting on each initial lookup, keyed by host name.
+         */
+        QHash<QString, QList<unsigned long>> lookups;
+
+        /**
+         * Timer used to trigger checks for expired entries.
+         */
+        QTimer* checkTimer;
+
+        /**
+         * Thread pool used to perform lookups and background refreshes.
+         */
+        QThreadPool* threadPool;
+
+        /**
+         * The number of cache hits.
+         */
+        unsigned long hits;
+
+        /**
+         * The number of cache misses.
+         */
+        unsigned long misses;
+
+        /**
+         * The number of address literal lookups.
+         */
+        unsigned long literals;
+
+        /**
+         * The number of background refreshes.
+         */
+        unsigned long refreshes;
+
+        /**
+         * The number of background refreshes that found a new address.
+         */
+        unsigned long changes;
+
+        /**
+         * The number of host IDs waiting on an initial lookup.
+         */
+        unsigned long waitingHosts;
+
+        /**
+         * The number of initial lookups completed.
+         */
+        unsigned long resolved;
+
+        /**
+         * Timer used to measure lookup throughput.
+         */
+        QElapsedTimer rateTimer;
+
+        /**
+         * The number of host IDs resolved in the current sampling window.
+         */
+        unsigned long rateCount;
+
+        /**
+         * The throughput measured over the most recent sampling window, in host IDs per second.
+         */
+        double lastRate;
+};
+
+#endif
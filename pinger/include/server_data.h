@@ -28,11 +28,8 @@
 
 #include <cstdint>
 
-class QLocalServer;
-class Connection;
-
 /**
- * Class that stores information about a specific server.
+ * Class that defines the server status values.  The per-server state itself is held by \ref HostTable.
  */
 class ServerData {
     public:
@@ -86,127 +83,6 @@ class ServerData {
             NUMBER_VALUES = 8
         };
 
-        inline ServerData():
-            currentId(0),
-            currentStatus(Status::UNTESTED) {}
-
-        /**
-         * Constructor
-         *
-         * \param[in] serverId   The internal ID of this server.
-         *
-         * \param[in] serverName The name of this server.
-         *
-         * \param[in] status     The server's current status.
-         */
-        inline ServerData(
-                unsigned long  serverId,
-                const QString& serverName,
-                Status         status = Status::UNTESTED
-            ):currentId(
-                serverId
-            ),currentStatus(
-                status
-            ),currentName(
-                serverName
-            ) {}
-
-        /**
-         * Copy constructor
-         *
-         * \param[in] other The instance to assign to this instance.
-         */
-        inline ServerData(
-                const ServerData& other
-            ):currentId(
-                other.currentId
-            ),currentStatus(
-                other.currentStatus
-            ),currentName(
-                other.currentName
-            ) {}
-
-        /**
-         * Move constructor
-         *
-         * \param[in] other The instance to assign to this instance.
-         */
-        inline ServerData(
-                ServerData&& other
-            ):currentId(
-                other.currentId
-            ),currentStatus(
-                other.currentStatus
-            ),currentName(
-                other.currentName
-            ) {}
-
-        /**
-         * Method you can use to obtain the server ID.
-         *
-         * \return Returns the server Id.
-         */
-        inline unsigned long serverId() const {
-            return currentId;
-        }
-
-        /**
-         * Method you can use to obtain the server name.
-         *
-         * \return returns the server name.
-         */
-        inline const QString& serverName() const {
-            return currentName;
-        }
-
-        /**
-         * Method you can use to obtain the server status.
-         *
-         * \return Returns the current server status.
-         */
-        inline Status status() const {
-            return currentStatus;
-        }
-
-        /**
-         * Method you can use to update the server status.
-         *
-         * \param[in] newStatus The new server status.
-         */
-        inline void setStatus(Status newStatus) {
-            currentStatus = newStatus;
-        }
-
-        /**
-         * Assignment operator.
-         *
-         * \param[in] other The instance to assign to this instance.
-         *
-         * \return Returns a reference to this instance.
-         */
-        inline ServerData& operator=(const ServerData& other) {
-            currentId     = other.currentId;
-            currentStatus = other.currentStatus;
-            currentName   = other.currentName;
-
-            return *this;
-        }
-
-        /**
-         * Assignment operator (move semantics).
-         *
-         * \param[in] other The instance to assign to this instance.
-         *
-         * \return Returns a reference to this instance.
-         */
-        inline ServerData& operator=(ServerData&& other) {
-            currentId     = other.currentId;
-            currentStatus = other.currentStatus;
-            currentName   = other.currentName;
-
-            return *this;
-        }
-
         /**
          * Static method you can use to convert the status to a string.
          *
@@ -237,21 +113,6 @@ class ServerData {
          * Hash table used to convert server status strings to values.
          */
         static const QHash<QString, Status> serverStatusValues;
-
-        /**
-         * The server ID.
-         */
-        unsigned long currentId;
-
-        /**
-         * The server status.
-         */
-        Status currentStatus;
-
-        /**
-         * The server name.
-         */
-        QString currentName;
 };
 
 #endif
@@ -0,0 +1,198 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref StatusTable class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef STATUS_TABLE_H
+#define STATUS_TABLE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "status_table_layout.h"
+#include "server_data.h"
+
+/**
+ * Class that publishes server status into a POSIX shared memory table.  Other processes can map the table read-only
+ * and scan every server without system calls or locks.  The table has a single writer, the pinger's control thread,
+ * so publishing never touches the ping engine threads.
+ */
+class StatusTable {
+    public:
+        /**
+         * The default number of slots in the table.
+         */
+        static constexpr unsigned defaultCapacity = 262144;
+
+        /**
+         * Value indicating a server has no slot in the table.
+         */
+        static constexpr unsigned noSlot = static_cast<unsigned>(-1);
+
+        StatusTable();
+
+        ~StatusTable();
+
+        /**
+         * Method you can use to create and map the table.  Any previously opened table is closed first.  An object
+         * left behind under the same name, for example by a daemon that crashed, is unlinked rather than reused so
+         * readers still mapping it keep a stale but valid view.
+         *
+         * \param[in] name        The shared memory object name.  A leading "/" is added if missing.
+         *
+         * \param[in] newCapacity The number of server slots.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool open(const QString& name, unsigned newCapacity = defaultCapacity);
+
+        /**
+         * Method you can use to unmap and remove the table.
+         */
+        void close();
+
+        /**
+         * Method you can use to determine if the table is open.
+         *
+         * \return Returns true if the table is open.  Returns false if the table is closed.
+         */
+        inline bool isOpen() const {
+            return header != nullptr;
+        }
+
+        /**
+         * Method you can use to obtain a description of the last error.
+         *
+         * \return Returns a string describing the last error.
+         */
+        inline const QString& errorString() const {
+            return lastError;
+        }
+
+        /**
+         * Method you can use to assign a slot to a server.
+         *
+         * \param[in] hostId The ID of the server.
+         *
+         * \param[in] status The server's initial status.
+         *
+         * \return Returns the assigned slot.  Returns \ref StatusTable::noSlot if the table is closed or full.
+         */
+        unsigned allocate(unsigned long hostId, ServerData::Status status);
+
+        /**
+         * Method you can use to obtain the number of servers refused a slot since the table was opened because the
+         * table was full.
+         *
+         * \return Returns the number of servers left out of the table.
+         */
+        inline unsigned long numberOverflows() const {
+            return numberRefused;
+        }
+
+        /**
+         * Method you can use to release a slot assigned to a server.
+         *
+         * \param[in] slot The slot to be released.  Invalid slots are ignored.
+         */
+        void release(unsigned slot);
+
+        /**
+         * Method you can use to mark the start of an update.  The method samples the clock once for all replies
+         * published until the next call and updates the table heartbeat.
+         */
+        void beginUpdate();
+
+        /**
+         * Method you can use to publish a server's status.
+         *
+         * \param[in] slot    The server's slot.  Invalid slots are ignored.
+         *
+         * \param[in] status  The server status.
+         *
+         * \param[in] latency The measured latency, in milliseconds.  A negative value indicates no reply was received
+         *                    and leaves the last round trip time and last seen time unchanged.
+         */
+        void publish(unsigned slot, ServerData::Status status, double latency = -1.0);
+
+    private:
+        /**
+         * Method that reports the last system error.
+         *
+         * \param[in] operation The operation that failed.
+         */
+        void setError(const char* operation);
+
+        /**
+         * The shared memory object name.
+         */
+        QByteArray objectName;
+
+        /**
+         * The last reported error.
+         */
+        QString lastError;
+
+        /**
+         * The mapped table header.  A null pointer indicates the table is closed.
+         */
+        StatusTableHeader* header;
+
+        /**
+         * The mapped slots.
+         */
+        StatusTableSlot* tableSlots;
+
+        /**
+         * The size of the mapping, in bytes.
+         */
+        std::size_t mappingSize;
+
+        /**
+         * The number of slots in the table.
+         */
+        unsigned capacity;
+
+        /**
+         * The number of slots handed out so far.  Slots above this value have never been used.
+         */
+        unsigned numberUsed;
+
+        /**
+         * The number of servers refused a slot because the table was full.
+         */
+        unsigned long numberRefused;
+
+        /**
+         * Released slots available for reuse.
+         */
+        QVector<unsigned> freeSlots;
+
+        /**
+         * The time sampled by \ref StatusTable::beginUpdate, in milliseconds since the epoch.
+         */
+        std::uint64_t updateTime;
+};
+
+#endif
@@ -0,0 +1,199 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the layout of the shared memory status table published by the pinger.  The header has no
+* dependencies beyond the C++ standard library so that readers can include it directly.
+***********************************************************************************************************************/
+
+/* .. sphinx-project pinger */
+
+#ifndef STATUS_TABLE_LAYOUT_H
+#define STATUS_TABLE_LAYOUT_H
+
+#include <atomic>
+#include <cstdint>
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "Status table requires lock-free 32-bit atomics.");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Status table requires lock-free 64-bit atomics.");
+
+/**
+ * Value placed at the start of the status table to identify it, "PSTB".
+ */
+static constexpr std::uint32_t statusTableMagic = 0x42545350;
+
+/**
+ * Value identifying the status table layout.  Changed whenever the layout changes.
+ */
+static constexpr std::uint32_t statusTableLayoutVersion = 1;
+
+/**
+ * Value used in \ref StatusTableEntry::lastRtt when no reply has been received.
+ */
+static constexpr std::uint32_t statusTableNoRtt = 0xFFFFFFFF;
+
+/**
+ * Trivial class holding a consistent copy of a single status table slot.
+ */
+class StatusTableEntry {
+    public:
+        /**
+         * The server ID.  A value of 0 indicates the slot is unused.
+         */
+        std::uint64_t hostId;
+
+        /**
+         * The server status, using the values of \ref ServerData::Status.
+         */
+        std::uint32_t status;
+
+        /**
+         * The most recent round trip time, in microseconds.  Holds \ref statusTableNoRtt if no reply was received.
+         */
+        std::uint32_t lastRtt;
+
+        /**
+         * The time of the most recent reply, in milliseconds since the epoch.  A value of 0 indicates no reply was
+         * received.
+         */
+        std::uint64_t lastSeen;
+};
+
+/**
+ * The status table header.  The header occupies one cache line and is followed by the slots.
+ */
+class alignas(64) StatusTableHeader {
+    public:
+        /**
+         * Holds \ref statusTableMagic once the table is ready.
+         */
+        std::atomic<std::uint32_t> magic;
+
+        /**
+         * Holds \ref statusTableLayoutVersion.
+         */
+        std::uint32_t layoutVersion;
+
+        /**
+         * The size of each slot, in bytes.
+         */
+        std::uint32_t slotSize;
+
+        /**
+         * The number of slots in the table.
+         */
+        std::uint32_t capacity;
+
+        /**
+         * The number of slots that have ever been used.  Readers only need to scan this many slots.
+         */
+        std::atomic<std::uint32_t> numberSlots;
+
+        /**
+         * Reserved for future use.
+         */
+        std::uint32_t reserved;
+
+        /**
+         * The time of the most recent update, in milliseconds since the epoch.  Readers can use this value to detect
+         * a stalled pinger.
+         */
+        std::atomic<std::uint64_t> updatedAt;
+};
+
+/**
+ * A single status table slot.  Slots are guarded by a sequence lock.  The single writer makes the version odd while
+ * it updates the slot, so readers never wait on the writer and simply retry if the version changed under them.
+ */
+class StatusTableSlot {
+    public:
+        /**
+         * Method used by the writer before updating the slot.
+         */
+        inline void beginWrite() {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        /**
+         * Method used by the writer once the slot has been updated.
+         */
+        inline void endWrite() {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * Method used by readers to obtain a consistent copy of the slot.
+         *
+         * \param[out] entry       The copy of the slot.
+         *
+         * \param[in]  maximumTries The number of attempts to make before giving up.
+         *
+         * \return Returns true if a consistent copy was obtained.  Returns false if the slot kept changing.
+         */
+        inline bool read(StatusTableEntry& entry, unsigned maximumTries = 64) const {
+            bool consistent = false;
+            for (unsigned tries=0 ; !consistent && tries<maximumTries ; ++tries) {
+                std::uint32_t before = version.load(std::memory_order_acquire);
+                if ((before & 1) == 0) {
+                    entry.hostId   = hostId.load(std::memory_order_relaxed);
+                    entry.status   = status.load(std::memory_order_relaxed);
+                    entry.lastRtt  = lastRtt.load(std::memory_order_relaxed);
+                    entry.lastSeen = lastSeen.load(std::memory_order_relaxed);
+
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    consistent = (version.load(std::memory_order_relaxed) == before);
+                }
+            }
+
+            return consistent;
+        }
+
+        /**
+         * The sequence lock version.  Odd while the writer is updating the slot.
+         */
+        std::atomic<std::uint32_t> version;
+
+        /**
+         * The server status, using the values of \ref ServerData::Status.
+         */
+        std::atomic<std::uint32_t> status;
+
+        /**
+         * The server ID.  A value of 0 indicates the slot is unused.
+         */
+        std::atomic<std::uint64_t> hostId;
+
+        /**
+         * The most recent round trip time, in microseconds.
+         */
+        std::atomic<std::uint32_t> lastRtt;
+
+        /**
+         * Reserved for future use.
+         */
+        std::atomic<std::uint32_t> reserved;
+
+        /**
+         * The time of the most recent reply, in milliseconds since the epoch.
+         */
+        std::atomic<std::uint64_t> lastSeen;
+};
+
+static_assert(sizeof(StatusTableHeader) == 64, "Unexpected status table header size.");
+static_assert(sizeof(StatusTableSlot) == 32, "Unexpected status table slot size.");
+
+#endif
@@ -23,6 +23,8 @@ QT += core network
 CONFIG += console
 CONFIG += c++14
 
+unix:!macx:LIBS += -lrt
+
 ########################################################################################################################
 # Headers
 #
@@ -31,6 +33,14 @@ INCLUDEPATH += include
 HEADERS = include/pinger.h \
           include/connection.h \
           include/server_data.h \
+          include/host_address.h \
+          include/resolver_cache.h \
+          include/ping_engine.h \
+          include/latency_histogram.h \
+          include/event_log.h \
+          include/status_table_layout.h \
+          include/status_table.h \
+          include/host_table.h \
 
 ########################################################################################################################
 # Source files
@@ -40,6 +50,13 @@ SOURCES = source/main.cpp \
           source/pinger.cpp \
           source/connection.cpp \
           source/server_data.cpp \
+          source/host_address.cpp \
+          source/resolver_cache.cpp \
+          source/ping_engine.cpp \
+          source/latency_histogram.cpp \
+          source/event_log.cpp \
+          source/status_table.cpp \
+          source/host_table.cpp \
 
 ########################################################################################################################
 # Private headers
@@ -48,13 +65,6 @@ SOURCES = source/main.cpp \
 INCLUDEPATH += source
 HEADERS +=
 
-########################################################################################################################
-# Libraries
-#
-
-INCLUDEPATH += $${OPING_INCLUDE}
-LIBS += -L$${OPING_LIBDIR} -loping
-
 ########################################################################################################################
 # Locate build intermediate and output products
 #
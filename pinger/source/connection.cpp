@@ -19,95 +19,862 @@
 ***********************************************************************************************************************/
 
 #include <QObject>
+#include <QCoreApplication>
 #include <QIODevice>
 #include <QLocalSocket>
+#include <QTimer>
 #include <QRegularExpression>
+#include <QtEndian>
 
 #include <iostream>
+#include <limits>
+#include <cctype>
+#include <cmath>
 
-#include <oping.h>
-
+#include "latency_histogram.h"
 #include "pinger.h"
 #include "connection.h"
 
 Connection::Connection(QLocalSocket* localSocket, Pinger* parent):QObject(parent) {
-    socket = localSocket;
+    socket         = localSocket;
+    binary         = false;
+    started        = false;
+    tagged         = false;
+    streaming      = false;
+    requestTag     = 0;
+    batchTag       = 0;
+    flushScheduled = false;
+    bytesWritten   = 0;
+    discarding     = false;
+    closing        = false;
+    dropped        = false;
+    batchMode      = BatchMode::NONE;
+    batchOverflow  = false;
+
     connect(socket, &QLocalSocket::readyRead, this, &Connection::readyRead);
     connect(socket, &QLocalSocket::readChannelFinished, this, &Connection::readChannelFinished);
 }
 
 
 Connection::~Connection() {
-    delete socket;
+    if (closing && !dropped && socket->state() != QLocalSocket::UnconnectedState) {
+        // Let Qt finish writing the final replies from the event loop and release the socket once it closes.  A dropped
+        // consumer is not drained; deleting the socket aborts it immediately.
+        QLocalSocket* localSocket = socket;
+        connect(localSocket, &QLocalSocket::disconnected, localSocket, &QLocalSocket::deleteLater);
+        QTimer::singleShot(closeTimeout, localSocket, [localSocket]() { localSocket->abort(); });
+
+        localSocket->disconnectFromServer();
+    } else {
+        delete socket;
+    }
+}
+
+
+void Connection::sendStatus(Pinger::BatchStatus status) {
+    sendStatus(status, requestTag);
+}
+
+
+void Connection::sendStatus(Pinger::BatchStatus status, unsigned long tag) {
+    if (binary) {
+        QByteArray frame = newFrame(1);
+        frame.append(char(status));
+        sendFrame(frame, FrameType::STATUS_REPLY, tag);
+    } else {
+        const char* text;
+        switch (status) {
+            case Pinger::BatchStatus::OK:                { text = "OK\n";                      break; }
+            case Pinger::BatchStatus::FAILED:            { text = "failed\n";                  break; }
+            case Pinger::BatchStatus::DUPLICATE_ID:      { text = "ERROR DUPLICATE ID\n";      break; }
+            case Pinger::BatchStatus::DUPLICATE_REQUEST: { text = "ERROR DUPLICATE REQUEST\n"; break; }
+            case Pinger::BatchStatus::NO_SERVER:         { text = "ERROR NO SERVER\n";         break; }
+            case Pinger::BatchStatus::ALREADY_DEFUNCT:   { text = "ERROR ALREADY DEFUNCT\n";   break; }
+            case Pinger::BatchStatus::CANCELLED:         { text = "ERROR CANCELLED\n";         break; }
+            default:                                     { text = "ERROR\n";                   break; }
+        }
+
+        sendReply(tag, QString(text));
+    }
+}
+
+
+void Connection::sendBatchResult(const QByteArray& statuses, unsigned long numberFailed, unsigned long tag) {
+    if (binary) {
+        QByteArray frame = newFrame(8 + static_cast<unsigned>(statuses.size()));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(statuses.size()));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(numberFailed));
+        frame.append(statuses);
+        sendFrame(frame, FrameType::BATCH_REPLY, tag);
+    } else {
+        sendReply(
+            tag,
+            QString("BATCH %1 %2 %3\n").arg(statuses.size()).arg(numberFailed).arg(QString::fromLatin1(statuses))
+        );
+    }
+}
+
+
+void Connection::sendSyncResult(
+        const QByteArray& statuses,
+        unsigned long     numberRemoved,
+        unsigned long     numberFailed,
+        unsigned long     tag
+    ) {
+    if (binary) {
+        QByteArray frame = newFrame(12 + static_cast<unsigned>(statuses.size()));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(statuses.size()));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(numberRemoved));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(numberFailed));
+        frame.append(statuses);
+        sendFrame(frame, FrameType::SYNC_REPLY, tag);
+    } else {
+        sendReply(
+            tag,
+            QString("SYNC %1 %2 %3 %4\n").arg(statuses.size())
+                                         .arg(numberRemoved)
+                                         .arg(numberFailed)
+                                         .arg(QString::fromLatin1(statuses))
+        );
+    }
+}
+
+
+void Connection::sendLatency(unsigned long hostId, const LatencyHistogram& latency) {
+    if (binary) {
+        QByteArray frame = newFrame(52);
+        appendUnsigned64(frame, hostId);
+        appendUnsigned32(frame, static_cast<std::uint32_t>(latency.numberSamples()));
+        appendUnsigned32(frame, toMicroseconds(latency.last()));
+        appendUnsigned32(frame, toMicroseconds(latency.minimum()));
+        appendUnsigned32(frame, toMicroseconds(latency.maximum()));
+        appendUnsigned32(frame, toMicroseconds(latency.average()));
+        appendUnsigned32(frame, toMicroseconds(latency.percentile(0.50)));
+        appendUnsigned32(frame, toMicroseconds(latency.percentile(0.90)));
+        appendUnsigned32(frame, toMicroseconds(latency.percentile(0.99)));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(latency.numberLosses()));
+        appendUnsigned32(frame, static_cast<std::uint32_t>(latency.lossRate() * 100.0 + 0.5));
+        appendUnsigned32(frame, toMicroseconds(latency.jitter()));
+        sendFrame(frame, FrameType::LATENCY_REPLY, requestTag);
+    } else {
+        QString message = QString("LATENCY %1").arg(hostId);
+        message += QString(" samples=%1").arg(latency.numberSamples());
+        message += QString(" last=%1").arg(latency.last(), 0, 'f', 3);
+        message += QString(" min=%1").arg(latency.minimum(), 0, 'f', 3);
+        message += QString(" max=%1").arg(latency.maximum(), 0, 'f', 3);
+        message += QString(" ewma=%1").arg(latency.average(), 0, 'f', 3);
+        message += QString(" p50=%1").arg(latency.percentile(0.50), 0, 'f', 3);
+        message += QString(" p90=%1").arg(latency.percentile(0.90), 0, 'f', 3);
+        message += QString(" p99=%1").arg(latency.percentile(0.99), 0, 'f', 3);
+        message += QString(" losses=%1").arg(latency.numberLosses());
+        message += QString(" loss_pct=%1").arg(latency.lossRate(), 0, 'f', 2);
+        message += QString(" jitter=%1").arg(latency.jitter(), 0, 'f', 3);
+        message += QString("\n");
+
+        sendMessage(message);
+    }
+}
+
+
+void Connection::sendEvent(const Event& event) {
+    queueOutput(binary ? event.frame : tagged ? event.taggedText : event.text);
+}
+
+
+Connection::Event Connection::noPingEvent(unsigned long hostId, const QByteArray& serverName) {
+    Event event;
+    event.text       = QString("NOPING %1 ").arg(hostId).toUtf8() + serverName + '\n';
+    event.taggedText = "* " + event.text;
+
+    event.frame = newFrame(8 + static_cast<unsigned>(serverName.size()));
+    appendUnsigned64(event.frame, hostId);
+    event.frame.append(serverName);
+    encodeFrameHeader(event.frame, FrameType::NOPING_REPLY, 0);
+
+    return event;
+}
+
+
+Connection::Event Connection::sequencedEvent(const EventLog::Entry& entry) {
+    const QByteArray& name   = entry.serverName;
+    const char*       kind   = entry.kind == EventLog::Kind::FAILED ? "NOPING" : "RECOVERED";
+    QString           prefix = QString("EVENT %1 %2 %3 ").arg(entry.sequence).arg(kind).arg(entry.hostId);
+
+    Event event;
+    event.text       = prefix.toUtf8() + name + '\n';
+    event.taggedText = "* " + event.text;
+
+    event.frame = newFrame(17 + static_cast<unsigned>(name.size()));
+    appendUnsigned64(event.frame, entry.sequence);
+    event.frame.append(char(entry.kind));
+    appendUnsigned64(event.frame, entry.hostId);
+    event.frame.append(name);
+    encodeFrameHeader(event.frame, FrameType::EVENT_REPLY, 0);
+
+    return event;
+}
+
+
+void Connection::sendResumed(
+        unsigned long numberReplayed,
+        unsigned long numberLost,
+        std::uint64_t lastSequence,
+        bool          reset
+    ) {
+    if (binary) {
+        QByteArray frame = newFrame(25);
+        appendUnsigned64(frame, numberReplayed);
+        appendUnsigned64(frame, numberLost);
+        appendUnsigned64(frame, lastSequence);
+        frame.append(char(reset ? 1 : 0));
+        sendFrame(frame, FrameType::RESUME_REPLY, requestTag);
+    } else {
+        sendMessage(
+            QString("RESUMED %1 %2 %3%4\n").arg(numberReplayed)
+                                           .arg(numberLost)
+                                           .arg(lastSequence)
+                                           .arg(reset ? " RESET" : "")
+        );
+    }
+}
+
+
+unsigned long Connection::queueDepth() const {
+    return static_cast<unsigned long>(outputBuffer.size()) + static_cast<unsigned long>(socket->bytesToWrite());
 }
 
 
 void Connection::sendMessage(const QString& message) {
-    QByteArray encoded = message.toUtf8();
-    socket->write(encoded);
+    sendReply(requestTag, message);
 }
 
 
 void Connection::readyRead() {
+    bool failed   = false;
+    bool received = true;
+
+    // The polling server may pipeline many commands in a single write so keep going until nothing complete remains.
+    // The framing is checked on every pass as a leading BINARY command switches framing for the rest of the stream.
+    while (!failed && !closing && received) {
+        requestTag = 0;
+        received   = binary ? receiveFrame() : receiveLine(failed);
+    }
+
+    requestTag = 0;
+}
+
+
+void Connection::readChannelFinished() {
+    pinger()->disconnect(this);
+}
+
+
+bool Connection::receiveLine(bool& failed) {
+    char line[maximumLineLength + 1];
+    bool received = false;
+
     if (socket->canReadLine()) {
-        char line[maximumLineLength + 1];
-        qint64 bytesRead = socket->readLine(line, maximumLineLength);
-        if (bytesRead >= 0) {
-            QString received = QString::fromUtf8(line);
-            processCommand(received.trimmed());
-        } else {
+        qint64 bytesRead = socket->readLine(line, sizeof(line));
+        if (bytesRead > 0) {
+            unsigned length     = static_cast<unsigned>(bytesRead);
+            bool     terminated = (line[length - 1] == '\n');
+
+            if (discarding) {
+                discarding = !terminated;
+            } else if (!terminated) {
+                // The line does not fit into the buffer.  Drop the remainder rather than treating it as a new command.
+                discarding = true;
+                sendMessage(QString("ERROR LINE TOO LONG\n"));
+            } else {
+                processCommand(line, length);
+            }
+
+            received = true;
+        } else if (bytesRead < 0) {
             std::cerr << "*** Failed to receive content: " << socket->errorString().toLocal8Bit().data() << std::endl;
+            failed = true;
         }
     }
+
+    return received;
 }
 
 
-void Connection::readChannelFinished() {
+bool Connection::receiveFrame() {
+    bool received = false;
+
+    if (socket->bytesAvailable() >= frameHeaderLength) {
+        char header[frameHeaderLength];
+        socket->peek(header, frameHeaderLength);
+
+        std::uint32_t payloadLength = qFromLittleEndian<std::uint32_t>(header);
+        if (payloadLength > maximumFrameLength) {
+            // There is no way to find the next frame boundary so give up on the connection.
+            std::cerr << "*** Received oversized frame (" << payloadLength << " bytes)" << std::endl;
+
+            sendStatus(Pinger::BatchStatus::MALFORMED);
+            closeAfterFlush();
+        } else if (socket->bytesAvailable() >= frameHeaderLength + payloadLength) {
+            socket->read(header, frameHeaderLength);
+
+            frameBuffer.resize(static_cast<int>(payloadLength));
+            socket->read(frameBuffer.data(), payloadLength);
+
+            FrameType frameType = static_cast<FrameType>(static_cast<std::uint8_t>(header[4]));
+            requestTag          = qFromLittleEndian<std::uint32_t>(header + 5);
+
+            processFrame(frameType, frameBuffer.constData(), payloadLength);
+            received = true;
+        }
+    }
+
+    return received;
+}
+
+
+unsigned Connection::extractTag(const char* line, unsigned length, bool& valid) {
+    unsigned start = 0;
+    while (start < length && std::isspace(static_cast<unsigned char>(line[start]))) {
+        ++start;
+    }
+
+    unsigned consumed = 0;
+    if (start < length && line[start] == '#') {
+        unsigned end = start + 1;
+        while (end < length && !std::isspace(static_cast<unsigned char>(line[end]))) {
+            ++end;
+        }
+
+        unsigned long tag;
+        if (toUnsignedLong(QLatin1String(line + start + 1, static_cast<int>(end - start - 1)), tag) && tag > 0) {
+            requestTag = tag;
+            tagged     = true;
+            consumed   = end;
+        } else {
+            valid = false;
+        }
+    }
+
+    return consumed;
+}
+
+
+void Connection::closeAfterFlush() {
+    flushOutput();
+
+    closing = true;
     pinger()->disconnect(this);
 }
 
 
-void Connection::processCommand(const QString& received) {
-    QStringList arguments = received.split(QChar(' '), QString::SplitBehavior::SkipEmptyParts);
-    if (arguments.size() > 0) {
-        const QString& command = arguments.at(0);
-        if (command == QString("A") && arguments.size() == 3) {
-            bool          success;
-            unsigned long hostId = arguments.at(1).toULong(&success);
-            if (success && hostId > 0) {
-                const QString& serverName = arguments.at(2);
+void Connection::processCommand(const char* line, unsigned length) {
+    bool validTag = true;
+    if (batchMode == BatchMode::NONE) {
+        unsigned tagLength = extractTag(line, length, validTag);
+
+        line   += tagLength;
+        length -= tagLength;
+    }
+
+    QLatin1String arguments[maximumArguments];
+    unsigned      numberArguments = splitArguments(line, length, arguments);
+
+    // Framing can only be negotiated before anything else so that no earlier reply or pipelined command is framed
+    // differently from what the client expects.
+    bool firstCommand = !started;
+    started           = true;
+
+    if (batchMode != BatchMode::NONE) {
+        processBatchLine(arguments, numberArguments);
+    } else if (!validTag || numberArguments > maximumArguments) {
+        sendError(line, length);
+    } else if (numberArguments > 0) {
+        QLatin1String command = arguments[0];
+        if (command == QLatin1String("A") && numberArguments == 3) {
+            unsigned long hostId;
+            if (toUnsignedLong(arguments[1], hostId) && hostId > 0) {
+                QString serverName = QString::fromUtf8(arguments[2].data(), arguments[2].size());
                 pinger()->addServer(hostId, serverName, this);
             } else {
-                sendMessage("ERROR " + received + "\n");
+                sendError(line, length);
             }
-        } else if (command == QString("R") && arguments.size() == 2) {
-            bool          success;
-            unsigned long hostId = arguments.at(1).toULong(&success);
-            if (success && hostId > 0) {
+        } else if (command == QLatin1String("R") && numberArguments == 2) {
+            unsigned long hostId;
+            if (toUnsignedLong(arguments[1], hostId) && hostId > 0) {
                 pinger()->removeServer(hostId, this);
             } else {
-                sendMessage("ERROR " + received + "\n");
+                sendError(line, length);
             }
-        } else if (command == QString("D") && arguments.size() == 2) {
-            bool          success;
-            unsigned long hostId = arguments.at(1).toULong(&success);
-            if (success && hostId > 0) {
+        } else if (command == QLatin1String("D") && numberArguments == 2) {
+            unsigned long hostId;
+            if (toUnsignedLong(arguments[1], hostId) && hostId > 0) {
                 pinger()->markDefunct(hostId, this);
             } else {
-                sendMessage("ERROR " + received + "\n");
+                sendError(line, length);
             }
-        } else if (command == QString("Q") && arguments.size() == 1) {
+        } else if (command == QLatin1String("I") && numberArguments == 3) {
+            unsigned long hostId;
+            unsigned long interval;
+            if (toUnsignedLong(arguments[1], hostId)                                           &&
+                hostId > 0                                                                     &&
+                toUnsignedLong(arguments[2], interval)                                         &&
+                (interval == 0 || interval >= Pinger::minimumPingInterval)                        ) {
+                pinger()->setServerInterval(hostId, interval, this);
+            } else {
+                sendError(line, length);
+            }
+        } else if (command == QLatin1String("L") && numberArguments == 2) {
+            unsigned long hostId;
+            if (toUnsignedLong(arguments[1], hostId) && hostId > 0) {
+                pinger()->reportLatency(hostId, this);
+            } else {
+                sendError(line, length);
+            }
+        } else if (command == QLatin1String("SUB") && numberArguments == 2) {
+            if (arguments[1] == QLatin1String("ALL")) {
+                pinger()->subscribe(Pinger::Subscription::ALL, 0, 0, this);
+            } else if (arguments[1] == QLatin1String("OWN")) {
+                pinger()->subscribe(Pinger::Subscription::OWN, 0, 0, this);
+            } else if (arguments[1] == QLatin1String("NONE")) {
+                pinger()->subscribe(Pinger::Subscription::NONE, 0, 0, this);
+            } else {
+                sendError(line, length);
+            }
+        } else if (   command == QLatin1String("SUB")
+                   && numberArguments == 3
+                   && arguments[1] == QLatin1String("OWN")
+                  ) {
+            QByteArray clientName(arguments[2].data(), arguments[2].size());
+            pinger()->subscribe(Pinger::Subscription::OWN, 0, 0, this, clientName);
+        } else if (command == QLatin1String("SUB") && numberArguments == 3) {
+            unsigned long firstId;
+            unsigned long lastId;
+            if (toUnsignedLong(arguments[1], firstId) && toUnsignedLong(arguments[2], lastId) && firstId <= lastId) {
+                pinger()->subscribe(Pinger::Subscription::RANGE, firstId, lastId, this);
+            } else {
+                sendError(line, length);
+            }
+        } else if (command == QLatin1String("RESUME") && numberArguments == 2) {
+            unsigned long lastSequence;
+            if (toUnsignedLong(arguments[1], lastSequence)) {
+                pinger()->resumeEvents(lastSequence, this);
+            } else {
+                sendError(line, length);
+            }
+        } else if (command == QLatin1String("BA") && numberArguments == 1) {
+            batchMode = BatchMode::ADD;
+            batchTag  = requestTag;
+        } else if (command == QLatin1String("BR") && numberArguments == 1) {
+            batchMode = BatchMode::REMOVE;
+            batchTag  = requestTag;
+        } else if (command == QLatin1String("BD") && numberArguments == 1) {
+            batchMode = BatchMode::DEFUNCT;
+            batchTag  = requestTag;
+        } else if (command == QLatin1String("SYNC") && numberArguments == 1) {
+            batchMode = BatchMode::SYNC;
+            batchTag  = requestTag;
+        } else if (command == QLatin1String("BINARY") && numberArguments == 1 && firstCommand) {
+            sendMessage(QString("OK BINARY\n"));
+            binary = true;
+        } else if (command == QLatin1String("S") && numberArguments == 1) {
+            pinger()->reportStatistics(this);
+        } else if (command == QLatin1String("Q") && numberArguments == 1) {
             sendMessage("DISCONNECTING\n");
-            socket->waitForBytesWritten();
-
-            pinger()->disconnect(this);
-        } else if (command == QString("!SHUTDOWN!") && arguments.size() == 1) {
+            closeAfterFlush();
+        } else if (command == QLatin1String("!SHUTDOWN!") && numberArguments == 1) {
             sendMessage("SHUTTING DOWN\n");
-            socket->waitForBytesWritten();
+            flushOutput();
+
+            // Quit once the reply has been written rather than waiting for the remote side here.
+            closing = true;
+            connect(socket, &QLocalSocket::disconnected, QCoreApplication::instance(), &QCoreApplication::quit);
+            QTimer::singleShot(closeTimeout, QCoreApplication::instance(), &QCoreApplication::quit);
+            socket->disconnectFromServer();
+        } else {
+            sendError(line, length);
+        }
+    }
+}
+
+
+void Connection::processBatchLine(const QLatin1String* arguments, unsigned numberArguments) {
+    if (numberArguments == 1 && arguments[0] == QLatin1String("END")) {
+        finishBatch();
+    } else if (numberArguments > 0) {
+        if (batchItems.size() < maximumBatchItems) {
+            Pinger::BatchItem item;
+            item.hostId = 0;
+
+            bool          named             = (batchMode == BatchMode::ADD || batchMode == BatchMode::SYNC);
+            unsigned      expectedArguments = (named ? 2 : 1);
+            unsigned long hostId;
+            if (numberArguments == expectedArguments && toUnsignedLong(arguments[0], hostId) && hostId > 0) {
+                item.hostId = hostId;
+                if (named) {
+                    item.serverName = QString::fromUtf8(arguments[1].data(), arguments[1].size());
+                }
+            }
+
+            batchItems.append(item);
+        } else {
+            batchOverflow = true;
+        }
+    }
+}
+
+
+void Connection::finishBatch() {
+    requestTag = batchTag;
+
+    if (batchOverflow) {
+        sendMessage(QString("ERROR BATCH TOO LARGE\n"));
+    } else if (batchMode == BatchMode::ADD) {
+        pinger()->addServers(batchItems, this);
+    } else if (batchMode == BatchMode::REMOVE) {
+        pinger()->removeServers(batchItems, this);
+    } else if (batchMode == BatchMode::SYNC) {
+        pinger()->syncServers(batchItems, this);
+    } else {
+        pinger()->markServersDefunct(batchItems, this);
+    }
+
+    batchItems.clear();
+    batchMode     = BatchMode::NONE;
+    batchOverflow = false;
+}
+
 
-            QCoreApplication::quit();
+void Connection::processFrame(FrameType frameType, const char* payload, unsigned length) {
+    unsigned long hostId = length >= 8 ? static_cast<unsigned long>(qFromLittleEndian<std::uint64_t>(payload)) : 0;
+
+    switch (frameType) {
+        case FrameType::ADD: {
+            if (hostId > 0 && length > 8) {
+                QString serverName = QString::fromUtf8(payload + 8, static_cast<int>(length - 8));
+                pinger()->addServer(hostId, serverName, this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::REMOVE: {
+            if (hostId > 0 && length == 8) {
+                pinger()->removeServer(hostId, this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::DEFUNCT: {
+            if (hostId > 0 && length == 8) {
+                pinger()->markDefunct(hostId, this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::INTERVAL: {
+            unsigned long interval = length == 12 ? qFromLittleEndian<std::uint32_t>(payload + 8) : 1;
+            if (hostId > 0 && length == 12 && (interval == 0 || interval >= Pinger::minimumPingInterval)) {
+                pinger()->setServerInterval(hostId, interval, this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::LATENCY: {
+            if (hostId > 0 && length == 8) {
+                pinger()->reportLatency(hostId, this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::STATISTICS: {
+            pinger()->reportStatistics(this);
+            break;
+        }
+
+        case FrameType::QUIT: {
+            sendStatus(Pinger::BatchStatus::OK);
+            closeAfterFlush();
+
+            break;
+        }
+
+        case FrameType::SUBSCRIBE: {
+            Pinger::Subscription subscription = static_cast<Pinger::Subscription>(
+                length > 0 ? static_cast<std::uint8_t>(payload[0]) : 0xFF
+            );
+            if (length == 1 && subscription <= Pinger::Subscription::OWN) {
+                pinger()->subscribe(subscription, 0, 0, this);
+            } else if (length > 1 && subscription == Pinger::Subscription::OWN) {
+                QByteArray clientName(payload + 1, static_cast<int>(length - 1));
+                pinger()->subscribe(subscription, 0, 0, this, clientName);
+            } else if (length == 17 && subscription == Pinger::Subscription::RANGE) {
+                unsigned long firstId = static_cast<unsigned long>(qFromLittleEndian<std::uint64_t>(payload + 1));
+                unsigned long lastId  = static_cast<unsigned long>(qFromLittleEndian<std::uint64_t>(payload + 9));
+                if (firstId <= lastId) {
+                    pinger()->subscribe(subscription, firstId, lastId, this);
+                } else {
+                    sendStatus(Pinger::BatchStatus::MALFORMED);
+                }
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::RESUME: {
+            if (length == 8) {
+                pinger()->resumeEvents(qFromLittleEndian<std::uint64_t>(payload), this);
+            } else {
+                sendStatus(Pinger::BatchStatus::MALFORMED);
+            }
+
+            break;
+        }
+
+        case FrameType::BATCH_ADD:     { processBatchFrame(BatchMode::ADD, payload, length);       break; }
+        case FrameType::BATCH_REMOVE:  { processBatchFrame(BatchMode::REMOVE, payload, length);    break; }
+        case FrameType::BATCH_DEFUNCT: { processBatchFrame(BatchMode::DEFUNCT, payload, length);   break; }
+        case FrameType::SYNC:          { processBatchFrame(BatchMode::SYNC, payload, length);      break; }
+
+        default: {
+            sendStatus(Pinger::BatchStatus::MALFORMED);
+            break;
+        }
+    }
+}
+
+
+void Connection::processBatchFrame(BatchMode mode, const char* payload, unsigned length) {
+    bool     named       = (mode == BatchMode::ADD || mode == BatchMode::SYNC);
+    bool     valid       = (length >= 4);
+    unsigned numberItems = valid ? qFromLittleEndian<std::uint32_t>(payload) : 0;
+    unsigned offset      = 4;
+
+    if (numberItems > static_cast<unsigned>(maximumBatchItems)) {
+        batchOverflow = true;
+    } else {
+        batchItems.reserve(static_cast<int>(numberItems));
+        for (unsigned index=0 ; valid && index<numberItems ; ++index) {
+            Pinger::BatchItem item;
+
+            valid = (length - offset >= 8);
+            if (valid) {
+                item.hostId  = static_cast<unsigned long>(qFromLittleEndian<std::uint64_t>(payload + offset));
+                offset      += 8;
+
+                if (named) {
+                    valid = (length - offset >= 2);
+                    if (valid) {
+                        unsigned nameLength  = qFromLittleEndian<std::uint16_t>(payload + offset);
+                        offset              += 2;
+
+                        valid = (length - offset >= nameLength);
+                        if (valid) {
+                            item.serverName  = QString::fromUtf8(payload + offset, static_cast<int>(nameLength));
+                            offset          += nameLength;
+
+                            if (nameLength == 0) {
+                                item.hostId = 0;
+                            }
+                        }
+                    }
+                }
+
+                batchItems.append(item);
+            }
+        }
+    }
+
+    if (batchOverflow || (valid && offset == length)) {
+        batchMode = mode;
+        batchTag  = requestTag;
+        finishBatch();
+    } else {
+        batchItems.clear();
+        sendStatus(Pinger::BatchStatus::MALFORMED);
+    }
+}
+
+
+void Connection::sendReply(unsigned long tag, const QString& message) {
+    QByteArray encoded = message.toUtf8();
+    if (binary) {
+        QByteArray frame = newFrame(static_cast<unsigned>(encoded.size()));
+        frame.append(encoded);
+        sendFrame(frame, FrameType::TEXT_REPLY, tag);
+    } else if (tag != 0) {
+        queueOutput(QString("#%1 ").arg(tag).toUtf8() + encoded);
+    } else {
+        queueOutput(encoded);
+    }
+}
+
+
+void Connection::sendFrame(QByteArray& frame, FrameType type, unsigned long tag) {
+    encodeFrameHeader(frame, type, tag);
+    queueOutput(frame);
+}
+
+
+void Connection::queueOutput(const QByteArray& data) {
+    if (!closing) {
+        if (outputBuffer.isEmpty()) {
+            outputBuffer = data;
+        } else {
+            outputBuffer.append(data);
+        }
+
+        unsigned long outputLimit = pinger()->outputLimit();
+        if (outputLimit > 0 && queueDepth() > outputLimit) {
+            // The remote side is not keeping up.  Stop queueing and drop the connection rather than growing without
+            // bound.  The client is expected to reconnect and resynchronize.
+            closing = true;
+            dropped = true;
+            outputBuffer.clear();
+
+            pinger()->dropSlowConsumer(this);
+        } else if (!flushScheduled) {
+            flushScheduled = true;
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    flushOutput();
+                },
+                Qt::QueuedConnection
+            );
+        }
+    }
+}
+
+
+void Connection::flushOutput() {
+    flushScheduled = false;
+
+    if (!outputBuffer.isEmpty()) {
+        socket->write(outputBuffer);
+        bytesWritten += static_cast<unsigned long>(outputBuffer.size());
+
+        outputBuffer.clear();
+    }
+}
+
+
+void Connection::encodeFrameHeader(QByteArray& frame, FrameType type, unsigned long tag) {
+    qToLittleEndian<std::uint32_t>(static_cast<std::uint32_t>(frame.size() - frameHeaderLength), frame.data());
+    frame[4] = char(type);
+    qToLittleEndian<std::uint32_t>(static_cast<std::uint32_t>(tag), frame.data() + 5);
+}
+
+
+QByteArray Connection::newFrame(unsigned payloadLength) {
+    QByteArray frame;
+    frame.reserve(static_cast<int>(frameHeaderLength + payloadLength));
+    frame.resize(frameHeaderLength);
+
+    return frame;
+}
+
+
+void Connection::appendUnsigned32(QByteArray& frame, std::uint32_t value) {
+    char buffer[4];
+    qToLittleEndian<std::uint32_t>(value, buffer);
+    frame.append(buffer, 4);
+}
+
+
+void Connection::appendUnsigned64(QByteArray& frame, std::uint64_t value) {
+    char buffer[8];
+    qToLittleEndian<std::uint64_t>(value, buffer);
+    frame.append(buffer, 8);
+}
+
+
+std::uint32_t Connection::toMicroseconds(double milliseconds) {
+    double        microseconds = std::round(1000.0 * milliseconds);
+    std::uint32_t limit        = std::numeric_limits<std::uint32_t>::max();
+
+    return   microseconds <= 0     ? 0
+           : microseconds >= limit ? limit
+           : static_cast<std::uint32_t>(microseconds);
+}
+
+
+void Connection::sendError(const char* line, unsigned length) {
+    unsigned start = 0;
+    while (start < length && std::isspace(static_cast<unsigned char>(line[start]))) {
+        ++start;
+    }
+
+    while (length > start && std::isspace(static_cast<unsigned char>(line[length - 1]))) {
+        --length;
+    }
+
+    sendMessage("ERROR " + QString::fromUtf8(line + start, static_cast<int>(length - start)) + "\n");
+}
+
+
+unsigned Connection::splitArguments(const char* line, unsigned length, QLatin1String* arguments) {
+    unsigned numberArguments = 0;
+    unsigned index           = 0;
+
+    while (index < length) {
+        while (index < length && std::isspace(static_cast<unsigned char>(line[index]))) {
+            ++index;
+        }
+
+        if (index < length) {
+            unsigned start = index;
+            while (index < length && !std::isspace(static_cast<unsigned char>(line[index]))) {
+                ++index;
+            }
+
+            if (numberArguments < maximumArguments) {
+                arguments[numberArguments] = QLatin1String(line + start, static_cast<int>(index - start));
+            }
+
+            ++numberArguments;
+        }
+    }
+
+    return numberArguments;
+}
+
+
+bool Connection::toUnsignedLong(QLatin1String argument, unsigned long& value) {
+    const char*   digits  = argument.data();
+    int           length  = argument.size();
+    bool          success = (length > 0);
+    unsigned long result  = 0;
+
+    for (int i=0 ; success && i<length ; ++i) {
+        char c = digits[i];
+        if (c >= '0' && c <= '9') {
+            unsigned long digit = static_cast<unsigned long>(c - '0');
+            if (result <= (std::numeric_limits<unsigned long>::max() - digit) / 10) {
+                result = 10 * result + digit;
+            } else {
+                success = false;
+            }
         } else {
-            sendMessage("ERROR " + received + "\n");
+            success = false;
         }
     }
+
+    value = result;
+    return success;
 }
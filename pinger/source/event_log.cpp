@@ -0,0 +1,75 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref EventLog class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QVector>
+#include <QDateTime>
+
+#include <cstdint>
+
+#include "event_log.h"
+
+EventLog::EventLog(unsigned capacity) {
+    entries.resize(static_cast<int>(capacity > 0 ? capacity : 1));
+    numberEntries = 0;
+
+    std::uint64_t epoch = static_cast<std::uint64_t>(QDateTime::currentMSecsSinceEpoch()) & 0xFFFFFFU;
+    if (epoch == 0) {
+        epoch = 1;
+    }
+
+    nextSequence = (epoch << epochShift) | 1;
+}
+
+
+const EventLog::Entry& EventLog::append(Kind kind, unsigned long hostId, const QByteArray& serverName) {
+    Entry& entry = entries[static_cast<int>(nextSequence % static_cast<unsigned>(entries.size()))];
+    entry.sequence   = nextSequence;
+    entry.hostId     = hostId;
+    entry.serverName = serverName;
+    entry.kind       = kind;
+
+    ++nextSequence;
+    if (numberEntries < static_cast<unsigned>(entries.size())) {
+        ++numberEntries;
+    }
+
+    return entry;
+}
+
+
+std::uint64_t EventLog::firstSequence() const {
+    return nextSequence - numberEntries;
+}
+
+
+std::uint64_t EventLog::lastSequence() const {
+    return nextSequence - 1;
+}
+
+
+const EventLog::Entry& EventLog::entry(std::uint64_t sequence) const {
+    return entries.at(static_cast<int>(sequence % static_cast<unsigned>(entries.size())));
+}
+
+
+bool EventLog::isIssued(std::uint64_t sequence) const {
+    return (sequence >> epochShift) == (nextSequence >> epochShift) && sequence < nextSequence;
+}
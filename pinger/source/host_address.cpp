@@ -0,0 +1,134 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref HostAddress class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "host_address.h"
+
+HostAddress::HostAddress(const struct sockaddr* address, socklen_t length) {
+    std::memset(&currentAddress, 0, sizeof(currentAddress));
+
+    if ((address->sa_family == AF_INET && length >= sizeof(struct sockaddr_in))    ||
+        (address->sa_family == AF_INET6 && length >= sizeof(struct sockaddr_in6))    ) {
+        currentLength = std::min(length, static_cast<socklen_t>(sizeof(currentAddress)));
+        std::memcpy(&currentAddress, address, currentLength);
+    } else {
+        currentLength = 0;
+    }
+}
+
+
+bool HostAddress::matches(const struct sockaddr* address) const {
+    bool result;
+
+    if (address->sa_family != currentAddress.ss_family) {
+        result = false;
+    } else if (address->sa_family == AF_INET) {
+        const struct sockaddr_in* a = reinterpret_cast<const struct sockaddr_in*>(address);
+        const struct sockaddr_in* b = reinterpret_cast<const struct sockaddr_in*>(&currentAddress);
+        result = (a->sin_addr.s_addr == b->sin_addr.s_addr);
+    } else if (address->sa_family == AF_INET6) {
+        const struct sockaddr_in6* a = reinterpret_cast<const struct sockaddr_in6*>(address);
+        const struct sockaddr_in6* b = reinterpret_cast<const struct sockaddr_in6*>(&currentAddress);
+        result = (std::memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(struct in6_addr)) == 0);
+    } else {
+        result = false;
+    }
+
+    return result;
+}
+
+
+QString HostAddress::toString() const {
+    QString result;
+
+    if (currentLength > 0) {
+        char buffer[NI_MAXHOST];
+        int status = getnameinfo(socketAddress(), currentLength, buffer, sizeof(buffer), nullptr, 0, NI_NUMERICHOST);
+        if (status == 0) {
+            result = QString::fromLatin1(buffer);
+        }
+    }
+
+    return result;
+}
+
+
+HostAddress HostAddress::resolve(const QString& hostName, QString* errorMessage) {
+    HostAddress result;
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_RAW;
+    hints.ai_flags    = AI_ADDRCONFIG;
+
+    struct addrinfo* addressList = nullptr;
+    int status = getaddrinfo(hostName.toUtf8().data(), nullptr, &hints, &addressList);
+    if (status == 0) {
+        for (struct addrinfo* entry=addressList ; entry!=nullptr && result.isNull() ; entry=entry->ai_next) {
+            if (entry->ai_family == AF_INET || entry->ai_family == AF_INET6) {
+                result = HostAddress(entry->ai_addr, entry->ai_addrlen);
+            }
+        }
+
+        freeaddrinfo(addressList);
+
+        if (result.isNull() && errorMessage != nullptr) {
+            *errorMessage = QString("No usable address");
+        }
+    } else if (errorMessage != nullptr) {
+        *errorMessage = QString::fromLocal8Bit(gai_strerror(status));
+    }
+
+    return result;
+}
+
+
+HostAddress HostAddress::fromLiteral(const QString& hostName) {
+    HostAddress result;
+    QByteArray  name = hostName.toLatin1();
+
+    struct sockaddr_in ipv4Address;
+    std::memset(&ipv4Address, 0, sizeof(ipv4Address));
+    if (inet_pton(AF_INET, name.data(), &ipv4Address.sin_addr) == 1) {
+        ipv4Address.sin_family = AF_INET;
+        result = HostAddress(reinterpret_cast<const struct sockaddr*>(&ipv4Address), sizeof(ipv4Address));
+    } else {
+        struct sockaddr_in6 ipv6Address;
+        std::memset(&ipv6Address, 0, sizeof(ipv6Address));
+        if (inet_pton(AF_INET6, name.data(), &ipv6Address.sin6_addr) == 1) {
+            ipv6Address.sin6_family = AF_INET6;
+            result = HostAddress(reinterpret_cast<const struct sockaddr*>(&ipv6Address), sizeof(ipv6Address));
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,201 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref HostTable class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "server_data.h"
+#include "latency_histogram.h"
+#include "status_table.h"
+#include "host_table.h"
+
+/**
+ * Approximate cost of a single hash table entry beyond its key and value, in bytes.
+ */
+static constexpr std::size_t hashEntryOverhead = 24;
+
+/**
+ * Approximate cost of a heap allocated byte array beyond its contents, in bytes.
+ */
+static constexpr std::size_t byteArrayOverhead = 25;
+
+HostTable::HostTable() {
+    nameBytes = 0;
+}
+
+
+HostTable::Handle HostTable::insert(unsigned long hostId, const QString& serverName) {
+    Handle handle;
+    if (!freeHandles.isEmpty()) {
+        handle = freeHandles.takeLast();
+    } else {
+        handle = static_cast<Handle>(ids.size());
+
+        ids.append(0);
+        generations.append(0);
+        statuses.append(ServerData::Status::UNTESTED);
+        statusSlots.append(StatusTable::noSlot);
+        nameIds.append(0);
+        histogramIds.append(noHistogram);
+    }
+
+    ids[static_cast<int>(handle)]          = hostId;
+    statuses[static_cast<int>(handle)]     = ServerData::Status::UNTESTED;
+    statusSlots[static_cast<int>(handle)]  = StatusTable::noSlot;
+    nameIds[static_cast<int>(handle)]      = internName(serverName);
+    histogramIds[static_cast<int>(handle)] = noHistogram;
+
+    index.insert(hostId, handle);
+    return handle;
+}
+
+
+void HostTable::erase(Handle handle) {
+    index.remove(ids.at(static_cast<int>(handle)));
+    releaseName(nameIds.at(static_cast<int>(handle)));
+
+    unsigned histogramId = histogramIds.at(static_cast<int>(handle));
+    if (histogramId != noHistogram) {
+        freeHistograms.append(histogramId);
+    }
+
+    ids[static_cast<int>(handle)]          = 0;
+    ++generations[static_cast<int>(handle)];
+    statusSlots[static_cast<int>(handle)]  = StatusTable::noSlot;
+    histogramIds[static_cast<int>(handle)] = noHistogram;
+
+    freeHandles.append(handle);
+}
+
+
+void HostTable::addSample(Handle handle, double latency) {
+    unsigned histogramId = histogramIds.at(static_cast<int>(handle));
+    if (histogramId == noHistogram) {
+        if (!freeHistograms.isEmpty()) {
+            histogramId = freeHistograms.takeLast();
+            histograms[static_cast<int>(histogramId)].clear();
+        } else {
+            histogramId = static_cast<unsigned>(histograms.size());
+            histograms.append(LatencyHistogram());
+        }
+
+        histogramIds[static_cast<int>(handle)] = histogramId;
+    }
+
+    histograms[static_cast<int>(histogramId)].addSample(latency);
+}
+
+
+bool HostTable::isNamed(Handle handle, const QString& serverName) const {
+    const QByteArray& name   = names.at(static_cast<int>(nameIds.at(static_cast<int>(handle))));
+    int               length = serverName.size();
+    bool              ascii  = true;
+    bool              equal  = (name.size() >= length);
+
+    for (int i=0 ; ascii && equal && i<length ; ++i) {
+        unsigned character = serverName.at(i).unicode();
+        ascii = (character < 0x80 && static_cast<unsigned char>(name.at(i)) < 0x80);
+        equal = (character == static_cast<unsigned char>(name.at(i)));
+    }
+
+    if (!ascii) {
+        equal = (QString::fromUtf8(name) == serverName);
+    } else if (equal) {
+        equal = (name.size() == length);
+    }
+
+    return equal;
+}
+
+
+const LatencyHistogram& HostTable::latency(Handle handle) const {
+    static const LatencyHistogram emptyHistogram;
+
+    unsigned histogramId = histogramIds.at(static_cast<int>(handle));
+    return histogramId != noHistogram ? histograms.at(static_cast<int>(histogramId)) : emptyHistogram;
+}
+
+
+std::size_t HostTable::memoryUsage() const {
+    std::size_t perHandle = (
+          sizeof(unsigned long)
+        + sizeof(std::uint32_t)
+        + sizeof(ServerData::Status)
+        + 3 * sizeof(unsigned)
+    );
+    std::size_t perName   = sizeof(QByteArray) + sizeof(unsigned) + byteArrayOverhead;
+
+    return (
+          perHandle * static_cast<std::size_t>(ids.capacity())
+        + sizeof(Handle) * static_cast<std::size_t>(freeHandles.capacity())
+        + (sizeof(unsigned long) + sizeof(Handle) + hashEntryOverhead) * static_cast<std::size_t>(index.size())
+        + sizeof(LatencyHistogram) * static_cast<std::size_t>(histograms.capacity())
+        + sizeof(unsigned) * static_cast<std::size_t>(freeHistograms.capacity())
+        + perName * static_cast<std::size_t>(names.capacity())
+        + (sizeof(QByteArray) + sizeof(unsigned) + hashEntryOverhead) * static_cast<std::size_t>(nameIndex.size())
+        + sizeof(unsigned) * static_cast<std::size_t>(freeNames.capacity())
+        + nameBytes
+    );
+}
+
+
+unsigned HostTable::internName(const QString& serverName) {
+    QByteArray utf8Name = serverName.toUtf8();
+    unsigned   nameId   = nameIndex.value(utf8Name, static_cast<unsigned>(names.size()));
+
+    if (nameId < static_cast<unsigned>(names.size())) {
+        ++nameReferences[static_cast<int>(nameId)];
+    } else {
+        if (!freeNames.isEmpty()) {
+            nameId = freeNames.takeLast();
+            names[static_cast<int>(nameId)]          = utf8Name;
+            nameReferences[static_cast<int>(nameId)] = 1;
+        } else {
+            names.append(utf8Name);
+            nameReferences.append(1);
+        }
+
+        // The index key shares its data with the stored name.
+        nameIndex.insert(utf8Name, nameId);
+        nameBytes += static_cast<std::size_t>(utf8Name.size()) + 1;
+    }
+
+    return nameId;
+}
+
+
+void HostTable::releaseName(unsigned nameId) {
+    unsigned& references = nameReferences[static_cast<int>(nameId)];
+    --references;
+    if (references == 0) {
+        QByteArray& name = names[static_cast<int>(nameId)];
+        nameBytes -= static_cast<std::size_t>(name.size()) + 1;
+
+        nameIndex.remove(name);
+        name.clear();
+
+        freeNames.append(nameId);
+    }
+}
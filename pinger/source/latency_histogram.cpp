@@ -0,0 +1,149 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref LatencyHistogram class.
+***********************************************************************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+
+void LatencyHistogram::addSample(double latency) {
+    if (latency >= 0) {
+        double        microseconds = latency * 1000.0 + 0.5;
+        std::uint32_t limit        = (1U << maximumExponent) - 1;
+        std::uint32_t value        = microseconds < limit ? static_cast<std::uint32_t>(microseconds) : limit;
+
+        std::uint16_t& count = counts[bucketFor(value)];
+        if (count == std::numeric_limits<std::uint16_t>::max()) {
+            total = 0;
+            for (unsigned i=0 ; i<numberBuckets ; ++i) {
+                counts[i] /= 2;
+                total     += counts[i];
+            }
+        }
+
+        ++count;
+        ++total;
+
+        float sample = static_cast<float>(latency);
+        if (samples == 0) {
+            minimumLatency = sample;
+            maximumLatency = sample;
+            averageLatency = sample;
+        } else {
+            minimumLatency  = std::min(minimumLatency, sample);
+            maximumLatency  = std::max(maximumLatency, sample);
+            averageLatency += (sample - averageLatency) / 8.0F;
+            jitterEstimate += (std::fabs(sample - lastLatency) - jitterEstimate) / 16.0F;
+        }
+
+        lastLatency  = sample;
+        lossAverage -= lossAverage / 16.0F;
+        if (samples < std::numeric_limits<std::uint32_t>::max()) {
+            ++samples;
+        }
+    } else {
+        lossAverage += (1.0F - lossAverage) / 16.0F;
+        if (losses < std::numeric_limits<std::uint32_t>::max()) {
+            ++losses;
+        }
+    }
+}
+
+
+void LatencyHistogram::clear() {
+    std::memset(counts, 0, sizeof(counts));
+
+    total          = 0;
+    samples        = 0;
+    lastLatency    = 0;
+    minimumLatency = 0;
+    maximumLatency = 0;
+    averageLatency = 0;
+    losses         = 0;
+    lossAverage    = 0;
+    jitterEstimate = 0;
+}
+
+
+double LatencyHistogram::percentile(double fraction) const {
+    double result = 0;
+
+    if (total > 0) {
+        double        target = std::max(1.0, std::min(1.0, fraction) * total);
+        std::uint32_t seen   = 0;
+        unsigned      bucket = 0;
+
+        while (bucket + 1 < numberBuckets && seen + counts[bucket] < target) {
+            seen += counts[bucket];
+            ++bucket;
+        }
+
+        if (bucket + 1 < numberBuckets) {
+            double value = bucketValue(bucket) / 1000.0;
+            result       = std::max<double>(minimumLatency, std::min<double>(maximumLatency, value));
+        } else {
+            // The last bucket is open ended.
+            result = maximumLatency;
+        }
+    }
+
+    return result;
+}
+
+
+unsigned LatencyHistogram::bucketFor(std::uint32_t value) {
+    unsigned result;
+
+    if (value < 2 * subBuckets) {
+        result = value;
+    } else {
+        unsigned exponent  = 31U - static_cast<unsigned>(__builtin_clz(value));
+        unsigned subBucket = (value >> (exponent - subBucketBits)) & (subBuckets - 1);
+
+        result = (exponent - subBucketBits + 1) * subBuckets + subBucket;
+    }
+
+    return result;
+}
+
+
+std::uint32_t LatencyHistogram::bucketValue(unsigned bucket) {
+    std::uint32_t result;
+
+    if (bucket < 2 * subBuckets) {
+        result = bucket;
+    } else {
+        unsigned      exponent  = bucket / subBuckets + subBucketBits - 1;
+        unsigned      subBucket = bucket % subBuckets;
+        std::uint32_t width     = 1U << (exponent - subBucketBits);
+
+        result = (subBuckets + subBucket) * width + width / 2;
+    }
+
+    return result;
+}
@@ -21,9 +21,12 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QStringList>
 
 #include <iostream>
 
+#include "ping_engine.h"
+#include "status_table.h"
 #include "pinger.h"
 
 int main(int argumentCount, char* argumentValues[]) {
@@ -33,16 +36,298 @@ int main(int argumentCount, char* argumentValues[]) {
     QCoreApplication::setApplicationName("Inesonic Ping Server");
     QCoreApplication::setApplicationVersion("1.0");
 
-    if (argumentCount == 2) {
-        QString connectionName = QString::fromLocal8Bit(argumentValues[1]);
-        Pinger pinger;
+    QCommandLineParser parser;
+    QCommandLineOption resolverThreadsOption(
+        QStringList() << "r" << "resolver-threads",
+        QString("Maximum number of concurrent host name lookups."),
+        QString("count")
+    );
 
-        bool success = pinger.start(connectionName);
-        if (success) {
-            exitStatus = application.exec();
-        } else {
-            std::cerr << "*** Failed to connect to socket " << connectionName.toLocal8Bit().data() << std::endl;
+    QCommandLineOption shardsOption(
+        QStringList() << "s" << "shards",
+        QString("Number of ping engine shards, each running in its own thread."),
+        QString("count"),
+        QString("1")
+    );
+
+    QCommandLineOption batchSizeOption(
+        QStringList() << "b" << "batch-size",
+        QString("Number of packets sent or received per system call.  Use 1 to send and receive one packet at a time."),
+        QString("count")
+    );
+
+    QCommandLineOption burstBudgetOption(
+        QStringList() << "u" << "burst-budget",
+        QString("Maximum number of probes each shard sends per pacing tick.  Use 0 for no limit."),
+        QString("count")
+    );
+
+    QCommandLineOption outputLimitOption(
+        QStringList() << "o" << "output-limit",
+        QString("Bytes that may be queued for a client before it is dropped as too slow.  Use 0 for no limit."),
+        QString("bytes")
+    );
+
+    QCommandLineOption minimumTimeoutOption(
+        QStringList() << "minimum-timeout",
+        QString("Shortest time a probe waits for a reply, in milliseconds."),
+        QString("msec"),
+        QString::number(PingEngine::defaultMinimumTimeout)
+    );
+
+    QCommandLineOption maximumTimeoutOption(
+        QStringList() << "maximum-timeout",
+        QString("Longest time a probe waits for a reply, in milliseconds.  Use 0 for 80% of the probe interval."),
+        QString("msec"),
+        QString("0")
+    );
+
+    QCommandLineOption confirmProbesOption(
+        QStringList() << "confirm-probes",
+        QString("Probes sent to confirm an outage after an active server first misses a reply.  Use 0 to disable."),
+        QString("count"),
+        QString::number(PingEngine::defaultConfirmProbes)
+    );
+
+    QCommandLineOption confirmSpacingOption(
+        QStringList() << "confirm-spacing",
+        QString("Spacing between confirmation probes, in milliseconds."),
+        QString("msec"),
+        QString::number(PingEngine::defaultConfirmSpacing)
+    );
+
+    QCommandLineOption burstProbesOption(
+        QStringList() << "burst-probes",
+        QString("Probes sent to each active server per cycle, used to measure loss and jitter."),
+        QString("count"),
+        QString::number(PingEngine::defaultBurstProbes)
+    );
+
+    QCommandLineOption burstSpacingOption(
+        QStringList() << "burst-spacing",
+        QString("Spacing between the probes of a cycle, in milliseconds."),
+        QString("msec"),
+        QString::number(PingEngine::defaultBurstSpacing)
+    );
+
+    QCommandLineOption cycleLossLimitOption(
+        QStringList() << "cycle-loss-limit",
+        QString("Percentage of a cycle's probes that must be lost for the cycle to count as a missed reply."),
+        QString("percent"),
+        QString::number(Pinger::defaultCycleLossLimit)
+    );
+
+    QCommandLineOption lossThresholdOption(
+        QStringList() << "loss-threshold",
+        QString("Consecutive missed replies, including confirmation probes, before a server is flagged."),
+        QString("count"),
+        QString::number(Pinger::defaultLossThreshold)
+    );
+
+    QCommandLineOption flaggedIntervalOption(
+        QStringList() << "flagged-interval",
+        QString("Interval between probes to servers that were flagged as not responding, in milliseconds."),
+        QString("msec"),
+        QString::number(Pinger::defaultFlaggedPingInterval)
+    );
+
+    QCommandLineOption defunctBackoffOption(
+        QStringList() << "defunct-backoff-limit",
+        QString("Longest interval defunct servers back off to, in milliseconds.  Use 0 to disable back-off."),
+        QString("msec")
+    );
+
+    QCommandLineOption statusTableOption(
+        QStringList() << "t" << "status-table",
+        QString("Name of a shared memory table the server status is published into."),
+        QString("name")
+    );
+
+    QCommandLineOption statusCapacityOption(
+        QStringList() << "status-capacity",
+        QString("Maximum number of servers published into the status table."),
+        QString("count"),
+        QString::number(StatusTable::defaultCapacity)
+    );
+
+    parser.addOption(resolverThreadsOption);
+    parser.addOption(shardsOption);
+    parser.addOption(batchSizeOption);
+    parser.addOption(burstBudgetOption);
+    parser.addOption(outputLimitOption);
+    parser.addOption(minimumTimeoutOption);
+    parser.addOption(maximumTimeoutOption);
+    parser.addOption(confirmProbesOption);
+    parser.addOption(confirmSpacingOption);
+    parser.addOption(burstProbesOption);
+    parser.addOption(burstSpacingOption);
+    parser.addOption(cycleLossLimitOption);
+    parser.addOption(lossThresholdOption);
+    parser.addOption(flaggedIntervalOption);
+    parser.addOption(defunctBackoffOption);
+    parser.addOption(statusTableOption);
+    parser.addOption(statusCapacityOption);
+    parser.addPositionalArgument(QString("connection"), QString("The local socket to listen on."));
+    parser.process(application);
+
+    QStringList positionalArguments = parser.positionalArguments();
+    if (positionalArguments.size() == 1) {
+        QString       connectionName   = positionalArguments.at(0);
+        bool          shardsValid;
+        bool          threadsValid     = true;
+        unsigned      numberShards     = parser.value(shardsOption).toUInt(&shardsValid);
+        bool          batchSizeValid   = true;
+        bool          budgetValid      = true;
+        bool          outputLimitValid = true;
+        unsigned      resolverThreads  = 0;
+        unsigned      batchSize        = 0;
+        unsigned      burstBudget      = 0;
+        unsigned long outputLimit      = 0;
+        bool          minimumValid;
+        unsigned long minimumTimeout   = parser.value(minimumTimeoutOption).toULong(&minimumValid);
+        bool          maximumValid;
+        unsigned long maximumTimeout   = parser.value(maximumTimeoutOption).toULong(&maximumValid);
+        bool          confirmProbesValid;
+        unsigned      confirmProbes    = parser.value(confirmProbesOption).toUInt(&confirmProbesValid);
+        bool          spacingValid;
+        unsigned long confirmSpacing   = parser.value(confirmSpacingOption).toULong(&spacingValid);
+        bool          burstProbesValid;
+        unsigned      burstProbes      = parser.value(burstProbesOption).toUInt(&burstProbesValid);
+        bool          burstSpacingValid;
+        unsigned long burstSpacing     = parser.value(burstSpacingOption).toULong(&burstSpacingValid);
+        bool          lossLimitValid;
+        unsigned      cycleLossLimit   = parser.value(cycleLossLimitOption).toUInt(&lossLimitValid);
+        bool          thresholdValid;
+        unsigned      lossThreshold    = parser.value(lossThresholdOption).toUInt(&thresholdValid);
+        bool          flaggedValid;
+        unsigned long flaggedInterval  = parser.value(flaggedIntervalOption).toULong(&flaggedValid);
+        bool          backoffValid     = true;
+        unsigned long backoffLimit     = 0;
+        bool          capacityValid;
+        unsigned      statusCapacity   = parser.value(statusCapacityOption).toUInt(&capacityValid);
+
+        if (parser.isSet(resolverThreadsOption)) {
+            resolverThreads = parser.value(resolverThreadsOption).toUInt(&threadsValid);
+        }
+
+        if (parser.isSet(batchSizeOption)) {
+            batchSize = parser.value(batchSizeOption).toUInt(&batchSizeValid);
+        }
+
+        if (parser.isSet(burstBudgetOption)) {
+            burstBudget = parser.value(burstBudgetOption).toUInt(&budgetValid);
+        }
+
+        if (parser.isSet(outputLimitOption)) {
+            outputLimit = parser.value(outputLimitOption).toULong(&outputLimitValid);
+        }
+
+        if (parser.isSet(defunctBackoffOption)) {
+            backoffLimit = parser.value(defunctBackoffOption).toULong(&backoffValid);
+        }
+
+        if (!shardsValid || numberShards == 0) {
+            std::cerr << "*** Invalid shard count." << std::endl;
+            exitStatus = 1;
+        } else if (!threadsValid || (parser.isSet(resolverThreadsOption) && resolverThreads == 0)) {
+            std::cerr << "*** Invalid resolver thread count." << std::endl;
+            exitStatus = 1;
+        } else if (!batchSizeValid                                                                          ||
+                   (parser.isSet(batchSizeOption) && (batchSize == 0 || batchSize > PingEngine::maximumBatchSize))) {
+            std::cerr << "*** Invalid batch size." << std::endl;
+            exitStatus = 1;
+        } else if (!budgetValid) {
+            std::cerr << "*** Invalid burst budget." << std::endl;
+            exitStatus = 1;
+        } else if (!outputLimitValid) {
+            std::cerr << "*** Invalid output limit." << std::endl;
+            exitStatus = 1;
+        } else if (!minimumValid || !maximumValid || (maximumTimeout > 0 && maximumTimeout < minimumTimeout)) {
+            std::cerr << "*** Invalid probe timeout limits." << std::endl;
+            exitStatus = 1;
+        } else if (!confirmProbesValid || !spacingValid || confirmSpacing == 0) {
+            std::cerr << "*** Invalid confirmation probe settings." << std::endl;
+            exitStatus = 1;
+        } else if (!burstProbesValid                                                ||
+                   !burstSpacingValid                                               ||
+                   burstSpacing == 0                                                ||
+                   burstProbes == 0 || burstProbes > PingEngine::maximumBurstProbes) {
+            std::cerr << "*** Invalid burst settings." << std::endl;
+            exitStatus = 1;
+        } else if (!lossLimitValid || cycleLossLimit == 0 || cycleLossLimit > 100) {
+            std::cerr << "*** Invalid cycle loss limit." << std::endl;
+            exitStatus = 1;
+        } else if (!thresholdValid || lossThreshold == 0 || lossThreshold > Pinger::maximumLossThreshold) {
+            std::cerr << "*** Invalid loss threshold." << std::endl;
+            exitStatus = 1;
+        } else if (!flaggedValid || flaggedInterval == 0) {
+            std::cerr << "*** Invalid flagged server interval." << std::endl;
+            exitStatus = 1;
+        } else if (!backoffValid) {
+            std::cerr << "*** Invalid defunct back-off limit." << std::endl;
+            exitStatus = 1;
+        } else if (!capacityValid || statusCapacity == 0) {
+            std::cerr << "*** Invalid status table capacity." << std::endl;
             exitStatus = 1;
+        } else {
+            Pinger pinger(numberShards);
+            if (resolverThreads > 0) {
+                pinger.setMaximumLookups(resolverThreads);
+            }
+
+            if (batchSize > 0) {
+                pinger.setBatchSize(batchSize);
+            }
+
+            if (parser.isSet(burstBudgetOption)) {
+                pinger.setBurstBudget(burstBudget);
+            }
+
+            if (parser.isSet(outputLimitOption)) {
+                pinger.setOutputLimit(outputLimit);
+            }
+
+            if (parser.isSet(minimumTimeoutOption) || parser.isSet(maximumTimeoutOption)) {
+                pinger.setTimeoutLimits(minimumTimeout, maximumTimeout);
+            }
+
+            if (parser.isSet(confirmProbesOption) || parser.isSet(confirmSpacingOption)) {
+                pinger.setConfirmation(confirmProbes, confirmSpacing);
+            }
+
+            if (parser.isSet(burstProbesOption) || parser.isSet(burstSpacingOption)) {
+                pinger.setBurst(burstProbes, burstSpacing);
+            }
+
+            pinger.setCycleLossLimit(cycleLossLimit);
+            pinger.setLossThreshold(lossThreshold);
+
+            if (parser.isSet(flaggedIntervalOption)) {
+                pinger.setFlaggedPingInterval(flaggedInterval);
+            }
+
+            if (parser.isSet(defunctBackoffOption)) {
+                pinger.setDefunctBackoffLimit(backoffLimit);
+            }
+
+            bool success = true;
+            if (parser.isSet(statusTableOption)) {
+                success = pinger.openStatusTable(parser.value(statusTableOption), statusCapacity);
+            }
+
+            if (success) {
+                success = pinger.start(connectionName);
+                if (!success) {
+                    std::cerr << "*** Failed to connect to socket " << connectionName.toLocal8Bit().data()
+                              << std::endl;
+                }
+            }
+
+            if (success) {
+                exitStatus = application.exec();
+            } else {
+                exitStatus = 1;
+            }
         }
     } else {
         std::cerr << "*** Invalid command line.  Include shared memory key as parameter." << std::endl;
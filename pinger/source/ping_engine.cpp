@@ -0,0 +1,1305 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref PingEngine class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QTimer>
+#include <QSocketNotifier>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/icmp6.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <linux/filter.h>
+
+#include "host_address.h"
+#include "ping_engine.h"
+
+/**
+ * Approximate cost of a single hash table entry beyond its key and value, in bytes.
+ */
+static constexpr std::size_t hashEntryOverhead = 24;
+
+PingEngine::PingEngine(unsigned shardIndex, QObject* parent):QObject(parent) {
+    static const std::uint16_t identifierBase = static_cast<std::uint16_t>(std::random_device()());
+
+    ipv4Notifier = nullptr;
+    ipv6Notifier = nullptr;
+    tickTimer    = nullptr;
+
+    shard      = shardIndex;
+    identifier = static_cast<std::uint16_t>(identifierBase + shardIndex);
+    nextToken  = 0;
+
+    for (unsigned i=0 ; i<static_cast<unsigned>(Pool::NUMBER_POOLS) ; ++i) {
+        PoolState& poolState = pools[i];
+
+        poolState.numberMembers   = 0;
+        poolState.interval        = 0;
+        poolState.timeout         = 0;
+        poolState.maximumInterval = 0;
+        poolState.fillBuffer      = 0;
+        poolState.reportedBuffer  = 0;
+        poolState.reportPending.store(false);
+    }
+
+    wheelEpoch = now();
+    wheelTick  = 0;
+
+    for (unsigned level=0 ; level<wheelLevels ; ++level) {
+        for (unsigned slot=0 ; slot<wheelSlots ; ++slot) {
+            wheel[level][slot] = noHost;
+        }
+    }
+
+    batchSize      = defaultBatchSize;
+    burstBudget    = defaultBurstBudget;
+    minimumTimeout = static_cast<std::int64_t>(defaultMinimumTimeout) * 1000;
+    maximumTimeout = 0;
+    confirmProbes  = defaultConfirmProbes;
+    confirmSpacing = static_cast<std::int64_t>(defaultConfirmSpacing) * 1000;
+    burstProbes    = defaultBurstProbes;
+    burstSpacing   = static_cast<std::int64_t>(defaultBurstSpacing) * 1000;
+    inFlight       = 0;
+    tickLag        = 0;
+
+    hostAdds.store(0);
+    hostRemoves.store(0);
+    hostMoves.store(0);
+    hostCount.store(0);
+    hostMemory.store(0);
+    probesInFlight.store(0);
+    probeOverruns.store(0);
+    scheduleOverruns.store(0);
+    budgetExhausted.store(0);
+    sendLag.store(0);
+    worstLag.store(0);
+    probesSent.store(0);
+    repliesReceived.store(0);
+    probesExpired.store(0);
+    resolveTime.store(0);
+    expiryTime.store(0);
+    probesSaved.store(0);
+    threadCpuTime.store(0);
+    systemCalls.store(0);
+
+    ipv4TransmitRing.count = 0;
+    ipv6TransmitRing.count = 0;
+    receiveRing.count      = 0;
+
+    std::memset(receiveRing.messages, 0, sizeof(receiveRing.messages));
+    for (unsigned i=0 ; i<maximumBatchSize ; ++i) {
+        receiveRing.vectors[i].iov_base = receiveRing.packets[i];
+        receiveRing.vectors[i].iov_len  = packetSlotSize;
+
+        receiveRing.messages[i].msg_hdr.msg_name   = &receiveRing.addresses[i];
+        receiveRing.messages[i].msg_hdr.msg_iov    = &receiveRing.vectors[i];
+        receiveRing.messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    ipv4Socket = openSocket(AF_INET, IPPROTO_ICMP);
+    ipv6Socket = openSocket(AF_INET6, IPPROTO_ICMPV6);
+}
+
+
+PingEngine::~PingEngine() {
+    if (ipv4Socket >= 0) {
+        ::close(ipv4Socket);
+    }
+
+    if (ipv6Socket >= 0) {
+        ::close(ipv6Socket);
+    }
+}
+
+
+bool PingEngine::isOpen() const {
+    return ipv4Socket >= 0 || ipv6Socket >= 0;
+}
+
+
+QString PingEngine::errorString() const {
+    return lastError;
+}
+
+
+void PingEngine::initialize() {
+    if (ipv4Socket >= 0) {
+        ipv4Notifier = new QSocketNotifier(ipv4Socket, QSocketNotifier::Read, this);
+        connect(ipv4Notifier, &QSocketNotifier::activated, this, &PingEngine::ipv4Readable);
+    }
+
+    if (ipv6Socket >= 0) {
+        ipv6Notifier = new QSocketNotifier(ipv6Socket, QSocketNotifier::Read, this);
+        connect(ipv6Notifier, &QSocketNotifier::activated, this, &PingEngine::ipv6Readable);
+    }
+
+    tickTimer = new QTimer(this);
+    tickTimer->setSingleShot(false);
+    tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(tickTimer, &QTimer::timeout, this, &PingEngine::tick);
+    tickTimer->start(tickInterval);
+}
+
+
+void PingEngine::addHost(
+        unsigned long      hostId,
+        std::uint64_t      context,
+        PingEngine::Pool   pool,
+        const HostAddress& address
+    ) {
+    insertHost(hostId, context, pool, address, now());
+    publishHostCount();
+}
+
+
+void PingEngine::removeHost(unsigned long hostId) {
+    if (eraseHost(hostId)) {
+        publishHostCount();
+    }
+}
+
+
+void PingEngine::moveHost(unsigned long hostId, PingEngine::Pool pool) {
+    relocateHost(hostId, pool, now());
+}
+
+
+void PingEngine::addHosts(PingEngine::Pool pool, const QVector<PingEngine::HostEntry>& entries) {
+    std::int64_t currentTime = now();
+
+    int needed = hostIndex.size() + entries.size();
+    if (needed > hosts.capacity()) {
+        hosts.reserve(needed);
+    }
+
+    hostIndex.reserve(needed);
+    for (QVector<HostEntry>::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        insertHost(it->hostId, it->context, pool, it->address, currentTime);
+    }
+
+    publishHostCount();
+}
+
+
+void PingEngine::removeHosts(const QVector<unsigned long>& hostIds) {
+    for (QVector<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        eraseHost(*it);
+    }
+
+    publishHostCount();
+}
+
+
+void PingEngine::moveHosts(const QVector<unsigned long>& hostIds, PingEngine::Pool pool) {
+    std::int64_t currentTime = now();
+    for (QVector<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        relocateHost(*it, pool, currentTime);
+    }
+}
+
+
+void PingEngine::updateHostAddress(unsigned long hostId, const HostAddress& address) {
+    Host* host = findHost(hostId);
+    if (host != nullptr) {
+        // Round trip times measured against the old address say nothing about the new one.
+        host->address     = address;
+        host->smoothedRtt = -1;
+        host->rttVariance = 0;
+        host->backoff     = 0;
+    }
+}
+
+
+void PingEngine::schedulePool(
+        PingEngine::Pool pool,
+        unsigned long    intervalMilliseconds,
+        unsigned long    timeoutMilliseconds
+    ) {
+    PoolState& poolState = pools[static_cast<unsigned>(pool)];
+
+    poolState.interval = static_cast<std::int64_t>(intervalMilliseconds) * 1000;
+    poolState.timeout  = static_cast<std::int64_t>(timeoutMilliseconds) * 1000;
+
+    std::int64_t currentTime = now();
+    for (QVector<Host>::iterator it=hosts.begin(),end=hosts.end() ; it!=end ; ++it) {
+        if (it->pool == pool) {
+            updateSchedule(it->hostId, *it, currentTime);
+        }
+    }
+}
+
+
+void PingEngine::setHostInterval(unsigned long hostId, unsigned long intervalMilliseconds) {
+    Host* host = findHost(hostId);
+    if (host != nullptr) {
+        host->customInterval = static_cast<std::int64_t>(intervalMilliseconds) * 1000;
+        updateSchedule(hostId, *host, now());
+    }
+}
+
+
+void PingEngine::setBatchSize(unsigned newBatchSize) {
+    if (newBatchSize == 0) {
+        batchSize = 1;
+    } else if (newBatchSize > maximumBatchSize) {
+        batchSize = maximumBatchSize;
+    } else {
+        batchSize = newBatchSize;
+    }
+}
+
+
+void PingEngine::setBurstBudget(unsigned newBurstBudget) {
+    burstBudget = newBurstBudget;
+}
+
+
+void PingEngine::setTimeoutLimits(unsigned long minimumMilliseconds, unsigned long maximumMilliseconds) {
+    minimumTimeout = static_cast<std::int64_t>(minimumMilliseconds) * 1000;
+    maximumTimeout = static_cast<std::int64_t>(maximumMilliseconds) * 1000;
+}
+
+
+void PingEngine::setConfirmation(unsigned numberProbes, unsigned long spacingMilliseconds) {
+    confirmProbes  = numberProbes;
+    confirmSpacing = static_cast<std::int64_t>(spacingMilliseconds) * 1000;
+}
+
+
+void PingEngine::setPoolBackoff(PingEngine::Pool pool, unsigned long maximumIntervalMilliseconds) {
+    pools[static_cast<unsigned>(pool)].maximumInterval = static_cast<std::int64_t>(maximumIntervalMilliseconds) * 1000;
+}
+
+
+void PingEngine::setBurst(unsigned probesPerCycle, unsigned long spacingMilliseconds) {
+    if (probesPerCycle == 0) {
+        burstProbes = 1;
+    } else if (probesPerCycle > maximumBurstProbes) {
+        burstProbes = maximumBurstProbes;
+    } else {
+        burstProbes = probesPerCycle;
+    }
+
+    burstSpacing = static_cast<std::int64_t>(spacingMilliseconds) * 1000;
+}
+
+
+void PingEngine::tick() {
+    std::int64_t  currentTime   = now();
+    unsigned long initialBudget = burstBudget > 0 ? burstBudget : std::numeric_limits<unsigned long>::max();
+    unsigned long budget        = initialBudget;
+
+    tickLag = 0;
+    bool exhausted = advanceWheel(currentTime, budget);
+
+    if (batchSize > 1) {
+        unsigned long sent = flushRing(ipv4TransmitRing, ipv4Socket) + flushRing(ipv6TransmitRing, ipv6Socket);
+        probesSent.fetch_add(sent, std::memory_order_relaxed);
+    }
+
+    if (exhausted) {
+        budgetExhausted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (budget != initialBudget) {
+        unsigned long lag = static_cast<unsigned long>(tickLag);
+        sendLag.store(lag, std::memory_order_relaxed);
+        if (lag > worstLag.load(std::memory_order_relaxed)) {
+            worstLag.store(lag, std::memory_order_relaxed);
+        }
+    }
+
+    for (unsigned i=0 ; i<static_cast<unsigned>(Pool::NUMBER_POOLS) ; ++i) {
+        PoolState& poolState = pools[i];
+        if (   !poolState.results[poolState.fillBuffer].isEmpty()
+            && !poolState.reportPending.load(std::memory_order_acquire)
+           ) {
+            // Hand the filled buffer over by index and collect into the buffer the receiver released.  If the
+            // receiver still holds the other buffer, results keep collecting and are reported on a later tick.  The
+            // receiver polls for the hand-over so that no event is posted.
+            poolState.reportedBuffer = poolState.fillBuffer;
+            poolState.reportPending.store(true, std::memory_order_release);
+
+            poolState.fillBuffer ^= 1;
+            poolState.results[poolState.fillBuffer].clear();
+        }
+    }
+
+    probesInFlight.store(inFlight, std::memory_order_relaxed);
+    threadCpuTime.store(static_cast<unsigned long>(threadTime() / 1000), std::memory_order_relaxed);
+}
+
+
+void PingEngine::ipv4Readable() {
+    if (batchSize > 1) {
+        receiveBatches(ipv4Socket, AF_INET);
+    } else {
+        receivePackets(ipv4Socket, AF_INET);
+    }
+}
+
+
+void PingEngine::ipv6Readable() {
+    if (batchSize > 1) {
+        receiveBatches(ipv6Socket, AF_INET6);
+    } else {
+        receivePackets(ipv6Socket, AF_INET6);
+    }
+}
+
+
+void PingEngine::insertHost(
+        unsigned long      hostId,
+        std::uint64_t      context,
+        Pool               pool,
+        const HostAddress& address,
+        std::int64_t       currentTime
+    ) {
+    if (hostIndex.contains(hostId)) {
+        std::cerr << "*** Engine replacing host " << hostId << std::endl;
+        eraseHost(hostId);
+    }
+
+    unsigned handle;
+    if (!freeHosts.isEmpty()) {
+        handle = freeHosts.takeLast();
+    } else {
+        handle = static_cast<unsigned>(hosts.size());
+        hosts.append(Host());
+    }
+
+    hostIndex.insert(hostId, handle);
+    Host& host = hosts[static_cast<int>(handle)];
+
+    host.hostId           = hostId;
+    host.handle           = handle;
+    host.address          = address;
+    host.context          = context;
+    host.interval         = 0;
+    host.customInterval   = 0;
+    host.timeout          = 0;
+    host.smoothedRtt      = -1;
+    host.rttVariance      = 0;
+    host.backoff          = 0;
+    host.confirmRemaining = 0;
+    host.confirmAt        = 0;
+    host.confirmation     = false;
+    host.lossStartedAt    = 0;
+    host.burstRemaining   = 0;
+    host.burstAt          = 0;
+    host.cycleSent        = 0;
+    host.cycleReplies     = 0;
+    host.cycleStartedAt   = 0;
+    host.dueAt            = 0;
+    host.deadline         = 0;
+    host.wheelTick        = 0;
+    host.wheelLevel       = wheelLevels;
+    host.wheelSlot        = 0;
+    host.wheelNext        = noHost;
+    host.wheelPrevious    = noHost;
+    host.token            = 0;
+    host.sentAt           = 0;
+    host.latency          = -1;
+
+    insertIntoPool(hostId, host, pool, currentTime);
+    hostAdds.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+PingEngine::Host* PingEngine::findHost(unsigned long hostId) {
+    QHash<unsigned long, unsigned>::const_iterator it = hostIndex.constFind(hostId);
+    return it != hostIndex.constEnd() ? &hosts[static_cast<int>(it.value())] : nullptr;
+}
+
+
+bool PingEngine::eraseHost(unsigned long hostId) {
+    bool                                     erased = false;
+    QHash<unsigned long, unsigned>::iterator it     = hostIndex.find(hostId);
+    if (it != hostIndex.end()) {
+        Host& host = hosts[static_cast<int>(it.value())];
+        removeFromPool(host);
+
+        // Park the released entry in a pool nothing schedules so that pool-wide updates skip it.
+        host.pool    = Pool::NUMBER_POOLS;
+        host.hostId  = 0;
+        host.address = HostAddress();
+
+        freeHosts.append(it.value());
+        hostIndex.erase(it);
+
+        hostRemoves.fetch_add(1, std::memory_order_relaxed);
+        erased = true;
+    }
+
+    return erased;
+}
+
+
+void PingEngine::publishHostCount() {
+    std::size_t usage = (
+          sizeof(Host) * static_cast<std::size_t>(hosts.capacity())
+        + sizeof(unsigned) * static_cast<std::size_t>(freeHosts.capacity())
+        + (sizeof(unsigned long) + sizeof(unsigned) + hashEntryOverhead) * static_cast<std::size_t>(hostIndex.size())
+    );
+
+    hostCount.store(static_cast<unsigned long>(hostIndex.size()), std::memory_order_relaxed);
+    hostMemory.store(static_cast<unsigned long>(usage), std::memory_order_relaxed);
+}
+
+
+bool PingEngine::relocateHost(unsigned long hostId, Pool pool, std::int64_t currentTime) {
+    bool  moved = false;
+    Host* host  = findHost(hostId);
+    if (host != nullptr && host->pool != pool) {
+        removeFromPool(*host);
+        insertIntoPool(hostId, *host, pool, currentTime);
+
+        hostMoves.fetch_add(1, std::memory_order_relaxed);
+        moved = true;
+    }
+
+    return moved;
+}
+
+
+void PingEngine::insertIntoPool(unsigned long hostId, Host& host, Pool pool, std::int64_t currentTime) {
+    host.pool = pool;
+    ++pools[static_cast<unsigned>(pool)].numberMembers;
+
+    updateSchedule(hostId, host, currentTime);
+}
+
+
+void PingEngine::removeFromPool(Host& host) {
+    removeFromWheel(host);
+
+    if (host.token != 0) {
+        host.token = 0;
+        --inFlight;
+    }
+
+    host.confirmRemaining = 0;
+    host.confirmation     = false;
+    host.burstRemaining   = 0;
+    host.cycleSent        = 0;
+    host.cycleReplies     = 0;
+
+    --pools[static_cast<unsigned>(host.pool)].numberMembers;
+}
+
+
+std::int64_t PingEngine::baseInterval(const Host& host) const {
+    const PoolState& poolState = pools[static_cast<unsigned>(host.pool)];
+
+    std::int64_t interval = poolState.interval;
+    if (host.customInterval > 0 && host.pool == Pool::ACTIVE && poolState.interval > 0) {
+        interval = host.customInterval;
+    }
+
+    return interval;
+}
+
+
+void PingEngine::updateSchedule(unsigned long hostId, Host& host, std::int64_t currentTime) {
+    const PoolState& poolState = pools[static_cast<unsigned>(host.pool)];
+
+    std::int64_t interval = baseInterval(host);
+    std::int64_t timeout  = std::min(poolState.timeout, (8 * interval) / 10);
+
+    removeFromWheel(host);
+
+    if (interval != host.interval) {
+        host.interval = interval;
+        host.dueAt    = interval > 0 ? phaseTime(hostId, interval, currentTime) : 0;
+    }
+
+    host.timeout = timeout;
+    scheduleHost(host);
+}
+
+
+std::int64_t PingEngine::phaseTime(unsigned long hostId, std::int64_t interval, std::int64_t currentTime) const {
+    // Use a different multiplier from the shard hash so that a shard's hosts still spread across the interval.
+    std::uint64_t hash  = static_cast<std::uint64_t>(hostId) * 0xC2B2AE3D27D4EB4FULL;
+    std::int64_t  phase = static_cast<std::int64_t>((hash >> 32) % static_cast<std::uint64_t>(interval));
+
+    std::int64_t elapsed = currentTime - wheelEpoch - phase;
+    std::int64_t cycles  = elapsed > 0 ? (elapsed + interval - 1) / interval : 0;
+
+    return wheelEpoch + phase + cycles * interval;
+}
+
+
+void PingEngine::scheduleHost(Host& host) {
+    bool         schedule = true;
+    std::int64_t wakeAt   = 0;
+
+    if (host.token != 0) {
+        wakeAt = host.interval > 0 ? std::min(host.deadline, host.dueAt) : host.deadline;
+    } else if (host.interval > 0) {
+        wakeAt = host.dueAt;
+    } else {
+        schedule = false;
+    }
+
+    // The next burst or confirmation probe waits for the probe in flight, so only an idle host wakes for it.
+    if (host.confirmRemaining > 0 && host.token == 0) {
+        wakeAt   = schedule ? std::min(wakeAt, host.confirmAt) : host.confirmAt;
+        schedule = true;
+    }
+
+    if (host.burstRemaining > 0 && host.token == 0) {
+        wakeAt   = schedule ? std::min(wakeAt, host.burstAt) : host.burstAt;
+        schedule = true;
+    }
+
+    if (schedule) {
+        std::int64_t resolution = static_cast<std::int64_t>(tickInterval) * 1000;
+        insertIntoWheel(host, (wakeAt - wheelEpoch + resolution - 1) / resolution);
+    }
+}
+
+
+void PingEngine::insertIntoWheel(Host& host, std::int64_t targetTick) {
+    static constexpr std::int64_t maximumDelta = (std::int64_t(1) << (wheelBits * wheelLevels)) - 1;
+
+    if (targetTick < wheelTick) {
+        targetTick = wheelTick;
+    } else if (targetTick - wheelTick > maximumDelta) {
+        // Out of range.  The host is serviced early, finds nothing to do and is placed back into the wheel.
+        targetTick = wheelTick + maximumDelta;
+    }
+
+    std::int64_t delta = targetTick - wheelTick;
+    unsigned     level = 0;
+    while (level + 1 < wheelLevels && delta >= (std::int64_t(1) << (wheelBits * (level + 1)))) {
+        ++level;
+    }
+
+    unsigned  slot = static_cast<unsigned>(targetTick >> (wheelBits * level)) & (wheelSlots - 1);
+    unsigned& head = wheel[level][slot];
+
+    host.wheelTick     = targetTick;
+    host.wheelLevel    = level;
+    host.wheelSlot     = slot;
+    host.wheelNext     = head;
+    host.wheelPrevious = noHost;
+
+    if (head != noHost) {
+        hosts[static_cast<int>(head)].wheelPrevious = host.handle;
+    }
+
+    head = host.handle;
+}
+
+
+void PingEngine::removeFromWheel(Host& host) {
+    if (host.wheelLevel < wheelLevels) {
+        if (host.wheelPrevious != noHost) {
+            hosts[static_cast<int>(host.wheelPrevious)].wheelNext = host.wheelNext;
+        } else {
+            wheel[host.wheelLevel][host.wheelSlot] = host.wheelNext;
+        }
+
+        if (host.wheelNext != noHost) {
+            hosts[static_cast<int>(host.wheelNext)].wheelPrevious = host.wheelPrevious;
+        }
+
+        host.wheelLevel = wheelLevels;
+    }
+}
+
+
+unsigned PingEngine::cascade(unsigned level) {
+    unsigned slot = static_cast<unsigned>(wheelTick >> (wheelBits * level)) & (wheelSlots - 1);
+
+    unsigned handle = wheel[level][slot];
+    wheel[level][slot] = noHost;
+
+    while (handle != noHost) {
+        Host& host = hosts[static_cast<int>(handle)];
+        handle = host.wheelNext;
+
+        insertIntoWheel(host, host.wheelTick);
+    }
+
+    return slot;
+}
+
+
+bool PingEngine::advanceWheel(std::int64_t currentTime, unsigned long& budget) {
+    std::int64_t lastTick  = (currentTime - wheelEpoch) / (static_cast<std::int64_t>(tickInterval) * 1000);
+    bool         exhausted = false;
+
+    while (!exhausted && wheelTick <= lastTick) {
+        unsigned slot = static_cast<unsigned>(wheelTick) & (wheelSlots - 1);
+        if (slot == 0) {
+            // The lowest level has wrapped.  Pull the hosts due within the next revolution down from the upper levels.
+            unsigned level = 1;
+            while (level < wheelLevels && cascade(level) == 0) {
+                ++level;
+            }
+        }
+
+        // Detach the slot's list before servicing it.  Serviced hosts are placed back into later slots.
+        unsigned handle = wheel[0][slot];
+        wheel[0][slot] = noHost;
+        ++wheelTick;
+
+        while (handle != noHost) {
+            Host& host = hosts[static_cast<int>(handle)];
+            handle = host.wheelNext;
+
+            host.wheelLevel = wheelLevels;
+            if (exhausted) {
+                scheduleHost(host);
+            } else {
+                exhausted = !serviceHost(host.hostId, host, currentTime, budget);
+            }
+        }
+    }
+
+    return exhausted;
+}
+
+
+bool PingEngine::serviceHost(unsigned long hostId, Host& host, std::int64_t currentTime, unsigned long& budget) {
+    bool serviced = true;
+
+    if (host.token != 0 && host.deadline <= currentTime) {
+        completeProbe(hostId, host, currentTime, false);
+    }
+
+    bool busy = host.confirmRemaining > 0 || host.burstRemaining > 0 || (host.token != 0 && host.confirmation);
+    // Burst and confirmation probes are never sent over a probe still in flight.  Each one waits for the previous
+    // reply or timeout so that slow hosts are not reported as losing packets.
+    if (host.burstRemaining > 0 && host.burstAt <= currentTime && host.token == 0) {
+        if (budget > 0) {
+            sendProbe(hostId, host, currentTime, probeTimeout(host));
+            --budget;
+
+            host.burstAt = currentTime + burstSpacing;
+            --host.burstRemaining;
+            ++host.cycleSent;
+        } else {
+            serviced = false;
+        }
+    }
+
+    if (host.confirmRemaining > 0 && host.confirmAt <= currentTime && host.token == 0) {
+        if (budget > 0) {
+            sendProbe(hostId, host, currentTime, probeTimeout(host));
+            --budget;
+
+            host.confirmation = true;
+            host.confirmAt    = currentTime + confirmSpacing;
+            --host.confirmRemaining;
+        } else {
+            serviced = false;
+        }
+    }
+
+    if (busy && host.interval > 0 && host.dueAt <= currentTime) {
+        // The cycle or confirmation in progress stands in for the regular probe.
+        std::int64_t skipped = (currentTime - host.dueAt) / host.interval + 1;
+        host.dueAt += skipped * host.interval;
+    } else if (host.interval > 0 && host.dueAt <= currentTime) {
+        if (budget > 0) {
+            if (currentTime - host.dueAt > tickLag) {
+                tickLag = currentTime - host.dueAt;
+            }
+
+            unsigned burst = host.pool == Pool::ACTIVE ? burstProbes : 1;
+            sendProbe(hostId, host, currentTime, probeTimeout(host));
+            --budget;
+
+            std::int64_t base = baseInterval(host);
+            if (host.interval > base) {
+                probesSaved.fetch_add(static_cast<unsigned long>(host.interval / base - 1), std::memory_order_relaxed);
+            }
+
+            host.burstRemaining = burst - 1;
+            host.burstAt        = currentTime + burstSpacing;
+            host.cycleSent      = 1;
+            host.cycleReplies   = 0;
+            host.cycleStartedAt = host.sentAt;
+
+            host.dueAt += host.interval;
+            if (host.dueAt <= currentTime) {
+                // We have fallen a full interval or more behind.  Skip the missed probes rather than probing the host
+                // several times in a row.
+                std::int64_t missed = (currentTime - host.dueAt) / host.interval + 1;
+                host.dueAt += missed * host.interval;
+
+                scheduleOverruns.fetch_add(static_cast<unsigned long>(missed), std::memory_order_relaxed);
+            }
+        } else {
+            serviced = false;
+        }
+    }
+
+    scheduleHost(host);
+    return serviced;
+}
+
+
+void PingEngine::sendProbe(unsigned long hostId, Host& host, std::int64_t currentTime, std::int64_t timeout) {
+    if (host.token != 0) {
+        probeOverruns.fetch_add(1, std::memory_order_relaxed);
+        completeProbe(hostId, host, currentTime, false);
+    }
+
+    ++nextToken;
+    if (nextToken == 0) {
+        nextToken = 1;
+    }
+
+    host.token    = nextToken;
+    host.sentAt   = now();
+    host.deadline = currentTime + timeout;
+    ++inFlight;
+
+    if (batchSize > 1) {
+        probesSent.fetch_add(queueEchoRequest(hostId, host), std::memory_order_relaxed);
+    } else if (sendEchoRequest(hostId, host)) {
+        probesSent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+std::int64_t PingEngine::probeTimeout(const Host& host) const {
+    std::int64_t ceiling = host.timeout;
+    if (maximumTimeout > 0 && maximumTimeout < ceiling) {
+        ceiling = maximumTimeout;
+    }
+
+    std::int64_t timeout = ceiling;
+    if (host.smoothedRtt >= 0) {
+        // RFC 6298, section 2.  Expired probes are only noticed on a tick so the tick serves as the clock
+        // granularity.
+        std::int64_t granularity = static_cast<std::int64_t>(tickInterval) * 1000;
+
+        timeout = (host.smoothedRtt + std::max(granularity, 4 * host.rttVariance)) << host.backoff;
+        timeout = std::min(std::max(timeout, minimumTimeout), ceiling);
+    }
+
+    return timeout;
+}
+
+
+void PingEngine::completeProbe(unsigned long hostId, Host& host, std::int64_t completedAt, bool answered) {
+    std::int64_t waited       = std::max(completedAt - host.sentAt, std::int64_t(0));
+    double       latency;
+    double       outage       = 0;
+    unsigned     cycleProbes  = 0;
+    unsigned     cycleReplies = 0;
+
+    if (answered) {
+        latency = waited / 1000.0;
+
+        if (host.smoothedRtt < 0) {
+            host.smoothedRtt = waited;
+            host.rttVariance = waited / 2;
+        } else {
+            std::int64_t error = host.smoothedRtt > waited ? host.smoothedRtt - waited : waited - host.smoothedRtt;
+            host.rttVariance = (3 * host.rttVariance + error) / 4;
+            host.smoothedRtt = (7 * host.smoothedRtt + waited) / 8;
+        }
+
+        host.backoff          = 0;
+        host.confirmRemaining = 0;
+        host.lossStartedAt    = 0;
+
+        std::int64_t base = baseInterval(host);
+        if (host.interval > base) {
+            // Drop the back-off and pick up the pool's schedule again from its next phase slot.
+            host.interval = base;
+            host.dueAt    = phaseTime(hostId, base, completedAt);
+        }
+    } else {
+        latency = -1;
+
+        if (host.lossStartedAt == 0) {
+            host.lossStartedAt = host.sentAt;
+        }
+
+        std::int64_t maximumInterval = pools[static_cast<unsigned>(host.pool)].maximumInterval;
+        if (host.interval > 0 && host.interval < maximumInterval) {
+            // The due time already moved on by the old interval when this probe was sent.
+            std::int64_t interval = std::min(2 * host.interval, maximumInterval);
+            host.dueAt   += interval - host.interval;
+            host.interval = interval;
+        }
+
+        outage = (completedAt - host.lossStartedAt) / 1000.0;
+
+        if (host.backoff < maximumBackoff) {
+            ++host.backoff;
+        }
+
+        probesExpired.fetch_add(1, std::memory_order_relaxed);
+        expiryTime.fetch_add(static_cast<unsigned long long>(waited), std::memory_order_relaxed);
+    }
+
+    resolveTime.fetch_add(static_cast<unsigned long long>(waited), std::memory_order_relaxed);
+
+    if (host.confirmation) {
+        cycleProbes  = 1;
+        cycleReplies = answered ? 1 : 0;
+    } else {
+        if (answered) {
+            ++host.cycleReplies;
+        }
+
+        if (host.burstRemaining == 0) {
+            cycleProbes  = host.cycleSent;
+            cycleReplies = host.cycleReplies;
+
+            // Only a silent cycle following a reply starts confirmation.  Hosts that were already silent are left to
+            // their regular schedule.
+            if (cycleReplies == 0 && host.lossStartedAt >= host.cycleStartedAt && host.pool == Pool::ACTIVE) {
+                host.confirmRemaining = confirmProbes;
+                host.confirmAt        = completedAt;
+            }
+
+            host.cycleSent    = 0;
+            host.cycleReplies = 0;
+        }
+    }
+
+    host.token        = 0;
+    host.confirmation = false;
+    host.latency      = latency;
+    --inFlight;
+
+    Result result;
+    result.hostId       = hostId;
+    result.context      = host.context;
+    result.latency      = latency;
+    result.outage       = outage;
+    result.cycleProbes  = cycleProbes;
+    result.cycleReplies = cycleReplies;
+
+    PoolState& poolState = pools[static_cast<unsigned>(host.pool)];
+    poolState.results[poolState.fillBuffer].append(result);
+}
+
+
+bool PingEngine::sendEchoRequest(unsigned long hostId, const Host& host) {
+    static constexpr unsigned maximumRetries = 10;
+
+    std::uint8_t packet[packetSlotSize];
+    unsigned     packetLength     = buildEchoRequest(hostId, host, packet);
+    int          socketDescriptor = host.address.family() == AF_INET ? ipv4Socket : ipv6Socket;
+
+    bool     success = false;
+    unsigned retries = 0;
+    if (socketDescriptor >= 0) {
+        bool done = false;
+        do {
+            ssize_t bytesSent = sendto(
+                socketDescriptor,
+                packet,
+                packetLength,
+                0,
+                host.address.socketAddress(),
+                host.address.length()
+            );
+
+            systemCalls.fetch_add(1, std::memory_order_relaxed);
+
+            if (bytesSent >= 0) {
+                success = true;
+                done    = true;
+            } else if ((errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) && retries < maximumRetries) {
+                // The socket send buffer is full.  Give the kernel a moment to drain it.
+                struct pollfd pollDescriptor;
+                pollDescriptor.fd      = socketDescriptor;
+                pollDescriptor.events  = POLLOUT;
+                pollDescriptor.revents = 0;
+                poll(&pollDescriptor, 1, 1);
+
+                ++retries;
+            } else if (errno != EINTR) {
+                done = true;
+            }
+        } while (!done);
+    }
+
+    return success;
+}
+
+
+unsigned PingEngine::queueEchoRequest(unsigned long hostId, const Host& host) {
+    unsigned sent = 0;
+
+    bool        isIpv4           = host.address.family() == AF_INET;
+    PacketRing& ring             = isIpv4 ? ipv4TransmitRing : ipv6TransmitRing;
+    int         socketDescriptor = isIpv4 ? ipv4Socket : ipv6Socket;
+
+    if (socketDescriptor >= 0) {
+        unsigned index = ring.count;
+
+        std::memcpy(&ring.addresses[index], host.address.socketAddress(), host.address.length());
+
+        ring.vectors[index].iov_base = ring.packets[index];
+        ring.vectors[index].iov_len  = buildEchoRequest(hostId, host, ring.packets[index]);
+
+        struct msghdr& header = ring.messages[index].msg_hdr;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_name    = &ring.addresses[index];
+        header.msg_namelen = host.address.length();
+        header.msg_iov     = &ring.vectors[index];
+        header.msg_iovlen  = 1;
+
+        ++ring.count;
+        if (ring.count >= batchSize) {
+            sent = flushRing(ring, socketDescriptor);
+        }
+    }
+
+    return sent;
+}
+
+
+unsigned PingEngine::flushRing(PacketRing& ring, int socketDescriptor) {
+    static constexpr unsigned maximumRetries = 10;
+
+    unsigned sent    = 0;
+    unsigned offset  = 0;
+    unsigned retries = 0;
+
+    while (offset < ring.count) {
+        int result = sendmmsg(socketDescriptor, ring.messages + offset, ring.count - offset, 0);
+        systemCalls.fetch_add(1, std::memory_order_relaxed);
+
+        if (result > 0) {
+            sent    += static_cast<unsigned>(result);
+            offset  += static_cast<unsigned>(result);
+            retries  = 0;
+        } else if (result < 0                                                          &&
+                   (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)       &&
+                   retries < maximumRetries                                               ) {
+            // The socket send buffer is full.  Give the kernel a moment to drain it.
+            struct pollfd pollDescriptor;
+            pollDescriptor.fd      = socketDescriptor;
+            pollDescriptor.events  = POLLOUT;
+            pollDescriptor.revents = 0;
+            poll(&pollDescriptor, 1, 1);
+
+            ++retries;
+        } else if (result == 0 || errno != EINTR) {
+            // sendmmsg only reports an error if the first message could not be sent.  Skip it and carry on.
+            ++offset;
+        }
+    }
+
+    ring.count = 0;
+    return sent;
+}
+
+
+unsigned PingEngine::buildEchoRequest(unsigned long hostId, const Host& host, std::uint8_t* packet) {
+    Payload payload;
+    payload.magic  = payloadMagic;
+    payload.token  = host.token;
+    payload.hostId = hostId;
+
+    unsigned packetLength;
+    if (host.address.family() == AF_INET) {
+        struct icmphdr header;
+        std::memset(&header, 0, sizeof(header));
+
+        header.type             = ICMP_ECHO;
+        header.code             = 0;
+        header.un.echo.id       = htons(identifier);
+        header.un.echo.sequence = htons(static_cast<std::uint16_t>(host.token));
+
+        std::memcpy(packet, &header, sizeof(header));
+        std::memcpy(packet + sizeof(header), &payload, sizeof(payload));
+
+        packetLength    = sizeof(header) + sizeof(payload);
+        header.checksum = checksum(packet, packetLength);
+        std::memcpy(packet, &header, sizeof(header));
+    } else {
+        struct icmp6_hdr header;
+        std::memset(&header, 0, sizeof(header));
+
+        header.icmp6_type = ICMP6_ECHO_REQUEST;
+        header.icmp6_code = 0;
+        header.icmp6_id   = htons(identifier);
+        header.icmp6_seq  = htons(static_cast<std::uint16_t>(host.token));
+
+        std::memcpy(packet, &header, sizeof(header));
+        std::memcpy(packet + sizeof(header), &payload, sizeof(payload));
+
+        packetLength = sizeof(header) + sizeof(payload);
+    }
+
+    return packetLength;
+}
+
+
+void PingEngine::receivePackets(int socketDescriptor, int family) {
+    std::uint8_t            buffer[2048];
+    struct sockaddr_storage source;
+
+    bool drained = false;
+    do {
+        socklen_t sourceLength = sizeof(source);
+        ssize_t   bytesRead    = recvfrom(
+            socketDescriptor,
+            buffer,
+            sizeof(buffer),
+            0,
+            reinterpret_cast<struct sockaddr*>(&source),
+            &sourceLength
+        );
+
+        systemCalls.fetch_add(1, std::memory_order_relaxed);
+
+        if (bytesRead < 0) {
+            if (errno != EINTR) {
+                drained = true;
+            }
+        } else {
+            processPacket(
+                buffer,
+                static_cast<unsigned>(bytesRead),
+                family,
+                reinterpret_cast<const struct sockaddr*>(&source),
+                now()
+            );
+        }
+    } while (!drained);
+}
+
+
+void PingEngine::receiveBatches(int socketDescriptor, int family) {
+    bool drained = false;
+    do {
+        for (unsigned i=0 ; i<batchSize ; ++i) {
+            receiveRing.messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+
+        int result = recvmmsg(socketDescriptor, receiveRing.messages, batchSize, MSG_DONTWAIT, nullptr);
+        systemCalls.fetch_add(1, std::memory_order_relaxed);
+
+        if (result < 0) {
+            if (errno != EINTR) {
+                drained = true;
+            }
+        } else {
+            std::int64_t receivedAt = now();
+            for (int i=0 ; i<result ; ++i) {
+                processPacket(
+                    receiveRing.packets[i],
+                    receiveRing.messages[i].msg_len,
+                    family,
+                    reinterpret_cast<const struct sockaddr*>(&receiveRing.addresses[i]),
+                    receivedAt
+                );
+            }
+
+            drained = (static_cast<unsigned>(result) < batchSize);
+        }
+    } while (!drained);
+}
+
+
+void PingEngine::processPacket(
+        const std::uint8_t*    packet,
+        unsigned               length,
+        int                    family,
+        const struct sockaddr* source,
+        std::int64_t           receivedAt
+    ) {
+    if (family == AF_INET) {
+        unsigned headerLength = (packet[0] & 0x0F) * 4U;
+        if (length >= headerLength + sizeof(struct icmphdr)) {
+            const struct icmphdr* header = reinterpret_cast<const struct icmphdr*>(packet + headerLength);
+            if (header->type == ICMP_ECHOREPLY && ntohs(header->un.echo.id) == identifier) {
+                unsigned offset = headerLength + sizeof(struct icmphdr);
+                processEchoReply(packet + offset, length - offset, source, receivedAt);
+            }
+        }
+    } else {
+        if (length >= sizeof(struct icmp6_hdr)) {
+            const struct icmp6_hdr* header = reinterpret_cast<const struct icmp6_hdr*>(packet);
+            if (header->icmp6_type == ICMP6_ECHO_REPLY && ntohs(header->icmp6_id) == identifier) {
+                unsigned offset = sizeof(struct icmp6_hdr);
+                processEchoReply(packet + offset, length - offset, source, receivedAt);
+            }
+        }
+    }
+}
+
+
+void PingEngine::processEchoReply(
+        const std::uint8_t*    payload,
+        unsigned               length,
+        const struct sockaddr* source,
+        std::int64_t           receivedAt
+    ) {
+    if (length >= sizeof(Payload)) {
+        Payload received;
+        std::memcpy(&received, payload, sizeof(received));
+
+        if (received.magic == payloadMagic) {
+            unsigned long hostId = static_cast<unsigned long>(received.hostId);
+            Host*         host   = findHost(hostId);
+            if (host != nullptr && host->token != 0 && host->token == received.token && host->address.matches(source)) {
+                repliesReceived.fetch_add(1, std::memory_order_relaxed);
+                completeProbe(hostId, *host, receivedAt, true);
+
+                if (host->burstRemaining > 0 || host->confirmRemaining > 0) {
+                    // The host was parked on its deadline.  Wake it for its next probe instead.
+                    removeFromWheel(*host);
+                    scheduleHost(*host);
+                }
+            }
+        }
+    }
+}
+
+
+int PingEngine::openSocket(int family, int protocol) {
+    int socketDescriptor = socket(family, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+    if (socketDescriptor >= 0) {
+        int bufferSize = socketBufferSize;
+        setsockopt(socketDescriptor, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        setsockopt(socketDescriptor, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+        if (family == AF_INET6) {
+            struct icmp6_filter filter;
+            ICMP6_FILTER_SETBLOCKALL(&filter);
+            ICMP6_FILTER_SETPASS(ICMP6_ECHO_REPLY, &filter);
+            setsockopt(socketDescriptor, IPPROTO_ICMPV6, ICMP6_FILTER, &filter, sizeof(filter));
+        }
+
+        attachFilter(socketDescriptor, family);
+    } else {
+        lastError = QString::fromLocal8Bit(std::strerror(errno));
+        std::cerr << "*** Failed to open " << (family == AF_INET ? "IPv4" : "IPv6") << " ICMP socket: "
+                  << lastError.toLocal8Bit().data() << std::endl;
+    }
+
+    return socketDescriptor;
+}
+
+
+void PingEngine::attachFilter(int socketDescriptor, int family) {
+    struct sock_fprog program;
+    int               status;
+
+    if (family == AF_INET) {
+        // The IPv4 raw socket delivers the IP header so locate the ICMP header using the IP header length.
+        struct sock_filter instructions[] = {
+            BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+            BPF_STMT(BPF_LD | BPF_B | BPF_IND, 0),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ICMP_ECHOREPLY, 0, 3),
+            BPF_STMT(BPF_LD | BPF_H | BPF_IND, 4),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, identifier, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+            BPF_STMT(BPF_RET | BPF_K, 0)
+        };
+
+        program.len    = sizeof(instructions) / sizeof(struct sock_filter);
+        program.filter = instructions;
+
+        status = setsockopt(socketDescriptor, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+    } else {
+        // The ICMPv6 type is already filtered by ICMP6_FILTER and the IPv6 header is not delivered.
+        struct sock_filter instructions[] = {
+            BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, identifier, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, 0xFFFFFFFF),
+            BPF_STMT(BPF_RET | BPF_K, 0)
+        };
+
+        program.len    = sizeof(instructions) / sizeof(struct sock_filter);
+        program.filter = instructions;
+
+        status = setsockopt(socketDescriptor, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+    }
+
+    if (status != 0) {
+        std::cerr << "*** Failed to attach socket filter for shard " << shard << ": " << std::strerror(errno)
+                  << std::endl;
+    }
+}
+
+
+std::int64_t PingEngine::now() {
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+
+    return static_cast<std::int64_t>(currentTime.tv_sec) * 1000000 + currentTime.tv_nsec / 1000;
+}
+
+
+std::int64_t PingEngine::threadTime() {
+    struct timespec currentTime;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &currentTime);
+
+    return static_cast<std::int64_t>(currentTime.tv_sec) * 1000000 + currentTime.tv_nsec / 1000;
+}
+
+
+std::uint16_t PingEngine::checksum(const std::uint8_t* data, unsigned length) {
+    std::uint32_t sum = 0;
+
+    unsigned i = 0;
+    while (i + 1 < length) {
+        std::uint16_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        sum += word;
+        i   += 2;
+    }
+
+    if (i < length) {
+        std::uint16_t word = 0;
+        std::memcpy(&word, data + i, 1);
+        sum += word;
+    }
+
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return static_cast<std::uint16_t>(~sum);
+}
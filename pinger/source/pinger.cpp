@@ -23,64 +23,138 @@
 #include <QCoreApplication>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
 
 #include <iostream>
-
-#include <oping.h>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
 
 #include "connection.h"
 #include "server_data.h"
+#include "host_table.h"
+#include "host_address.h"
+#include "ping_engine.h"
+#include "resolver_cache.h"
+#include "status_table.h"
 #include "pinger.h"
 
-Pinger::Pinger(QObject* parent):QObject(parent) {
-    untestedPingListNeedsUpdate = false;
-    activePingListNeedsUpdate   = false;
-    defunctPingListNeedsUpdate  = false;
+Pinger::Pinger(unsigned numberShards, QObject* parent):QObject(parent),eventLog(eventLogCapacity) {
+    qRegisterMetaType<PingEngine::Pool>();
 
-    untestedPingObject = nullptr;
-    activePingObject   = nullptr;
-    defunctPingObject  = nullptr;
+    lastEventLoopLatency          = 0;
+    worstInFlightEventLoopLatency = 0;
+    nextBatchId                   = 1;
+    currentOutputLimit            = defaultOutputLimit;
+    closedBytesWritten            = 0;
+    numberSlowConsumers           = 0;
+    lossThreshold                 = defaultLossThreshold;
+    cycleLossLimit                = defaultCycleLossLimit;
+    numberOutagesDetected         = 0;
+    totalDetectTime               = 0;
 
     localServer = new QLocalServer(this);
     connect(localServer, &QLocalServer::newConnection, this, &Pinger::newConnection);
 
-    untestedPingTimer = new QTimer(this);
-    untestedPingTimer->setSingleShot(false);
+    resolverCache = new ResolverCache(this);
+    connect(resolverCache, &ResolverCache::lookupCompleted, this, &Pinger::lookupCompleted);
+    connect(resolverCache, &ResolverCache::addressChanged, this, &Pinger::addressChanged);
+
+    if (numberShards == 0) {
+        numberShards = 1;
+    }
+
+    for (unsigned shardIndex=0 ; shardIndex<numberShards ; ++shardIndex) {
+        QThread* engineThread = new QThread;
+        engineThread->setObjectName(QString("PingEngine%1").arg(shardIndex));
 
-    activePingTimer = new QTimer(this);
-    activePingTimer->setSingleShot(false);
+        PingEngine* engine = new PingEngine(shardIndex);
+        engine->moveToThread(engineThread);
 
-    defunctPingTimer = new QTimer(this);
-    defunctPingTimer->setSingleShot(false);
+        connect(engineThread, &QThread::started, engine, &PingEngine::initialize);
+        connect(engineThread, &QThread::finished, engine, &QObject::deleteLater);
 
-    connect(untestedPingTimer, &QTimer::timeout, this, &Pinger::doUntestedPing);
-    connect(activePingTimer, &QTimer::timeout, this, &Pinger::doActivePing);
-    connect(defunctPingTimer, &QTimer::timeout, this, &Pinger::doDefunctPing);
+        engineThread->start();
+
+        QMetaObject::invokeMethod(
+            engine,
+            [engine]() {
+                engine->schedulePool(PingEngine::Pool::UNTESTED, untestedPingInterval, pingTimeout);
+                engine->schedulePool(PingEngine::Pool::ACTIVE, activePingInterval, pingTimeout);
+                engine->schedulePool(PingEngine::Pool::DEFUNCT, defunctRetryInterval, pingTimeout);
+                engine->setPoolBackoff(PingEngine::Pool::DEFUNCT, defunctPingInterval);
+                engine->schedulePool(PingEngine::Pool::FLAGGED, defaultFlaggedPingInterval, pingTimeout);
+            },
+            Qt::QueuedConnection
+        );
+
+        engineThreads.append(engineThread);
+        engines.append(engine);
+    }
 
-    untestedPingTimer->start(untestedPingInterval);
-    activePingTimer->start(activePingInterval);
-    defunctPingTimer->start(10000); //defunctPingInterval);
+    responsivenessTimer = new QTimer(this);
+    responsivenessTimer->setSingleShot(false);
+    responsivenessTimer->setTimerType(Qt::PreciseTimer);
+
+    connect(responsivenessTimer, &QTimer::timeout, this, &Pinger::checkResponsiveness);
+
+    // Results are polled about once per engine tick.  A queued signal would post an event, and so allocate, per
+    // report.
+    resultTimer = new QTimer(this);
+    resultTimer->setSingleShot(false);
+    resultTimer->setTimerType(Qt::PreciseTimer);
+
+    connect(resultTimer, &QTimer::timeout, this, &Pinger::collectResults);
+
+    responsivenessElapsedTimer.start();
+    uptimeTimer.start();
+    responsivenessTimer->start(responsivenessCheckInterval);
+    resultTimer->start(resultPollInterval);
 }
 
 
 Pinger::~Pinger() {
-    if (activePingObject != nullptr) {
-        ping_destroy(activePingObject);
+    for (QVector<QThread*>::const_iterator it=engineThreads.constBegin(),end=engineThreads.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        (*it)->quit();
     }
 
-    if (defunctPingObject != nullptr) {
-        ping_destroy(defunctPingObject);
+    for (QVector<QThread*>::const_iterator it=engineThreads.constBegin(),end=engineThreads.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        (*it)->wait();
+        delete *it;
     }
 }
 
 
 bool Pinger::start(const QString& newConnection) {
-    if (localServer->isListening()) {
-        localServer->close();
+    bool success = true;
+
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        const PingEngine* engine = *it;
+        if (!engine->isOpen()) {
+            std::cerr << "*** No ICMP sockets available for shard " << engine->shardIndex() << ": "
+                      << engine->errorString().toLocal8Bit().data() << std::endl;
+            success = false;
+        }
+    }
+
+    if (success) {
+        if (localServer->isListening()) {
+            localServer->close();
+        }
+
+        localServer->setSocketOptions(QLocalServer::SocketOption::WorldAccessOption);
+        success = localServer->listen(newConnection);
     }
 
-    localServer->setSocketOptions(QLocalServer::SocketOption::WorldAccessOption);
-    bool success = localServer->listen(newConnection);
     return success;
 }
 
@@ -90,497 +164,1519 @@ QString Pinger::errorString() const {
 }
 
 
+bool Pinger::openStatusTable(const QString& name, unsigned capacity) {
+    bool success = statusTable.open(name, capacity);
+    if (success) {
+        HostTable::Handle numberHandles = hostTable.numberHandles();
+        for (HostTable::Handle handle=0 ; handle<numberHandles ; ++handle) {
+            unsigned long hostId = hostTable.hostId(handle);
+            if (hostId != 0) {
+                assignStatusSlot(handle, hostId, hostTable.status(handle));
+            }
+        }
+    } else {
+        std::cerr << "*** Failed to open status table " << name.toLocal8Bit().data() << ": "
+                  << statusTable.errorString().toLocal8Bit().data() << std::endl;
+    }
+
+    return success;
+}
+
+
+void Pinger::setMaximumLookups(unsigned newMaximumLookups) {
+    resolverCache->setMaximumLookups(newMaximumLookups);
+}
+
+
+void Pinger::setBatchSize(unsigned newBatchSize) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, newBatchSize]() {
+                engine->setBatchSize(newBatchSize);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setBurstBudget(unsigned newBurstBudget) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, newBurstBudget]() {
+                engine->setBurstBudget(newBurstBudget);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setTimeoutLimits(unsigned long minimumMilliseconds, unsigned long maximumMilliseconds) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, minimumMilliseconds, maximumMilliseconds]() {
+                engine->setTimeoutLimits(minimumMilliseconds, maximumMilliseconds);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setConfirmation(unsigned numberProbes, unsigned long spacingMilliseconds) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, numberProbes, spacingMilliseconds]() {
+                engine->setConfirmation(numberProbes, spacingMilliseconds);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setBurst(unsigned probesPerCycle, unsigned long spacingMilliseconds) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, probesPerCycle, spacingMilliseconds]() {
+                engine->setBurst(probesPerCycle, spacingMilliseconds);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setCycleLossLimit(unsigned newCycleLossLimit) {
+    if (newCycleLossLimit == 0) {
+        cycleLossLimit = 1;
+    } else if (newCycleLossLimit > 100) {
+        cycleLossLimit = 100;
+    } else {
+        cycleLossLimit = newCycleLossLimit;
+    }
+}
+
+
+void Pinger::setFlaggedPingInterval(unsigned long newInterval) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, newInterval]() {
+                engine->schedulePool(PingEngine::Pool::FLAGGED, newInterval, pingTimeout);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setDefunctBackoffLimit(unsigned long newLimit) {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, newLimit]() {
+                engine->setPoolBackoff(PingEngine::Pool::DEFUNCT, newLimit);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::setLossThreshold(unsigned newLossThreshold) {
+    if (newLossThreshold == 0) {
+        lossThreshold = 1;
+    } else if (newLossThreshold > maximumLossThreshold) {
+        lossThreshold = maximumLossThreshold;
+    } else {
+        lossThreshold = newLossThreshold;
+    }
+}
+
+
+void Pinger::setOutputLimit(unsigned long newOutputLimit) {
+    currentOutputLimit = newOutputLimit;
+}
+
+
+unsigned long Pinger::outputLimit() const {
+    return currentOutputLimit;
+}
+
+
 void Pinger::newConnection() {
     std::cout << "New connection." << std::endl;
-    connections.insert(new Connection(localServer->nextPendingConnection(), this));
+
+    Connection* connection = new Connection(localServer->nextPendingConnection(), this);
+    connections.insert(connection);
+    allSubscribers.insert(connection);
 }
 
 
 void Pinger::disconnect(Connection* connection) {
-    std::cout << "Lost connection." << std::endl;
-    connections.remove(connection);
-    connection->deleteLater();
+    if (connections.remove(connection)) {
+        std::cout << "Lost connection." << std::endl;
+        closedBytesWritten += connection->numberBytesWritten();
+
+        allSubscribers.remove(connection);
+        ownerSubscribers.remove(connection);
+        removeRangeSubscriptions(connection);
+
+        QSet<unsigned long> owned = ownedHosts.take(connection);
+        for (QSet<unsigned long>::const_iterator it=owned.constBegin(),end=owned.constEnd() ; it!=end ; ++it) {
+            hostOwners.remove(*it);
+        }
+
+        // Keep a named client's servers so that it can reconnect and resume without registering them again.
+        QByteArray clientName = clientNames.take(connection);
+        if (!clientName.isEmpty()) {
+            detachedHosts.insert(clientName, owned);
+        }
+
+        for (QHash<unsigned long, PendingServer>::iterator it=pendingServers.begin(),end=pendingServers.end()
+             ; it!=end
+             ; ++it
+            ) {
+            if (it.value().connection == connection) {
+                it.value().connection = nullptr;
+            }
+        }
+
+        for (QHash<unsigned long, Batch>::iterator it=batches.begin(),end=batches.end() ; it!=end ; ++it) {
+            if (it.value().connection == connection) {
+                it.value().connection = nullptr;
+            }
+        }
+
+        connection->deleteLater();
+    }
+}
+
+
+void Pinger::dropSlowConsumer(Connection* connection) {
+    std::cerr << "*** Dropping slow connection (" << connection->queueDepth() << " bytes queued)" << std::endl;
+    ++numberSlowConsumers;
+
+    // The connection may be in the middle of a broadcast over the connection list so defer the removal.
+    QMetaObject::invokeMethod(
+        connection,
+        [this, connection]() {
+            disconnect(connection);
+        },
+        Qt::QueuedConnection
+    );
 }
 
 
 void Pinger::addServer(unsigned long hostId, const QString& serverName, Connection* connection) {
-    QHash<unsigned long, ServerData>::iterator it = serverData.find(hostId);
-    if (it == serverData.end()) {
-        QHash<unsigned long, ServerData>::iterator it = serverData.insert(hostId, ServerData(hostId, serverName));
-        bool success = addUntestedServer(&(it.value()));
-        if (success) {
-            std::cout << "Adding server " << serverName.toLocal8Bit().data() << std::endl;
-            connection->sendMessage(QString("OK\n"));
-        } else {
-            serverData.erase(it);
-            connection->sendMessage(QString("failed\n"));
-            std::cerr << "*** Failed to add server " << serverName.toLocal8Bit().data() << std::endl;
-        }
-    } else if (it.value().serverName() != serverName) {
-        connection->sendMessage(QString("ERROR DUPLICATE ID\n"));
-        std::cerr << "*** Failed to add server (duplicate ID)" << serverName.toLocal8Bit().data() << std::endl;
-    } else {
-        connection->sendMessage(QString("ERROR DUPLICATE REQUEST\n"));
-        std::cerr << "*** Failed to add server (duplicate req)" << serverName.toLocal8Bit().data() << std::endl;
+    HostAddress address;
+    BatchStatus status = beginAddServer(hostId, serverName, connection, 0, 0, address);
+    if (status == BatchStatus::OK || status == BatchStatus::PENDING || status == BatchStatus::DUPLICATE_REQUEST) {
+        // A client that reconnects and repeats its request takes the server back.
+        setOwner(hostId, connection);
+    }
+
+    if (status == BatchStatus::OK) {
+        insertServer(hostId, serverName, address, QString(), connection, connection->currentTag());
+    } else if (status != BatchStatus::PENDING) {
+        connection->sendStatus(status);
     }
 }
 
 
 void Pinger::removeServer(unsigned long hostId, Connection* connection) {
-    QHash<unsigned long, ServerData>::iterator it = serverData.find(hostId);
-    if (it != serverData.end()) {
-        ServerData::Status status = it.value().status();
-        if (status == ServerData::Status::UNTESTED) {
-            untestedPingListNeedsUpdate = true;
-            std::cout << "Removing untested server " << it.value().serverName().toLocal8Bit().data() << std::endl;
-        } else if (status == ServerData::Status::DEFUNCT) {
-            defunctPingListNeedsUpdate = true;
-            std::cout << "Removing defunct server " << it.value().serverName().toLocal8Bit().data() << std::endl;
+    BatchStatus status = dropServer(hostId);
+    if (status == BatchStatus::OK) {
+        PingEngine* engine = engineFor(hostId);
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, hostId]() {
+                engine->removeHost(hostId);
+            },
+            Qt::QueuedConnection
+        );
+    } else if (status == BatchStatus::NO_SERVER) {
+        connection->sendStatus(status);
+    }
+}
+
+
+void Pinger::lookupCompleted(
+        unsigned long      hostId,
+        const QString&     hostName,
+        const HostAddress& address,
+        const QString&     errorMessage
+    ) {
+    QHash<unsigned long, PendingServer>::iterator it = pendingServers.find(hostId);
+    if (it != pendingServers.end() && it.value().serverName == hostName) {
+        Connection*   connection = it.value().connection;
+        unsigned long tag        = it.value().tag;
+        unsigned long batchId    = it.value().batchId;
+        unsigned      batchIndex = it.value().batchIndex;
+        pendingServers.erase(it);
+
+        if (batchId != 0) {
+            HostTable::Handle handle = recordServer(hostId, hostName, address, errorMessage);
+            bool              added  = (handle != HostTable::invalidHandle);
+            if (added) {
+                PingEngine*        engine  = engineFor(hostId);
+                HostTable::Context context = hostTable.context(handle);
+                QMetaObject::invokeMethod(
+                    engine,
+                    [engine, hostId, context, address]() {
+                        engine->addHost(hostId, context, PingEngine::Pool::UNTESTED, address);
+                    },
+                    Qt::QueuedConnection
+                );
+            }
+
+            completeBatchItem(batchId, batchIndex, added ? BatchStatus::OK : BatchStatus::FAILED);
         } else {
-            activePingListNeedsUpdate = true;
-            std::cout << "Removing active server " << it.value().serverName().toLocal8Bit().data() << std::endl;
+            insertServer(hostId, hostName, address, errorMessage, connection, tag);
         }
+    } else if (!address.isNull()) {
+        HostTable::Handle handle = hostTable.find(hostId);
+        if (handle == HostTable::invalidHandle || !hostTable.isNamed(handle, hostName)) {
+            resolverCache->release(hostName, hostId);
+        }
+    }
+}
 
-        serverData.erase(it);
-    } else {
-        connection->sendMessage(QString("ERROR NO SERVER\n"));
-        std::cerr << "*** Failed to remove server " << hostId << std::endl;
+
+void Pinger::addressChanged(const QList<unsigned long>& hostIds, const HostAddress& address) {
+    for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        unsigned long hostId = *it;
+        PingEngine*   engine = engineFor(hostId);
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, hostId, address]() {
+                engine->updateHostAddress(hostId, address);
+            },
+            Qt::QueuedConnection
+        );
+    }
+}
+
+
+void Pinger::insertServer(
+        unsigned long      hostId,
+        const QString&     serverName,
+        const HostAddress& address,
+        const QString&     errorMessage,
+        Connection*        connection,
+        unsigned long      tag
+    ) {
+    HostTable::Handle handle = recordServer(hostId, serverName, address, errorMessage);
+    if (handle != HostTable::invalidHandle) {
+        PingEngine*        engine  = engineFor(hostId);
+        HostTable::Context context = hostTable.context(handle);
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, hostId, context, address]() {
+                engine->addHost(hostId, context, PingEngine::Pool::UNTESTED, address);
+            },
+            Qt::QueuedConnection
+        );
+
+        if (connection != nullptr) {
+            connection->sendStatus(BatchStatus::OK, tag);
+        }
+    } else if (connection != nullptr) {
+        connection->sendStatus(BatchStatus::FAILED, tag);
     }
 }
 
 
 void Pinger::markDefunct(unsigned long hostId, Connection* connection) {
-    QHash<unsigned long, ServerData>::iterator it = serverData.find(hostId);
-    if (it != serverData.end()) {
-        ServerData::Status status = it.value().status();
-        if (status == ServerData::Status::UNTESTED) {
-            untestedPingListNeedsUpdate = true;
-            bool success = addDefunctServer(&(it.value()));
+    BatchStatus status = setServerDefunct(hostId);
+    if (status == BatchStatus::OK) {
+        moveServer(hostId, PingEngine::Pool::DEFUNCT);
+    }
 
-            connection->sendMessage(success ? QString("OK\n") : QString("failed\n"));
+    connection->sendStatus(status);
+}
 
-            if (success) {
-                std::cout << "Marked untested as defunct " << hostId << std::endl;
-            } else {
-                std::cerr << "*** Failed to mark defunct " << hostId << std::endl;
-            }
-        } else if (status != ServerData::Status::DEFUNCT) {
-            activePingListNeedsUpdate = true;
-            bool success = addDefunctServer(&(it.value()));
 
-            connection->sendMessage(success ? QString("OK\n") : QString("failed\n"));
+void Pinger::setServerInterval(unsigned long hostId, unsigned long interval, Connection* connection) {
+    if (hostTable.find(hostId) != HostTable::invalidHandle) {
+        PingEngine* engine = engineFor(hostId);
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, hostId, interval]() {
+                engine->setHostInterval(hostId, interval);
+            },
+            Qt::QueuedConnection
+        );
 
-            if (success) {
-                std::cout << "Marked active as defunct " << hostId << std::endl;
-            } else {
-                std::cerr << "*** Failed to mark defunct " << hostId << std::endl;
+        connection->sendStatus(BatchStatus::OK);
+    } else {
+        connection->sendStatus(BatchStatus::NO_SERVER);
+        std::cerr << "*** Failed to set interval for " << hostId << " (bad ID)" << std::endl;
+    }
+}
+
+
+void Pinger::collectResults() {
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        PingEngine* engine = *it;
+        for (unsigned i=0 ; i<static_cast<unsigned>(PingEngine::Pool::NUMBER_POOLS) ; ++i) {
+            PingEngine::Pool pool = static_cast<PingEngine::Pool>(i);
+            unsigned         buffer;
+            if (engine->pendingResults(pool, buffer)) {
+                probesCompleted(engine, pool, buffer);
             }
-        } else {
-            connection->sendMessage(QString("ERROR ALREADY DEFUNCT\n"));
-            std::cerr << "*** Failed to mark defunct " << hostId << " (already defunct)" << std::endl;
         }
-    } else {
-        connection->sendMessage(QString("ERROR NO SERVER\n"));
-        std::cerr << "*** Failed to mark defunct " << hostId << " (bad ID)" << std::endl;
     }
 }
 
 
-void Pinger::doUntestedPing() {
-    if (untestedPingListNeedsUpdate) {
-        untestedPingListNeedsUpdate = false;
-        rebuildUntestedServerList();
+void Pinger::probesCompleted(PingEngine* engine, PingEngine::Pool pool, unsigned buffer) {
+    const QVector<PingEngine::Result>& results = engine->reportedResults(pool, buffer);
+
+    statusTable.beginUpdate();
+
+    switch (pool) {
+        case PingEngine::Pool::UNTESTED: {
+            processUntestedResults(results);
+            break;
+        }
+
+        case PingEngine::Pool::ACTIVE: {
+            processActiveResults(results);
+            break;
+        }
+
+        case PingEngine::Pool::DEFUNCT: {
+            processDefunctResults(results);
+            break;
+        }
+
+        case PingEngine::Pool::FLAGGED: {
+            processFlaggedResults(results);
+            break;
+        }
+
+        default: {
+            std::cerr << "*** Unexpected pool " << static_cast<unsigned>(pool) << std::endl;
+            break;
+        }
     }
 
-    if (untestedPingObject != nullptr) {
-        int result = ping_send(untestedPingObject);
-        if (result < 0) {
-            std::cerr << "*** Failed to send pings: " << ping_get_error(untestedPingObject) << std::endl;
-        } else {
-            size_t bufferSize            = sizeof(double);
-            for (pingobj_iter_t* it=ping_iterator_get(untestedPingObject) ; it!=nullptr ; it=ping_iterator_next(it)) {
-                ServerData* server = reinterpret_cast<ServerData*>(ping_iterator_get_context(it));
-                if (server != nullptr) {
-                    double latency;
-                    int status = ping_iterator_get_info(it, PING_INFO_LATENCY, &latency, &bufferSize);
-                    if (status == 0) {
-                        if (latency >= 0) {
-                            server->setStatus(ServerData::Status::ACTIVE);
-                            addActiveServer(server);
-                            std::cout << "New server active: "
-                                      << server->serverName().toLocal8Bit().data() << std::endl;
-                        } else {
-                            server->setStatus(ServerData::Status::DEFUNCT);
-                            addDefunctServer(server);
-                            std::cout << "New server does not respond: "
-                                     << server->serverName().toLocal8Bit().data() << std::endl;
-                        }
-                    } else {
-                        std::cerr << "*** Failed to get latency "
-                                  << server->serverName().toLocal8Bit().data() << std::endl;
+    engine->releaseResults(pool);
+}
+
+
+void Pinger::checkResponsiveness() {
+    unsigned long elapsed = static_cast<unsigned long>(responsivenessElapsedTimer.restart());
+    lastEventLoopLatency = elapsed > responsivenessCheckInterval ? elapsed - responsivenessCheckInterval : 0;
+
+    bool anyInFlight = false;
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        anyInFlight = anyInFlight || (*it)->numberProbesInFlight() > 0;
+    }
+
+    if (anyInFlight) {
+        if (lastEventLoopLatency > worstInFlightEventLoopLatency) {
+            worstInFlightEventLoopLatency = lastEventLoopLatency;
+        }
+
+        if (lastEventLoopLatency > maximumEventLoopLatency) {
+            std::cerr << "*** Event loop stalled " << lastEventLoopLatency << " mSec while probes were in flight"
+                      << std::endl;
+        }
+    }
+}
+
+
+void Pinger::processUntestedResults(const QVector<PingEngine::Result>& results) {
+    for (QVector<PingEngine::Result>::const_iterator it=results.constBegin(),end=results.constEnd() ; it!=end ; ++it) {
+        HostTable::Handle handle = hostTable.find(it->hostId, it->context);
+        if (handle != HostTable::invalidHandle) {
+            if (hostTable.status(handle) == ServerData::Status::UNTESTED) {
+                if (it->latency >= 0) {
+                    hostTable.addSample(handle, it->latency);
+                    hostTable.setStatus(handle, ServerData::Status::ACTIVE);
+                    moveServer(it->hostId, PingEngine::Pool::ACTIVE);
+                    std::cout << "New server active: "
+                              << hostTable.serverName(handle).constData() << std::endl;
+                } else {
+                    hostTable.setStatus(handle, ServerData::Status::DEFUNCT);
+                    moveServer(it->hostId, PingEngine::Pool::DEFUNCT);
+                    std::cout << "New server does not respond: "
+                             << hostTable.serverName(handle).constData() << std::endl;
+                }
+
+                statusTable.publish(hostTable.statusSlot(handle), hostTable.status(handle), it->latency);
+            }
+        }
+    }
+}
+
+
+void Pinger::processActiveResults(const QVector<PingEngine::Result>& results) {
+    for (QVector<PingEngine::Result>::const_iterator it=results.constBegin(),end=results.constEnd() ; it!=end ; ++it) {
+        HostTable::Handle handle = hostTable.find(it->hostId, it->context);
+        if (handle != HostTable::invalidHandle) {
+            hostTable.addSample(handle, it->latency);
+
+            // Status follows whole cycles.  A cycle only counts as missed once its loss reaches the limit so a probe
+            // dropped within a burst does not escalate.
+            if (it->cycleProbes > 0) {
+                unsigned lost = it->cycleProbes - it->cycleReplies;
+                if (100 * lost < cycleLossLimit * it->cycleProbes) {
+                    if (hostTable.status(handle) == ServerData::Status::INACTIVE_FLAGGED) {
+                        // The server answered before its move to the flagged pool took effect.
+                        std::cout << "Server recovered: " << hostTable.serverName(handle).constData() << std::endl;
+                        reportEvent(EventLog::Kind::RECOVERED, handle);
+                        moveServer(it->hostId, PingEngine::Pool::ACTIVE);
                     }
+
+                    hostTable.setStatus(handle, ServerData::Status::ACTIVE);
                 } else {
-                    std::cerr << "*** Ping structure missing server entry" << std::endl;
+                    ServerData::Status currentStatus = hostTable.status(handle);
+                    ServerData::Status newStatus;
+                    switch (currentStatus) {
+                        case ServerData::Status::UNTESTED: {
+                            std::cerr << "*** Untested server in active list "
+                                      << hostTable.serverName(handle).constData() << std::endl;
+
+                            moveServer(it->hostId, PingEngine::Pool::DEFUNCT);
+                            newStatus = ServerData::Status::DEFUNCT;
+
+                            break;
+                        }
+
+                        case ServerData::Status::DEFUNCT: {
+                            std::cerr << "*** Defunct server in active list "
+                                      << hostTable.serverName(handle).constData() << std::endl;
+
+                            moveServer(it->hostId, PingEngine::Pool::DEFUNCT);
+                            newStatus = ServerData::Status::DEFUNCT;
+
+                            break;
+                        }
+
+                        case ServerData::Status::ACTIVE:
+                        case ServerData::Status::INACTIVE_1:
+                        case ServerData::Status::INACTIVE_2:
+                        case ServerData::Status::INACTIVE_3:
+                        case ServerData::Status::INACTIVE_4: {
+                            // The inactive states are consecutive so the state counts the misses so far.
+                            unsigned misses = static_cast<unsigned>(currentStatus)
+                                              - static_cast<unsigned>(ServerData::Status::ACTIVE)
+                                              + 1;
+
+                            if (misses >= lossThreshold) {
+                                reportEvent(EventLog::Kind::FAILED, handle);
+                                moveServer(it->hostId, PingEngine::Pool::FLAGGED);
+                                newStatus = ServerData::Status::INACTIVE_FLAGGED;
+
+                                ++numberOutagesDetected;
+                                totalDetectTime += it->outage;
+                            } else {
+                                newStatus = static_cast<ServerData::Status>(
+                                    static_cast<unsigned>(ServerData::Status::ACTIVE) + misses
+                                );
+                            }
+
+                            break;
+                        }
+
+                        case ServerData::Status::INACTIVE_FLAGGED: {
+                            newStatus = ServerData::Status::INACTIVE_FLAGGED;
+                            break;
+                        }
+
+                        default: {
+                            std::cerr << "*** Unexpected state "
+                                      << static_cast<unsigned>(currentStatus) << std::endl;
+
+                            newStatus = ServerData::Status::UNTESTED;
+                        }
+                    }
+
+                    hostTable.setStatus(handle, newStatus);
                 }
             }
+
+            statusTable.publish(hostTable.statusSlot(handle), hostTable.status(handle), it->latency);
         }
+    }
+}
+
+
+void Pinger::processDefunctResults(const QVector<PingEngine::Result>& results) {
+    for (QVector<PingEngine::Result>::const_iterator it=results.constBegin(),end=results.constEnd() ; it!=end ; ++it) {
+        HostTable::Handle handle = hostTable.find(it->hostId, it->context);
+        if (handle != HostTable::invalidHandle) {
+            if (hostTable.status(handle) == ServerData::Status::DEFUNCT && it->latency >= 0) {
+                hostTable.addSample(handle, it->latency);
+                hostTable.setStatus(handle, ServerData::Status::ACTIVE);
+                moveServer(it->hostId, PingEngine::Pool::ACTIVE);
+                std::cout << "Defunct server now active: "
+                          << hostTable.serverName(handle).constData() << std::endl;
 
-        ping_destroy(untestedPingObject);
-        untestedPingObject = nullptr;
+                statusTable.publish(hostTable.statusSlot(handle), hostTable.status(handle), it->latency);
+            }
+        }
     }
 }
 
 
-void Pinger::doActivePing() {
-    if (activePingListNeedsUpdate) {
-        activePingListNeedsUpdate = false;
-        rebuildActiveServerList();
+void Pinger::processFlaggedResults(const QVector<PingEngine::Result>& results) {
+    for (QVector<PingEngine::Result>::const_iterator it=results.constBegin(),end=results.constEnd() ; it!=end ; ++it) {
+        HostTable::Handle handle = hostTable.find(it->hostId, it->context);
+        if (handle != HostTable::invalidHandle && hostTable.status(handle) == ServerData::Status::INACTIVE_FLAGGED) {
+            hostTable.addSample(handle, it->latency);
+
+            if (it->latency >= 0) {
+                hostTable.setStatus(handle, ServerData::Status::ACTIVE);
+                moveServer(it->hostId, PingEngine::Pool::ACTIVE);
+
+                std::cout << "Server recovered: " << hostTable.serverName(handle).constData() << std::endl;
+                reportEvent(EventLog::Kind::RECOVERED, handle);
+            }
+
+            statusTable.publish(hostTable.statusSlot(handle), hostTable.status(handle), it->latency);
+        }
     }
+}
+
+
+void Pinger::addServers(const QVector<BatchItem>& items, Connection* connection) {
+    unsigned long                           batchId       = nextBatchId;
+    unsigned long                           numberPending = 0;
+    unsigned                                numberItems   = static_cast<unsigned>(items.size());
+    QByteArray                              statuses(static_cast<int>(numberItems), char(BatchStatus::OK));
+    QVector<QVector<PingEngine::HostEntry>> additions(engines.size());
 
-    if (activePingObject != nullptr) {
-        int result = ping_send(activePingObject);
-        if (result < 0) {
-            std::cerr << "*** Failed to send pings: " << ping_get_error(activePingObject) << std::endl;
+    for (unsigned index=0 ; index<numberItems ; ++index) {
+        const BatchItem& item = items.at(index);
+        BatchStatus      status;
+
+        if (item.hostId == 0) {
+            status = BatchStatus::MALFORMED;
         } else {
-            size_t bufferSize            = sizeof(double);
-            for (pingobj_iter_t* it=ping_iterator_get(activePingObject) ; it!=nullptr ; it=ping_iterator_next(it)) {
-                ServerData* server = reinterpret_cast<ServerData*>(ping_iterator_get_context(it));
-                if (server != nullptr) {
-                    double latency;
-                    int status = ping_iterator_get_info(it, PING_INFO_LATENCY, &latency, &bufferSize);
-                    if (status == 0) {
-                        if (latency >= 0) {
-                            server->setStatus(ServerData::Status::ACTIVE);
-                        } else {
-                            ServerData::Status currentStatus = server->status();
-                            ServerData::Status newStatus;
-                            switch (currentStatus) {
-                                case ServerData::Status::UNTESTED: {
-                                    std::cerr << "*** Untested server in active list "
-                                              << server->serverName().toLocal8Bit().data() << std::endl;
-
-                                    bool success = addDefunctServer(server);
-                                    if (!success) {
-                                        std::cerr << "*** Failed to add server to defunct list "
-                                                  << server->serverName().toLocal8Bit().data() << std::endl;
-                                    }
-
-                                    activePingListNeedsUpdate = true;
-                                    newStatus                 = ServerData::Status::DEFUNCT;
-
-                                    break;
-                                }
-
-                                case ServerData::Status::DEFUNCT: {
-                                    std::cerr << "*** Defunct server in active list "
-                                              << server->serverName().toLocal8Bit().data() << std::endl;
-
-                                    bool success = addDefunctServer(server);
-                                    if (!success) {
-                                        std::cerr << "*** Failed to add server to defunct list "
-                                                  << server->serverName().toLocal8Bit().data() << std::endl;
-                                    }
-
-                                    activePingListNeedsUpdate = true;
-                                    newStatus                 = ServerData::Status::DEFUNCT;
-
-                                    break;
-                                }
-
-                                case ServerData::Status::ACTIVE: {
-                                    newStatus = ServerData::Status::INACTIVE_1;
-                                    break;
-                                }
-
-                                case ServerData::Status::INACTIVE_1: {
-                                    newStatus = ServerData::Status::INACTIVE_2;
-                                    break;
-                                }
-
-                                case ServerData::Status::INACTIVE_2: {
-                                    newStatus = ServerData::Status::INACTIVE_3;
-                                    break;
-                                }
-
-                                case ServerData::Status::INACTIVE_3: {
-                                    reportFailedServer(server);
-                                    newStatus = ServerData::Status::INACTIVE_FLAGGED;
-                                    break;
-                                }
-
-                                case ServerData::Status::INACTIVE_4: {
-                                    reportFailedServer(server);
-                                    newStatus = ServerData::Status::INACTIVE_FLAGGED;
-                                    break;
-                                }
-
-                                case ServerData::Status::INACTIVE_FLAGGED: {
-                                    newStatus = ServerData::Status::INACTIVE_FLAGGED;
-                                    break;
-                                }
-
-                                default: {
-                                    std::cerr << "*** Unexpected state "
-                                              << static_cast<unsigned>(currentStatus) << std::endl;
-
-                                    newStatus = ServerData::Status::UNTESTED;
-                                }
-                            }
+            PingEngine::HostEntry entry;
+            status = beginAddServer(item.hostId, item.serverName, nullptr, batchId, index, entry.address);
+            if (   status == BatchStatus::OK
+                || status == BatchStatus::PENDING
+                || status == BatchStatus::DUPLICATE_REQUEST
+               ) {
+                setOwner(item.hostId, connection);
+            }
 
-                            server->setStatus(newStatus);
-                        }
-                    } else {
-                        std::cerr << "*** Failed to get latency "
-                                  << server->serverName().toLocal8Bit().data() << std::endl;
-                    }
+            if (status == BatchStatus::OK) {
+                HostTable::Handle handle = recordServer(item.hostId, item.serverName, entry.address, QString());
+                if (handle != HostTable::invalidHandle) {
+                    entry.hostId  = item.hostId;
+                    entry.context = hostTable.context(handle);
+                    additions[static_cast<int>(shardFor(item.hostId))].append(entry);
                 } else {
-                    std::cerr << "*** Ping structure missing server entry" << std::endl;
+                    status = BatchStatus::FAILED;
                 }
+            } else if (status == BatchStatus::PENDING) {
+                ++numberPending;
             }
         }
+
+        statuses[static_cast<int>(index)] = char(status);
     }
+
+    queueAdditions(additions);
+
+    Batch batch;
+    batch.connection    = connection;
+    batch.tag           = connection->currentTag();
+    batch.statuses      = statuses;
+    batch.numberPending = numberPending;
+    batch.sync          = false;
+    batch.numberRemoved = 0;
+
+    submitBatch(batch);
+}
+
+
+void Pinger::removeServers(const QVector<BatchItem>& items, Connection* connection) {
+    unsigned                        numberItems = static_cast<unsigned>(items.size());
+    QByteArray                      statuses(static_cast<int>(numberItems), char(BatchStatus::OK));
+    QVector<QVector<unsigned long>> removals(engines.size());
+
+    for (unsigned index=0 ; index<numberItems ; ++index) {
+        unsigned long hostId = items.at(index).hostId;
+        BatchStatus   status;
+
+        if (hostId == 0) {
+            status = BatchStatus::MALFORMED;
+        } else {
+            status = dropServer(hostId);
+            if (status == BatchStatus::OK) {
+                removals[static_cast<int>(shardFor(hostId))].append(hostId);
+            }
+        }
+
+        statuses[static_cast<int>(index)] = char(status);
+    }
+
+    queueRemovals(removals);
+
+    Batch batch;
+    batch.connection    = connection;
+    batch.tag           = connection->currentTag();
+    batch.statuses      = statuses;
+    batch.numberPending = 0;
+    batch.sync          = false;
+    batch.numberRemoved = 0;
+
+    submitBatch(batch);
 }
 
 
-void Pinger::doDefunctPing() {
-    if (defunctPingListNeedsUpdate) {
-        defunctPingListNeedsUpdate = false;
-        rebuildDefunctServerList();
+void Pinger::markServersDefunct(const QVector<BatchItem>& items, Connection* connection) {
+    unsigned                        numberItems = static_cast<unsigned>(items.size());
+    QByteArray                      statuses(static_cast<int>(numberItems), char(BatchStatus::OK));
+    QVector<QVector<unsigned long>> moves(engines.size());
+
+    for (unsigned index=0 ; index<numberItems ; ++index) {
+        unsigned long hostId = items.at(index).hostId;
+        BatchStatus   status;
+
+        if (hostId == 0) {
+            status = BatchStatus::MALFORMED;
+        } else {
+            status = setServerDefunct(hostId);
+            if (status == BatchStatus::OK) {
+                moves[static_cast<int>(shardFor(hostId))].append(hostId);
+            }
+        }
+
+        statuses[static_cast<int>(index)] = char(status);
+    }
+
+    for (int shardIndex=0 ; shardIndex<engines.size() ; ++shardIndex) {
+        const QVector<unsigned long>& hostIds = moves.at(shardIndex);
+        if (!hostIds.isEmpty()) {
+            PingEngine* engine = engines.at(shardIndex);
+            QMetaObject::invokeMethod(
+                engine,
+                [engine, hostIds]() {
+                    engine->moveHosts(hostIds, PingEngine::Pool::DEFUNCT);
+                },
+                Qt::QueuedConnection
+            );
+        }
     }
 
-    if (defunctPingObject != nullptr) {
-        int result = ping_send(defunctPingObject);
-        if (result < 0) {
-            std::cerr << "*** Failed to send pings: " << ping_get_error(defunctPingObject) << std::endl;
+    Batch batch;
+    batch.connection    = connection;
+    batch.tag           = connection->currentTag();
+    batch.statuses      = statuses;
+    batch.numberPending = 0;
+    batch.sync          = false;
+    batch.numberRemoved = 0;
+
+    submitBatch(batch);
+}
+
+
+void Pinger::syncServers(const QVector<BatchItem>& items, Connection* connection) {
+    unsigned long                           batchId       = nextBatchId;
+    unsigned long                           numberPending = 0;
+    unsigned long                           numberRemoved = 0;
+    unsigned                                numberItems   = static_cast<unsigned>(items.size());
+    QByteArray                              statuses(static_cast<int>(numberItems), char(BatchStatus::OK));
+    QSet<unsigned long>                     desired;
+    QVector<QVector<PingEngine::HostEntry>> additions(engines.size());
+    QVector<QVector<unsigned long>>         removals(engines.size());
+
+    desired.reserve(static_cast<int>(numberItems));
+    for (unsigned index=0 ; index<numberItems ; ++index) {
+        const BatchItem& item = items.at(index);
+        BatchStatus      status;
+
+        if (item.hostId == 0) {
+            status = BatchStatus::MALFORMED;
+        } else if (desired.contains(item.hostId)) {
+            status = BatchStatus::DUPLICATE_ID;
         } else {
-            pingobj_t* newDefunctPingObject = createPingObject();
-            bool       deleteNewPingObject  = true;
-
-            size_t bufferSize            = sizeof(double);
-            for (pingobj_iter_t* it=ping_iterator_get(defunctPingObject) ; it!=nullptr ; it=ping_iterator_next(it)) {
-                ServerData* server = reinterpret_cast<ServerData*>(ping_iterator_get_context(it));
-                if (server != nullptr) {
-                    double latency;
-                    int status = ping_iterator_get_info(it, PING_INFO_LATENCY, &latency, &bufferSize);
-                    if (status == 0) {
-                        if (latency >= 0) {
-                            server->setStatus(ServerData::Status::ACTIVE);
-                            addActiveServer(server);
-                            std::cout << "Defunct server now active: "
-                                      << server->serverName().toLocal8Bit().data() << std::endl;
-                        } else {
-                            int result = ping_host_add_with_context(
-                                newDefunctPingObject,
-                                server->serverName().toUtf8().data(),
-                                server
-                            );
-                            if (result != 0) {
-                                const char* errorMessage = ping_get_error(newDefunctPingObject);
-                                std::cerr << "*** Failed to re-add defunct host "
-                                          << server->serverName().toLocal8Bit().data()
-                                          << ": " << errorMessage << std::endl;
-                            } else {
-                                deleteNewPingObject = false;
-                            }
+            desired.insert(item.hostId);
+
+            HostTable::Handle                                   handle  = hostTable.find(item.hostId);
+            QHash<unsigned long, PendingServer>::const_iterator pending = pendingServers.constFind(item.hostId);
+
+            bool renamed = false;
+            if (handle != HostTable::invalidHandle) {
+                renamed = !hostTable.isNamed(handle, item.serverName);
+                if (renamed) {
+                    dropServer(item.hostId);
+                    removals[static_cast<int>(shardFor(item.hostId))].append(item.hostId);
+                }
+            } else if (pending != pendingServers.constEnd()) {
+                renamed = (pending.value().serverName != item.serverName);
+                if (renamed) {
+                    dropServer(item.hostId);
+                }
+            }
+
+            if (!renamed && (handle != HostTable::invalidHandle || pending != pendingServers.constEnd())) {
+                setOwner(item.hostId, connection);
+                status = BatchStatus::KEPT;
+            } else {
+                PingEngine::HostEntry entry;
+                status = beginAddServer(item.hostId, item.serverName, nullptr, batchId, index, entry.address);
+                if (status == BatchStatus::OK || status == BatchStatus::PENDING) {
+                    setOwner(item.hostId, connection);
+                }
+
+                if (status == BatchStatus::OK) {
+                    handle = recordServer(item.hostId, item.serverName, entry.address, QString());
+                    if (handle != HostTable::invalidHandle) {
+                        entry.hostId  = item.hostId;
+                        entry.context = hostTable.context(handle);
+                        additions[static_cast<int>(shardFor(item.hostId))].append(entry);
+
+                        if (renamed) {
+                            status = BatchStatus::RENAMED;
                         }
                     } else {
-                        std::cerr << "*** Failed to get latency "
-                                  << server->serverName().toLocal8Bit().data() << std::endl;
+                        status = BatchStatus::FAILED;
+                    }
+                } else if (status == BatchStatus::PENDING) {
+                    ++numberPending;
+                    if (renamed) {
+                        status = BatchStatus::RENAMED;
                     }
-                } else {
-                    std::cerr << "*** Ping structure missing server entry" << std::endl;
                 }
             }
+        }
 
-            ping_destroy(defunctPingObject);
-            if (!deleteNewPingObject) {
-                defunctPingObject = newDefunctPingObject;
-            } else {
-                defunctPingObject = nullptr;
-                ping_destroy(newDefunctPingObject);
-            }
+        statuses[static_cast<int>(index)] = char(status);
+    }
+
+    QVector<unsigned long> unwanted;
+    HostTable::Handle      numberHandles = hostTable.numberHandles();
+    for (HostTable::Handle handle=0 ; handle<numberHandles ; ++handle) {
+        unsigned long hostId = hostTable.hostId(handle);
+        if (hostId != 0 && !desired.contains(hostId)) {
+            unwanted.append(hostId);
         }
     }
+
+    for (QHash<unsigned long, PendingServer>::const_iterator it  = pendingServers.constBegin(),
+                                                             end = pendingServers.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        if (!desired.contains(it.key())) {
+            unwanted.append(it.key());
+        }
+    }
+
+    for (QVector<unsigned long>::const_iterator it=unwanted.constBegin(),end=unwanted.constEnd() ; it!=end ; ++it) {
+        unsigned long hostId = *it;
+        if (dropServer(hostId) == BatchStatus::OK) {
+            removals[static_cast<int>(shardFor(hostId))].append(hostId);
+        }
+
+        ++numberRemoved;
+    }
+
+    // Removals are queued first so that a renamed server's old entry is gone before its replacement arrives.
+    queueRemovals(removals);
+    queueAdditions(additions);
+
+    Batch batch;
+    batch.connection    = connection;
+    batch.tag           = connection->currentTag();
+    batch.statuses      = statuses;
+    batch.numberPending = numberPending;
+    batch.sync          = true;
+    batch.numberRemoved = numberRemoved;
+
+    submitBatch(batch);
 }
 
 
-bool Pinger::addUntestedServer(ServerData* serverData) {
-    if (untestedPingObject == nullptr) {
-        untestedPingObject = createPingObject();
+void Pinger::resumeEvents(std::uint64_t lastSequence, Connection* connection) {
+    std::uint64_t firstSequence  = eventLog.firstSequence();
+    std::uint64_t finalSequence  = eventLog.lastSequence();
+    std::uint64_t sequence       = lastSequence + 1;
+    unsigned long numberLost     = 0;
+    unsigned long numberReplayed = 0;
+    bool          reset          = false;
+
+    if (lastSequence == 0) {
+        sequence = firstSequence;
+    } else if (!eventLog.isIssued(lastSequence)) {
+        // The sequence number comes from an earlier run or was never issued.  The number of missed events is unknown
+        // so report the reset and let the client re-query the servers it cares about.
+        reset    = true;
+        sequence = firstSequence;
+    } else if (sequence < firstSequence) {
+        // The client fell too far behind and has to re-query the servers it cares about.
+        numberLost = static_cast<unsigned long>(firstSequence - sequence);
+        sequence   = firstSequence;
+    }
+
+    connection->setStreaming();
+    for ( ; sequence<=finalSequence ; ++sequence) {
+        const EventLog::Entry& entry = eventLog.entry(sequence);
+        if (isSubscribed(connection, entry.hostId)) {
+            connection->sendEvent(Connection::sequencedEvent(entry));
+            ++numberReplayed;
+        }
     }
 
-    int result = ping_host_add_with_context(untestedPingObject, serverData->serverName().toUtf8().data(), serverData);
-    if (result != 0) {
-        const char* errorMessage = ping_get_error(untestedPingObject);
-        std::cerr << "*** Failed to add untested host " << serverData->serverName().toLocal8Bit().data()
-                  << ": " << errorMessage << std::endl;
+    connection->sendResumed(numberReplayed, numberLost, finalSequence, reset);
+}
+
+
+void Pinger::subscribe(
+        Subscription      subscription,
+        unsigned long     firstId,
+        unsigned long     lastId,
+        Connection*       connection,
+        const QByteArray& clientName
+    ) {
+    if (subscription == Subscription::RANGE) {
+        RangeSubscription range;
+        range.firstId    = firstId;
+        range.lastId     = lastId;
+        range.connection = connection;
+
+        allSubscribers.remove(connection);
+        rangeSubscriptions.append(range);
+        rebuildRangeIndex();
+    } else {
+        allSubscribers.remove(connection);
+        ownerSubscribers.remove(connection);
+        removeRangeSubscriptions(connection);
+
+        if (subscription == Subscription::ALL) {
+            allSubscribers.insert(connection);
+        } else if (subscription == Subscription::OWN) {
+            ownerSubscribers.insert(connection);
+
+            if (!clientName.isEmpty()) {
+                clientNames.insert(connection, clientName);
+
+                // Servers removed while the client was away are skipped, as are servers another client has since
+                // registered.
+                QSet<unsigned long> detached = detachedHosts.take(clientName);
+                for (QSet<unsigned long>::const_iterator it=detached.constBegin(),end=detached.constEnd()
+                     ; it!=end
+                     ; ++it
+                    ) {
+                    unsigned long hostId = *it;
+                    if (   !hostOwners.contains(hostId)
+                        && (hostTable.find(hostId) != HostTable::invalidHandle || pendingServers.contains(hostId))
+                       ) {
+                        setOwner(hostId, connection);
+                    }
+                }
+            }
+        }
     }
 
-    return result == 0;
+    connection->sendStatus(BatchStatus::OK);
 }
 
 
-bool Pinger::addActiveServer(ServerData* serverData) {
-    if (activePingObject == nullptr) {
-        activePingObject = createPingObject();
+Pinger::BatchStatus Pinger::beginAddServer(
+        unsigned long  hostId,
+        const QString& serverName,
+        Connection*    connection,
+        unsigned long  batchId,
+        unsigned       batchIndex,
+        HostAddress&   address
+    ) {
+    BatchStatus status;
+
+    HostTable::Handle                                   handle          = hostTable.find(hostId);
+    QHash<unsigned long, PendingServer>::const_iterator pendingIterator = pendingServers.constFind(hostId);
+    if (handle != HostTable::invalidHandle) {
+        status = hostTable.isNamed(handle, serverName) ? BatchStatus::DUPLICATE_REQUEST : BatchStatus::DUPLICATE_ID;
+    } else if (pendingIterator != pendingServers.constEnd()) {
+        status = (
+              pendingIterator.value().serverName != serverName
+            ? BatchStatus::DUPLICATE_ID
+            : BatchStatus::DUPLICATE_REQUEST
+        );
+    } else if (resolverCache->acquire(serverName, hostId, address)) {
+        status = BatchStatus::OK;
+    } else {
+        PendingServer pendingServer;
+        pendingServer.serverName = serverName;
+        pendingServer.connection = connection;
+        pendingServer.tag        = connection != nullptr ? connection->currentTag() : 0;
+        pendingServer.batchId    = batchId;
+        pendingServer.batchIndex = batchIndex;
+
+        pendingServers.insert(hostId, pendingServer);
+        status = BatchStatus::PENDING;
     }
 
-    int result = ping_host_add_with_context(activePingObject, serverData->serverName().toUtf8().data(), serverData);
-    if (result != 0) {
-        const char* errorMessage = ping_get_error(activePingObject);
-        std::cerr << "*** Failed to add active host " << serverData->serverName().toLocal8Bit().data()
-                  << ": " << errorMessage << std::endl;
+    if (status == BatchStatus::DUPLICATE_ID) {
+        std::cerr << "*** Failed to add server (duplicate ID)" << serverName.toLocal8Bit().data() << std::endl;
+    } else if (status == BatchStatus::DUPLICATE_REQUEST) {
+        std::cerr << "*** Failed to add server (duplicate req)" << serverName.toLocal8Bit().data() << std::endl;
     }
 
-    return result == 0;
+    return status;
 }
 
 
-bool Pinger::addDefunctServer(ServerData* serverData) {
-    if (defunctPingObject == nullptr) {
-        defunctPingObject = createPingObject();
+void Pinger::assignStatusSlot(HostTable::Handle handle, unsigned long hostId, ServerData::Status status) {
+    unsigned slot = statusTable.allocate(hostId, status);
+    if (slot == StatusTable::noSlot && statusTable.numberOverflows() == 1) {
+        std::cerr << "*** Status table is full, server " << hostId << " and later servers are not published"
+                  << std::endl;
     }
 
-    int result = ping_host_add_with_context(defunctPingObject, serverData->serverName().toUtf8().data(), serverData);
-    if (result != 0) {
-        std::cerr << "*** Failed to add defunct host " << serverData->serverName().toLocal8Bit().data()
-                  << ": " << ping_get_error(defunctPingObject) << std::endl;
+    hostTable.setStatusSlot(handle, slot);
+}
+
+
+HostTable::Handle Pinger::recordServer(
+        unsigned long      hostId,
+        const QString&     serverName,
+        const HostAddress& address,
+        const QString&     errorMessage
+    ) {
+    HostTable::Handle handle;
+
+    if (!address.isNull()) {
+        handle = hostTable.insert(hostId, serverName);
+        assignStatusSlot(handle, hostId, ServerData::Status::UNTESTED);
+        std::cout << "Adding server " << serverName.toLocal8Bit().data() << std::endl;
+    } else {
+        std::cerr << "*** Failed to add server " << serverName.toLocal8Bit().data()
+                  << ": " << errorMessage.toLocal8Bit().data() << std::endl;
+
+        clearOwner(hostId);
+
+        handle = HostTable::invalidHandle;
     }
 
-    return result == 0;
+    return handle;
 }
 
 
-bool Pinger::rebuildUntestedServerList() {
-    if (untestedPingObject != nullptr) {
-        ping_destroy(untestedPingObject);
+Pinger::BatchStatus Pinger::dropServer(unsigned long hostId) {
+    BatchStatus status;
+
+    HostTable::Handle handle = hostTable.find(hostId);
+    if (handle != HostTable::invalidHandle) {
+        ServerData::Status serverStatus = hostTable.status(handle);
+        const QByteArray&  serverName   = hostTable.serverName(handle);
+        if (serverStatus == ServerData::Status::UNTESTED) {
+            std::cout << "Removing untested server " << serverName.constData() << std::endl;
+        } else if (serverStatus == ServerData::Status::DEFUNCT) {
+            std::cout << "Removing defunct server " << serverName.constData() << std::endl;
+        } else {
+            std::cout << "Removing active server " << serverName.constData() << std::endl;
+        }
+
+        resolverCache->release(QString::fromUtf8(serverName), hostId);
+        statusTable.release(hostTable.statusSlot(handle));
+        hostTable.erase(handle);
+        clearOwner(hostId);
+
+        status = BatchStatus::OK;
+    } else {
+        QHash<unsigned long, PendingServer>::iterator pendingIterator = pendingServers.find(hostId);
+        if (pendingIterator != pendingServers.end()) {
+            unsigned long batchId    = pendingIterator.value().batchId;
+            unsigned      batchIndex = pendingIterator.value().batchIndex;
+            Connection*   connection = pendingIterator.value().connection;
+            unsigned long tag        = pendingIterator.value().tag;
+            pendingServers.erase(pendingIterator);
+            clearOwner(hostId);
+
+            std::cout << "Removing unresolved server " << hostId << std::endl;
+            if (batchId != 0) {
+                completeBatchItem(batchId, batchIndex, BatchStatus::CANCELLED);
+            } else if (connection != nullptr) {
+                // The single add is still owed a reply.
+                connection->sendStatus(BatchStatus::CANCELLED, tag);
+            }
+
+            status = BatchStatus::CANCELLED;
+        } else {
+            std::cerr << "*** Failed to remove server " << hostId << std::endl;
+            status = BatchStatus::NO_SERVER;
+        }
     }
 
-    untestedPingObject = createPingObject();
+    return status;
+}
 
-    bool deletePingObject = true;
-    for (  QHash<unsigned long, ServerData>::const_iterator it = serverData.constBegin(), end = serverData.constEnd()
-         ; it != end
-         ; ++it
-        ) {
-        const ServerData* server = &(it.value());
-        if (server->status() == ServerData::Status::UNTESTED) {
-            int result = ping_host_add_with_context(
-                untestedPingObject,
-                server->serverName().toUtf8().data(),
-                const_cast<ServerData*>(server)
-            );
 
-            if (result != 0) {
-                std::cerr << "*** Failed to re-add untested host " << server->serverName().toLocal8Bit().data()
-                          << ": " << ping_get_error(untestedPingObject) << std::endl;
+Pinger::BatchStatus Pinger::setServerDefunct(unsigned long hostId) {
+    BatchStatus status;
 
+    HostTable::Handle handle = hostTable.find(hostId);
+    if (handle != HostTable::invalidHandle) {
+        ServerData::Status serverStatus = hostTable.status(handle);
+        if (serverStatus != ServerData::Status::DEFUNCT) {
+            hostTable.setStatus(handle, ServerData::Status::DEFUNCT);
+            statusTable.publish(hostTable.statusSlot(handle), ServerData::Status::DEFUNCT);
+
+            if (serverStatus == ServerData::Status::UNTESTED) {
+                std::cout << "Marked untested as defunct " << hostId << std::endl;
             } else {
-                deletePingObject = false;
+                std::cout << "Marked active as defunct " << hostId << std::endl;
             }
+
+            status = BatchStatus::OK;
+        } else {
+            std::cerr << "*** Failed to mark defunct " << hostId << " (already defunct)" << std::endl;
+            status = BatchStatus::ALREADY_DEFUNCT;
+        }
+    } else {
+        std::cerr << "*** Failed to mark defunct " << hostId << " (bad ID)" << std::endl;
+        status = BatchStatus::NO_SERVER;
+    }
+
+    return status;
+}
+
+
+void Pinger::completeBatchItem(unsigned long batchId, unsigned batchIndex, BatchStatus status) {
+    QHash<unsigned long, Batch>::iterator it = batches.find(batchId);
+    if (it != batches.end()) {
+        Batch& batch = it.value();
+
+        // Keep the renamed marker for replaced servers so the client can tell them from new servers.
+        int index = static_cast<int>(batchIndex);
+        if (status != BatchStatus::OK || batch.statuses.at(index) != char(BatchStatus::RENAMED)) {
+            batch.statuses[index] = char(status);
+        }
+
+        --batch.numberPending;
+        if (batch.numberPending == 0) {
+            sendBatchReply(batch);
+            batches.erase(it);
+        }
+    }
+}
+
+
+void Pinger::queueAdditions(const QVector<QVector<PingEngine::HostEntry>>& additions) {
+    for (int shardIndex=0 ; shardIndex<engines.size() ; ++shardIndex) {
+        const QVector<PingEngine::HostEntry>& entries = additions.at(shardIndex);
+        if (!entries.isEmpty()) {
+            PingEngine* engine = engines.at(shardIndex);
+            QMetaObject::invokeMethod(
+                engine,
+                [engine, entries]() {
+                    engine->addHosts(PingEngine::Pool::UNTESTED, entries);
+                },
+                Qt::QueuedConnection
+            );
         }
     }
+}
+
 
-    if (deletePingObject) {
-        ping_destroy(untestedPingObject);
-        untestedPingObject = nullptr;
+void Pinger::queueRemovals(const QVector<QVector<unsigned long>>& removals) {
+    for (int shardIndex=0 ; shardIndex<engines.size() ; ++shardIndex) {
+        const QVector<unsigned long>& hostIds = removals.at(shardIndex);
+        if (!hostIds.isEmpty()) {
+            PingEngine* engine = engines.at(shardIndex);
+            QMetaObject::invokeMethod(
+                engine,
+                [engine, hostIds]() {
+                    engine->removeHosts(hostIds);
+                },
+                Qt::QueuedConnection
+            );
+        }
     }
+}
 
-    return true;
+
+void Pinger::submitBatch(const Batch& batch) {
+    if (batch.numberPending > 0) {
+        batches.insert(nextBatchId, batch);
+        ++nextBatchId;
+    } else {
+        sendBatchReply(batch);
+    }
 }
 
 
-bool Pinger::rebuildActiveServerList() {
-    if (activePingObject != nullptr) {
-        ping_destroy(activePingObject);
+void Pinger::sendBatchReply(const Batch& batch) {
+    if (batch.connection != nullptr) {
+        const QByteArray& statuses     = batch.statuses;
+        unsigned long     numberFailed = static_cast<unsigned long>(
+              statuses.size()
+            - statuses.count(char(BatchStatus::OK))
+            - statuses.count(char(BatchStatus::KEPT))
+            - statuses.count(char(BatchStatus::RENAMED))
+        );
+
+        if (batch.sync) {
+            batch.connection->sendSyncResult(statuses, batch.numberRemoved, numberFailed, batch.tag);
+        } else {
+            batch.connection->sendBatchResult(statuses, numberFailed, batch.tag);
+        }
     }
+}
+
+
+void Pinger::moveServer(unsigned long hostId, PingEngine::Pool pool) {
+    PingEngine* engine = engineFor(hostId);
+    QMetaObject::invokeMethod(
+        engine,
+        [engine, hostId, pool]() {
+            engine->moveHost(hostId, pool);
+        },
+        Qt::QueuedConnection
+    );
+}
+
+
+unsigned Pinger::shardFor(unsigned long hostId) const {
+    // Host IDs are typically sequential so mix the bits before reducing to a shard index.
+    std::uint64_t hash = static_cast<std::uint64_t>(hostId) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<unsigned>((hash >> 32) % static_cast<std::uint64_t>(engines.size()));
+}
+
 
-    activePingObject = createPingObject();
+PingEngine* Pinger::engineFor(unsigned long hostId) const {
+    return engines.at(static_cast<int>(shardFor(hostId)));
+}
 
-    bool deletePingObject = true;
-    for (  QHash<unsigned long, ServerData>::const_iterator it = serverData.constBegin(), end = serverData.constEnd()
-         ; it != end
+
+void Pinger::reportEvent(EventLog::Kind kind, HostTable::Handle handle) {
+    const EventLog::Entry& entry  = eventLog.append(kind, hostTable.hostId(handle), hostTable.serverName(handle));
+    unsigned long          hostId = entry.hostId;
+
+    // Encode each flavor at most once.  Connections that never resumed only understand failure reports.
+    bool              sequencedEncoded = false;
+    bool              legacyEncoded    = false;
+    Connection::Event sequencedEvent;
+    Connection::Event legacyEvent;
+
+    auto deliver = [&](Connection* connection) {
+        if (connection->isStreaming()) {
+            if (!sequencedEncoded) {
+                sequencedEvent   = Connection::sequencedEvent(entry);
+                sequencedEncoded = true;
+            }
+
+            connection->sendEvent(sequencedEvent);
+        } else if (kind == EventLog::Kind::FAILED) {
+            if (!legacyEncoded) {
+                legacyEvent   = Connection::noPingEvent(hostId, entry.serverName);
+                legacyEncoded = true;
+            }
+
+            connection->sendEvent(legacyEvent);
+        }
+    };
+
+    // Subscribing to ALL ends every other subscription and a segment lists each connection once so only the owner
+    // can be reached twice.  Delivery never modifies the subscriber sets; dropped connections are removed later.
+    for (QSet<Connection*>::const_iterator it=allSubscribers.constBegin(),end=allSubscribers.constEnd()
+         ; it!=end
          ; ++it
         ) {
-        const ServerData* server = &(it.value());
-        if (server->status() != ServerData::Status::DEFUNCT && server->status() != ServerData::Status::UNTESTED) {
-            int result = ping_host_add_with_context(
-                activePingObject,
-                server->serverName().toUtf8().data(),
-                const_cast<ServerData*>(server)
-            );
+        deliver(*it);
+    }
 
-            if (result != 0) {
-                std::cerr << "*** Failed to re-add active host " << server->serverName().toLocal8Bit().data()
-                          << ": " << ping_get_error(activePingObject) << std::endl;
+    Connection* owner = hostOwners.value(hostId, nullptr);
+    if (owner != nullptr && ownerSubscribers.contains(owner)) {
+        deliver(owner);
+    } else {
+        owner = nullptr;
+    }
 
-            } else {
-                deletePingObject = false;
+    const RangeSegment* segment = findRangeSegment(hostId);
+    if (segment != nullptr) {
+        for (QVector<Connection*>::const_iterator
+                 it=segment->connections.constBegin(),
+                 end=segment->connections.constEnd()
+             ; it!=end
+             ; ++it
+            ) {
+            if (*it != owner) {
+                deliver(*it);
             }
         }
     }
+}
+
 
-    if (deletePingObject) {
-        ping_destroy(activePingObject);
-        activePingObject = nullptr;
+bool Pinger::isSubscribed(const Connection* connection, unsigned long hostId) const {
+    bool subscribed = (
+           allSubscribers.contains(const_cast<Connection*>(connection))
+        || (   ownerSubscribers.contains(const_cast<Connection*>(connection))
+            && hostOwners.value(hostId, nullptr) == connection
+           )
+    );
+
+    if (!subscribed) {
+        const RangeSegment* segment = findRangeSegment(hostId);
+        subscribed = (segment != nullptr && segment->connections.contains(const_cast<Connection*>(connection)));
     }
 
-    return true;
+    return subscribed;
+}
+
+
+void Pinger::setOwner(unsigned long hostId, Connection* connection) {
+    if (connection != nullptr) {
+        Connection* previousOwner = hostOwners.value(hostId, nullptr);
+        if (previousOwner != connection) {
+            if (previousOwner != nullptr) {
+                ownedHosts[previousOwner].remove(hostId);
+            }
+
+            hostOwners.insert(hostId, connection);
+            ownedHosts[connection].insert(hostId);
+        }
+    }
 }
 
 
-bool Pinger::rebuildDefunctServerList() {
-    if (defunctPingObject != nullptr) {
-        ping_destroy(defunctPingObject);
+void Pinger::clearOwner(unsigned long hostId) {
+    QHash<unsigned long, Connection*>::iterator ownerIterator = hostOwners.find(hostId);
+    if (ownerIterator != hostOwners.end()) {
+        ownedHosts[ownerIterator.value()].remove(hostId);
+        hostOwners.erase(ownerIterator);
     }
+}
 
-    defunctPingObject = createPingObject();
 
-    bool deletePingObject = true;
-    for (  QHash<unsigned long, ServerData>::const_iterator it = serverData.constBegin(), end = serverData.constEnd()
-         ; it != end
+void Pinger::removeRangeSubscriptions(Connection* connection) {
+    int destination = 0;
+    for (int source=0 ; source<rangeSubscriptions.size() ; ++source) {
+        if (rangeSubscriptions.at(source).connection != connection) {
+            rangeSubscriptions[destination] = rangeSubscriptions.at(source);
+            ++destination;
+        }
+    }
+
+    if (destination != rangeSubscriptions.size()) {
+        rangeSubscriptions.resize(destination);
+        rebuildRangeIndex();
+    }
+}
+
+
+void Pinger::rebuildRangeIndex() {
+    // Every range start and every ID just past a range end opens a new segment.  Subscriptions change rarely so the
+    // index is simply rebuilt from scratch.
+    QVector<unsigned long> boundaries;
+    for (QVector<RangeSubscription>::const_iterator it=rangeSubscriptions.constBegin(),end=rangeSubscriptions.constEnd()
+         ; it!=end
          ; ++it
         ) {
-        const ServerData* server = &(it.value());
-        if (server->status() == ServerData::Status::DEFUNCT) {
-            int result = ping_host_add_with_context(
-                defunctPingObject,
-                server->serverName().toUtf8().data(),
-                const_cast<ServerData*>(server)
-            );
-
-            if (result != 0) {
-                std::cerr << "*** Failed to re-add defunct host " << server->serverName().toLocal8Bit().data()
-                          << ": " << ping_get_error(defunctPingObject) << std::endl;
+        boundaries.append(it->firstId);
+        if (it->lastId != std::numeric_limits<unsigned long>::max()) {
+            boundaries.append(it->lastId + 1);
+        }
+    }
 
-            } else {
-                deletePingObject = false;
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.resize(static_cast<int>(std::unique(boundaries.begin(), boundaries.end()) - boundaries.begin()));
+
+    rangeSegments.clear();
+    rangeSegments.reserve(boundaries.size());
+    for (QVector<unsigned long>::const_iterator it=boundaries.constBegin(),end=boundaries.constEnd() ; it!=end ; ++it) {
+        RangeSegment segment;
+        segment.firstId = *it;
+
+        for (QVector<RangeSubscription>::const_iterator
+                 rangeIterator=rangeSubscriptions.constBegin(),
+                 rangeEnd=rangeSubscriptions.constEnd()
+             ; rangeIterator!=rangeEnd
+             ; ++rangeIterator
+            ) {
+            if (   segment.firstId >= rangeIterator->firstId
+                && segment.firstId <= rangeIterator->lastId
+                && !segment.connections.contains(rangeIterator->connection)
+               ) {
+                segment.connections.append(rangeIterator->connection);
             }
         }
+
+        rangeSegments.append(segment);
     }
+}
+
+
+const Pinger::RangeSegment* Pinger::findRangeSegment(unsigned long hostId) const {
+    const RangeSegment* result = nullptr;
+
+    QVector<RangeSegment>::const_iterator it = std::upper_bound(
+        rangeSegments.constBegin(),
+        rangeSegments.constEnd(),
+        hostId,
+        [](unsigned long id, const RangeSegment& segment) {
+            return id < segment.firstId;
+        }
+    );
 
-    if (deletePingObject) {
-        ping_destroy(defunctPingObject);
-        defunctPingObject = nullptr;
+    if (it != rangeSegments.constBegin()) {
+        --it;
+        if (!it->connections.isEmpty()) {
+            result = &(*it);
+        }
     }
 
-    return true;
+    return result;
 }
 
 
-void Pinger::reportFailedServer(ServerData* server) {
-    for (QSet<Connection*>::iterator it=connections.begin(),end=connections.end() ; it!=end ; ++it) {
-        Connection* connection = *it;
-        connection->sendMessage(QString("NOPING %1 %2\n").arg(server->serverId()).arg(server->serverName()));
+void Pinger::reportLatency(unsigned long hostId, Connection* connection) {
+    HostTable::Handle handle = hostTable.find(hostId);
+    if (handle != HostTable::invalidHandle) {
+        connection->sendLatency(hostId, hostTable.latency(handle));
+    } else {
+        connection->sendStatus(BatchStatus::NO_SERVER);
     }
 }
 
 
-pingobj_t* Pinger::createPingObject() {
-    pingobj_t* result = ping_construct();
+void Pinger::reportStatistics(Connection* connection) {
+    unsigned long probesInFlight   = 0;
+    unsigned long probeOverruns    = 0;
+    unsigned long scheduleOverruns = 0;
+    unsigned long budgetExhausted  = 0;
+    unsigned long sendLag          = 0;
+    unsigned long worstSendLag     = 0;
+    unsigned long hostAdds         = 0;
+    unsigned long hostRemoves      = 0;
+    unsigned long hostMoves        = 0;
+    unsigned long probesSent       = 0;
+    unsigned long repliesReceived  = 0;
+    unsigned long probesExpired    = 0;
+    unsigned long probesSaved      = 0;
+    unsigned long systemCalls      = 0;
+    unsigned long cpuTime          = 0;
+    unsigned long outputQueued     = 0;
+    unsigned long outputWritten    = closedBytesWritten;
+    double        resolveTime      = 0;
+    double        expiryTime       = 0;
+    QString       shardStatistics;
+
+    // Count everything held per server: the control thread's table, each shard's host records and ID index, and the
+    // resolver cache.
+    unsigned long memoryUsage = static_cast<unsigned long>(hostTable.memoryUsage() + resolverCache->memoryUsage());
+
+    for (QSet<Connection*>::const_iterator it=connections.constBegin(),end=connections.constEnd() ; it!=end ; ++it) {
+        outputQueued  += (*it)->queueDepth();
+        outputWritten += (*it)->numberBytesWritten();
+    }
 
-    double pingTimeout = 0.8 * activePingInterval / 1000.0;
-    ping_setopt(result, PING_OPT_TIMEOUT, &pingTimeout);
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        const PingEngine* engine = *it;
+        unsigned          shard  = engine->shardIndex();
+
+        probesInFlight   += engine->numberProbesInFlight();
+        probeOverruns    += engine->numberProbeOverruns();
+        scheduleOverruns += engine->numberScheduleOverruns();
+        budgetExhausted  += engine->numberBudgetExhausted();
+        hostAdds         += engine->numberHostAdds();
+        hostRemoves      += engine->numberHostRemoves();
+        hostMoves        += engine->numberHostMoves();
+        probesSent       += engine->numberProbesSent();
+        repliesReceived  += engine->numberRepliesReceived();
+        probesExpired    += engine->numberProbesExpired();
+        probesSaved      += engine->numberProbesSaved();
+        systemCalls      += engine->numberSystemCalls();
+        cpuTime          += engine->cpuTime();
+        resolveTime      += engine->totalResolveTime();
+        expiryTime       += engine->totalExpiryTime();
+        memoryUsage      += engine->memoryUsage();
+
+        sendLag      = std::max(sendLag, engine->lastSendLag());
+        worstSendLag = std::max(worstSendLag, engine->worstSendLag());
+
+        shardStatistics += QString(" shard%1_hosts=%2").arg(shard).arg(engine->numberHosts());
+        shardStatistics += QString(" shard%1_probes_in_flight=%2").arg(shard).arg(engine->numberProbesInFlight());
+        shardStatistics += QString(" shard%1_send_lag_usec=%2").arg(shard).arg(engine->lastSendLag());
+        shardStatistics += QString(" shard%1_probes=%2").arg(shard).arg(engine->numberProbesSent());
+        shardStatistics += QString(" shard%1_replies=%2").arg(shard).arg(engine->numberRepliesReceived());
+        shardStatistics += QString(" shard%1_cpu_msec=%2").arg(shard).arg(engine->cpuTime());
+        shardStatistics += QString(" shard%1_syscalls=%2").arg(shard).arg(engine->numberSystemCalls());
+    }
 
-    return result;
+    unsigned long numberHosts  = hostTable.size();
+    unsigned long bytesPerHost = numberHosts > 0 ? memoryUsage / numberHosts : 0;
+
+    double systemCallsPerProbe = probesSent > 0 ? static_cast<double>(systemCalls) / probesSent : 0;
+    double cpuPer10kProbes     = probesSent > 0 ? (10000.0 * cpuTime) / probesSent : 0;
+
+    unsigned long probesResolved  = repliesReceived + probesExpired;
+    double        meanResolveTime = probesResolved > 0 ? resolveTime / (1000.0 * probesResolved) : 0;
+    double        meanExpiryTime  = probesExpired > 0 ? expiryTime / (1000.0 * probesExpired) : 0;
+    double        meanDetectTime  = numberOutagesDetected > 0 ? totalDetectTime / numberOutagesDetected : 0;
+
+    double uptimeHours        = uptimeTimer.elapsed() / 3600000.0;
+    double probesSavedPerHour = uptimeHours > 0 ? probesSaved / uptimeHours : 0;
+
+    QString message("STATS");
+    message += QString(" hosts=%1").arg(numberHosts);
+    message += QString(" bytes_per_host=%1").arg(bytesPerHost);
+    message += QString(" shards=%1").arg(engines.size());
+    message += QString(" probes_in_flight=%1").arg(probesInFlight);
+    message += QString(" probe_overruns=%1").arg(probeOverruns);
+    message += QString(" schedule_overruns=%1").arg(scheduleOverruns);
+    message += QString(" budget_exhausted=%1").arg(budgetExhausted);
+    message += QString(" send_lag_usec=%1").arg(sendLag);
+    message += QString(" worst_send_lag_usec=%1").arg(worstSendLag);
+    message += QString(" loop_latency_msec=%1").arg(lastEventLoopLatency);
+    message += QString(" worst_in_flight_loop_latency_msec=%1").arg(worstInFlightEventLoopLatency);
+    message += QString(" connections=%1").arg(connections.size());
+    message += QString(" output_queued_bytes=%1").arg(outputQueued);
+    message += QString(" output_bytes=%1").arg(outputWritten);
+    message += QString(" slow_consumers=%1").arg(numberSlowConsumers);
+    message += QString(" pool_adds=%1").arg(hostAdds);
+    message += QString(" pool_removes=%1").arg(hostRemoves);
+    message += QString(" pool_moves=%1").arg(hostMoves);
+    message += QString(" probes=%1").arg(probesSent);
+    message += QString(" probes_expired=%1").arg(probesExpired);
+    message += QString(" outages_detected=%1").arg(numberOutagesDetected);
+    message += QString(" detect_msec=%1").arg(meanDetectTime, 0, 'f', 2);
+    message += QString(" probes_saved=%1").arg(probesSaved);
+    message += QString(" probes_saved_per_hour=%1").arg(probesSavedPerHour, 0, 'f', 0);
+    message += QString(" resolve_msec=%1").arg(meanResolveTime, 0, 'f', 2);
+    message += QString(" expiry_msec=%1").arg(meanExpiryTime, 0, 'f', 2);
+    message += QString(" syscalls=%1").arg(systemCalls);
+    message += QString(" syscalls_per_probe=%1").arg(systemCallsPerProbe, 0, 'f', 3);
+    message += QString(" cpu_msec_per_10k_probes=%1").arg(cpuPer10kProbes, 0, 'f', 2);
+    message += QString(" status_table_overflows=%1").arg(statusTable.numberOverflows());
+    message += QString(" dns_entries=%1").arg(resolverCache->numberEntries());
+    message += QString(" dns_hits=%1").arg(resolverCache->numberHits());
+    message += QString(" dns_misses=%1").arg(resolverCache->numberMisses());
+    message += QString(" dns_literals=%1").arg(resolverCache->numberLiterals());
+    message += QString(" dns_refreshes=%1").arg(resolverCache->numberRefreshes());
+    message += QString(" dns_changes=%1").arg(resolverCache->numberChanges());
+    message += QString(" dns_parallelism=%1").arg(resolverCache->maximumLookups());
+    message += QString(" dns_queue_depth=%1").arg(resolverCache->queueDepth());
+    message += QString(" dns_waiting_hosts=%1").arg(resolverCache->numberWaitingHosts());
+    message += QString(" dns_resolved=%1").arg(resolverCache->numberResolved());
+    message += QString(" dns_resolved_per_sec=%1").arg(resolverCache->resolvedPerSecond(), 0, 'f', 1);
+    message += shardStatistics;
+    message += QString("\n");
+
+    connection->sendMessage(message);
 }
@@ -0,0 +1,288 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref ResolverCache class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <iostream>
+#include <cstddef>
+
+#include "host_address.h"
+#include "resolver_cache.h"
+
+/**
+ * Approximate cost of a single hash table entry beyond its key and value, in bytes.
+ */
+static constexpr std::size_t hashEntryOverhead = 24;
+
+/**
+ * Approximate cost of a heap allocated string beyond its contents, in bytes.
+ */
+static constexpr std::size_t stringOverhead = 26;
+
+/***********************************************************************************************************************
+* ResolverCache::LookupTask
+*/
+
+ResolverCache::LookupTask::LookupTask(ResolverCache* cache, const QString& hostName) {
+    LookupTask::cache    = cache;
+    LookupTask::hostName = hostName;
+
+    setAutoDelete(true);
+}
+
+
+ResolverCache::LookupTask::~LookupTask() {}
+
+
+void ResolverCache::LookupTask::run() {
+    QString        errorMessage;
+    HostAddress    address  = HostAddress::resolve(hostName, &errorMessage);
+    ResolverCache* cache    = LookupTask::cache;
+    QString        hostName = LookupTask::hostName;
+
+    QMetaObject::invokeMethod(
+        cache,
+        [cache, hostName, address, errorMessage]() {
+            cache->lookupFinished(hostName, address, errorMessage);
+        },
+        Qt::QueuedConnection
+    );
+}
+
+/***********************************************************************************************************************
+* ResolverCache
+*/
+
+ResolverCache::ResolverCache(QObject* parent):QObject(parent) {
+    hits         = 0;
+    misses       = 0;
+    literals     = 0;
+    refreshes    = 0;
+    changes      = 0;
+    waitingHosts = 0;
+    resolved     = 0;
+    rateCount    = 0;
+    lastRate     = 0;
+
+    threadPool = new QThreadPool(this);
+    threadPool->setMaxThreadCount(defaultMaximumLookups);
+
+    checkTimer = new QTimer(this);
+    checkTimer->setSingleShot(false);
+    connect(checkTimer, &QTimer::timeout, this, &ResolverCache::checkEntries);
+    checkTimer->start(checkInterval);
+
+    rateTimer.start();
+}
+
+
+ResolverCache::~ResolverCache() {
+    threadPool->clear();
+    threadPool->waitForDone();
+}
+
+
+void ResolverCache::setMaximumLookups(unsigned newMaximumLookups) {
+    threadPool->setMaxThreadCount(static_cast<int>(newMaximumLookups > 0 ? newMaximumLookups : 1));
+}
+
+
+unsigned ResolverCache::maximumLookups() const {
+    return static_cast<unsigned>(threadPool->maxThreadCount());
+}
+
+
+bool ResolverCache::acquire(const QString& hostName, unsigned long hostId, HostAddress& address) {
+    bool available;
+
+    address = HostAddress::fromLiteral(hostName);
+    if (!address.isNull()) {
+        ++literals;
+        available = true;
+    } else {
+        QHash<QString, Entry>::iterator it = entries.find(hostName);
+        if (it != entries.end()) {
+            ++hits;
+            it.value().users.insert(hostId);
+            address   = it.value().address;
+            available = true;
+        } else {
+            QHash<QString, QList<unsigned long>>::iterator lookupIterator = lookups.find(hostName);
+            if (lookupIterator != lookups.end()) {
+                ++hits;
+                lookupIterator.value().append(hostId);
+            } else {
+                ++misses;
+                lookups.insert(hostName, QList<unsigned long>() << hostId);
+                threadPool->start(new LookupTask(this, hostName));
+            }
+
+            ++waitingHosts;
+            available = false;
+        }
+    }
+
+    return available;
+}
+
+
+void ResolverCache::release(const QString& hostName, unsigned long hostId) {
+    QHash<QString, Entry>::iterator it = entries.find(hostName);
+    if (it != entries.end()) {
+        it.value().users.remove(hostId);
+    }
+}
+
+
+std::size_t ResolverCache::memoryUsage() const {
+    std::size_t usage = 0;
+
+    for (QHash<QString, Entry>::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        usage += (
+              sizeof(QString) + sizeof(Entry) + hashEntryOverhead + stringOverhead
+            + sizeof(QChar) * static_cast<std::size_t>(it.key().size())
+            + (sizeof(unsigned long) + hashEntryOverhead) * static_cast<std::size_t>(it.value().users.size())
+        );
+    }
+
+    for (QHash<QString, QList<unsigned long>>::const_iterator it=lookups.constBegin(),end=lookups.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        usage += (
+              sizeof(QString) + sizeof(QList<unsigned long>) + hashEntryOverhead + stringOverhead
+            + sizeof(QChar) * static_cast<std::size_t>(it.key().size())
+            + sizeof(unsigned long) * static_cast<std::size_t>(it.value().size())
+        );
+    }
+
+    return usage;
+}
+
+
+double ResolverCache::resolvedPerSecond() const {
+    return rateTimer.elapsed() < 2 * rateWindow ? lastRate : 0;
+}
+
+
+void ResolverCache::checkEntries() {
+    std::int64_t currentTime = now();
+
+    QHash<QString, Entry>::iterator it  = entries.begin();
+    while (it != entries.end()) {
+        Entry& entry = it.value();
+        if (entry.expiresAt <= currentTime && !entry.refreshing) {
+            if (entry.users.isEmpty()) {
+                it = entries.erase(it);
+            } else {
+                entry.refreshing = true;
+                threadPool->start(new LookupTask(this, it.key()));
+
+                ++it;
+            }
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+void ResolverCache::lookupFinished(const QString& hostName, const HostAddress& address, const QString& errorMessage) {
+    QHash<QString, QList<unsigned long>>::iterator lookupIterator = lookups.find(hostName);
+    if (lookupIterator != lookups.end()) {
+        QList<unsigned long> hostIds = lookupIterator.value();
+        lookups.erase(lookupIterator);
+
+        ++resolved;
+        waitingHosts -= static_cast<unsigned long>(hostIds.size());
+        updateRate(static_cast<unsigned long>(hostIds.size()));
+
+        if (!address.isNull()) {
+            Entry entry;
+            entry.address    = address;
+            entry.expiresAt  = now() + timeToLive;
+            entry.refreshing = false;
+
+            for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+                entry.users.insert(*it);
+            }
+
+            entries.insert(hostName, entry);
+        }
+
+        for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+            emit lookupCompleted(*it, hostName, address, errorMessage);
+        }
+    } else {
+        QHash<QString, Entry>::iterator it = entries.find(hostName);
+        if (it != entries.end()) {
+            refreshCompleted(hostName, it.value(), address);
+        }
+    }
+}
+
+
+void ResolverCache::refreshCompleted(const QString& hostName, Entry& entry, const HostAddress& address) {
+    ++refreshes;
+    entry.refreshing = false;
+
+    if (address.isNull()) {
+        entry.expiresAt = now() + retryInterval;
+        std::cerr << "*** Failed to refresh address for " << hostName.toLocal8Bit().data() << std::endl;
+    } else {
+        entry.expiresAt = now() + timeToLive;
+
+        if (!entry.address.matches(address.socketAddress())) {
+            ++changes;
+            entry.address = address;
+
+            std::cout << "Address for " << hostName.toLocal8Bit().data() << " changed to "
+                      << address.toString().toLocal8Bit().data() << std::endl;
+
+            emit addressChanged(entry.users.values(), address);
+        }
+    }
+}
+
+
+void ResolverCache::updateRate(unsigned long numberHosts) {
+    rateCount += numberHosts;
+
+    qint64 elapsed = rateTimer.elapsed();
+    if (elapsed >= rateWindow) {
+        lastRate  = (1000.0 * rateCount) / elapsed;
+        rateCount = 0;
+        rateTimer.restart();
+    }
+}
+
+
+std::int64_t ResolverCache::now() {
+    return static_cast<std::int64_t>(QDateTime::currentSecsSinceEpoch());
+}
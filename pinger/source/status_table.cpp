@@ -0,0 +1,216 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref StatusTable class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "status_table_layout.h"
+#include "server_data.h"
+#include "status_table.h"
+
+StatusTable::StatusTable() {
+    header      = nullptr;
+    tableSlots  = nullptr;
+    mappingSize = 0;
+    capacity    = 0;
+    numberUsed    = 0;
+    numberRefused = 0;
+    updateTime    = 0;
+}
+
+
+StatusTable::~StatusTable() {
+    close();
+}
+
+
+bool StatusTable::open(const QString& name, unsigned newCapacity) {
+    close();
+
+    objectName = name.toLocal8Bit();
+    if (!objectName.startsWith('/')) {
+        objectName.prepend('/');
+    }
+
+    mappingSize = sizeof(StatusTableHeader) + sizeof(StatusTableSlot) * static_cast<std::size_t>(newCapacity);
+
+    // Resizing an existing object would pull pages out from under readers that still map it, so always start from a
+    // fresh object.  The old one lives on until its last reader unmaps it.
+    ::shm_unlink(objectName.constData());
+
+    bool success = false;
+    int  fd      = ::shm_open(objectName.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd >= 0) {
+        if (::ftruncate(fd, static_cast<off_t>(mappingSize)) == 0) {
+            void* mapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                header     = new(mapping) StatusTableHeader;
+                tableSlots = reinterpret_cast<StatusTableSlot*>(header + 1);
+
+                for (unsigned slot=0 ; slot<newCapacity ; ++slot) {
+                    StatusTableSlot* entry = new(tableSlots + slot) StatusTableSlot;
+                    entry->version.store(0, std::memory_order_relaxed);
+                    entry->status.store(0, std::memory_order_relaxed);
+                    entry->hostId.store(0, std::memory_order_relaxed);
+                    entry->lastRtt.store(statusTableNoRtt, std::memory_order_relaxed);
+                    entry->reserved.store(0, std::memory_order_relaxed);
+                    entry->lastSeen.store(0, std::memory_order_relaxed);
+                }
+
+                capacity      = newCapacity;
+                numberUsed    = 0;
+                numberRefused = 0;
+                freeSlots.clear();
+
+                header->layoutVersion = statusTableLayoutVersion;
+                header->slotSize      = sizeof(StatusTableSlot);
+                header->capacity      = newCapacity;
+                header->reserved      = 0;
+                header->numberSlots.store(0, std::memory_order_relaxed);
+                header->updatedAt.store(
+                    static_cast<std::uint64_t>(QDateTime::currentMSecsSinceEpoch()),
+                    std::memory_order_relaxed
+                );
+                header->magic.store(statusTableMagic, std::memory_order_release);
+
+                success = true;
+            } else {
+                setError("mmap");
+                ::shm_unlink(objectName.constData());
+            }
+        } else {
+            setError("ftruncate");
+            ::shm_unlink(objectName.constData());
+        }
+
+        ::close(fd);
+    } else {
+        setError("shm_open");
+    }
+
+    if (!success) {
+        mappingSize = 0;
+    }
+
+    return success;
+}
+
+
+void StatusTable::close() {
+    if (header != nullptr) {
+        header->magic.store(0, std::memory_order_release);
+        ::munmap(header, mappingSize);
+        ::shm_unlink(objectName.constData());
+
+        header      = nullptr;
+        tableSlots  = nullptr;
+        mappingSize = 0;
+        capacity    = 0;
+        numberUsed  = 0;
+        freeSlots.clear();
+    }
+}
+
+
+unsigned StatusTable::allocate(unsigned long hostId, ServerData::Status status) {
+    unsigned slot;
+
+    if (!freeSlots.isEmpty()) {
+        slot = freeSlots.takeLast();
+    } else if (numberUsed < capacity) {
+        slot = numberUsed;
+        ++numberUsed;
+        header->numberSlots.store(numberUsed, std::memory_order_release);
+    } else {
+        slot = noSlot;
+
+        if (header != nullptr) {
+            ++numberRefused;
+        }
+    }
+
+    if (slot != noSlot) {
+        StatusTableSlot& entry = tableSlots[slot];
+        entry.beginWrite();
+        entry.status.store(static_cast<std::uint32_t>(status), std::memory_order_relaxed);
+        entry.hostId.store(hostId, std::memory_order_relaxed);
+        entry.lastRtt.store(statusTableNoRtt, std::memory_order_relaxed);
+        entry.lastSeen.store(0, std::memory_order_relaxed);
+        entry.endWrite();
+    }
+
+    return slot;
+}
+
+
+void StatusTable::release(unsigned slot) {
+    if (slot < numberUsed) {
+        StatusTableSlot& entry = tableSlots[slot];
+        entry.beginWrite();
+        entry.hostId.store(0, std::memory_order_relaxed);
+        entry.endWrite();
+
+        freeSlots.append(slot);
+    }
+}
+
+
+void StatusTable::beginUpdate() {
+    if (header != nullptr) {
+        updateTime = static_cast<std::uint64_t>(QDateTime::currentMSecsSinceEpoch());
+        header->updatedAt.store(updateTime, std::memory_order_relaxed);
+    }
+}
+
+
+void StatusTable::publish(unsigned slot, ServerData::Status status, double latency) {
+    if (slot < numberUsed) {
+        StatusTableSlot& entry = tableSlots[slot];
+        entry.beginWrite();
+        entry.status.store(static_cast<std::uint32_t>(status), std::memory_order_relaxed);
+        if (latency >= 0) {
+            double microseconds = latency * 1000.0 + 0.5;
+            entry.lastRtt.store(
+                microseconds < statusTableNoRtt ? static_cast<std::uint32_t>(microseconds) : statusTableNoRtt - 1,
+                std::memory_order_relaxed
+            );
+            entry.lastSeen.store(updateTime, std::memory_order_relaxed);
+        }
+        entry.endWrite();
+    }
+}
+
+
+void StatusTable::setError(const char* operation) {
+    lastError = QString("%1: %2").arg(QString::fromLatin1(operation)).arg(QString::fromLocal8Bit(std::strerror(errno)));
+}
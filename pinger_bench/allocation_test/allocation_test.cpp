@@ -0,0 +1,237 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file contains a check that a ping engine does not allocate once it reaches a steady state.  The C library
+* allocator is wrapped so that every allocation made by any thread is counted.  The engine runs in its own thread and
+* its results are polled and released from the main thread, as the pinger does, so that sends, receives, expiries,
+* timer driven ticks and result hand-over are all measured.  The engine probes a fixed set of loopback addresses,
+* which answer, and TEST-NET-1 addresses, which do not.  The check exits with a non-zero status if anything allocates
+* while measuring.
+***********************************************************************************************************************/
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <QThread>
+#include <QMetaObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <iostream>
+#include <cstddef>
+
+#include "host_address.h"
+#include "ping_engine.h"
+
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t numberElements, std::size_t elementSize);
+    void* __libc_realloc(void* pointer, std::size_t size);
+}
+
+/**
+ * Flag indicating that allocations are being counted.
+ */
+static std::atomic<bool> counting(false);
+
+/**
+ * The number of allocations made while counting.
+ */
+static std::atomic<unsigned long> numberAllocations(0);
+
+extern "C" void* malloc(std::size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        numberAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return __libc_malloc(size);
+}
+
+
+extern "C" void* calloc(std::size_t numberElements, std::size_t elementSize) {
+    if (counting.load(std::memory_order_relaxed)) {
+        numberAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return __libc_calloc(numberElements, elementSize);
+}
+
+
+extern "C" void* realloc(void* pointer, std::size_t size) {
+    if (counting.load(std::memory_order_relaxed)) {
+        numberAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return __libc_realloc(pointer, size);
+}
+
+/**
+ * The number of hosts answering on the loopback interface.
+ */
+static constexpr unsigned numberAnsweringHosts = 1000;
+
+/**
+ * The number of hosts in TEST-NET-1 that never answer.
+ */
+static constexpr unsigned numberSilentHosts = 200;
+
+/**
+ * The probe interval, in milliseconds.
+ */
+static constexpr unsigned long probeInterval = 499;
+
+/**
+ * The probe timeout, in milliseconds.
+ */
+static constexpr unsigned long probeTimeout = 197;
+
+/**
+ * The interval used to poll the engine for results, in milliseconds.
+ */
+static constexpr int resultPollInterval = 11;
+
+/**
+ * The time allowed for the result buffers and host tables to reach their working size, in milliseconds.
+ */
+static constexpr int warmUpTime = 5003;
+
+/**
+ * The time over which allocations are counted, in milliseconds.
+ */
+static constexpr int measureTime = 10007;
+
+int main(int argumentCount, char* argumentValues[]) {
+    int exitStatus = 0;
+
+    QCoreApplication application(argumentCount, argumentValues);
+
+    QThread*    engineThread = new QThread;
+    PingEngine* engine       = new PingEngine;
+
+    if (!engine->isOpen()) {
+        std::cout << "SKIPPED: no ICMP sockets (" << engine->errorString().toLocal8Bit().data() << ")" << std::endl;
+    } else {
+        QVector<PingEngine::HostEntry> entries;
+        for (unsigned i=0 ; i<numberAnsweringHosts + numberSilentHosts ; ++i) {
+            PingEngine::HostEntry entry;
+            entry.hostId  = i + 1;
+            entry.context = i;
+
+            if (i < numberAnsweringHosts) {
+                entry.address = HostAddress::fromLiteral(QString("127.0.%1.%2").arg(i / 250).arg(i % 250 + 1));
+            } else {
+                entry.address = HostAddress::fromLiteral(QString("192.0.2.%1").arg(i % 250 + 1));
+            }
+
+            entries.append(entry);
+        }
+
+        engineThread->setObjectName("PingEngine0");
+        engine->moveToThread(engineThread);
+
+        QObject::connect(engineThread, &QThread::started, engine, &PingEngine::initialize);
+        engineThread->start();
+
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, entries]() {
+                engine->addHosts(PingEngine::Pool::ACTIVE, entries);
+                engine->schedulePool(PingEngine::Pool::ACTIVE, probeInterval, probeTimeout);
+            },
+            Qt::QueuedConnection
+        );
+
+        // The receiver reads the results in place and hands the buffer straight back, as the pinger does.
+        unsigned long numberResults = 0;
+        QTimer        resultTimer;
+        resultTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(
+            &resultTimer,
+            &QTimer::timeout,
+            [engine, &numberResults]() {
+                for (unsigned i=0 ; i<static_cast<unsigned>(PingEngine::Pool::NUMBER_POOLS) ; ++i) {
+                    PingEngine::Pool pool = static_cast<PingEngine::Pool>(i);
+                    unsigned         buffer;
+                    if (engine->pendingResults(pool, buffer)) {
+                        numberResults += static_cast<unsigned long>(engine->reportedResults(pool, buffer).size());
+                        engine->releaseResults(pool);
+                    }
+                }
+            }
+        );
+
+        // Starting a timer allocates so both phases are timed by timers started before counting begins.
+        QEventLoop    loop;
+        QTimer        warmUpTimer;
+        QTimer        measureTimer;
+        unsigned long probesBefore = 0;
+
+        warmUpTimer.setSingleShot(true);
+        QObject::connect(
+            &warmUpTimer,
+            &QTimer::timeout,
+            [engine, &numberResults, &probesBefore]() {
+                numberResults = 0;
+                probesBefore  = engine->numberProbesSent();
+                numberAllocations.store(0);
+                counting.store(true);
+            }
+        );
+
+        measureTimer.setSingleShot(true);
+        measureTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(
+            &measureTimer,
+            &QTimer::timeout,
+            [&loop]() {
+                counting.store(false);
+                loop.quit();
+            }
+        );
+
+        resultTimer.start(resultPollInterval);
+        warmUpTimer.start(warmUpTime);
+        measureTimer.start(warmUpTime + measureTime);
+        loop.exec();
+
+        resultTimer.stop();
+
+        std::cout << "results=" << numberResults
+                  << " probes_sent=" << (engine->numberProbesSent() - probesBefore)
+                  << " allocations=" << numberAllocations.load()
+                  << std::endl;
+
+        if (numberResults == 0) {
+            std::cout << "FAILED: no results were reported" << std::endl;
+            exitStatus = 1;
+        } else if (numberAllocations.load() > 0) {
+            std::cout << "FAILED: the steady state probe cycle allocated" << std::endl;
+            exitStatus = 1;
+        } else {
+            std::cout << "PASSED" << std::endl;
+        }
+    }
+
+    engineThread->quit();
+    engineThread->wait();
+
+    delete engineThread;
+    delete engine;
+
+    return exitStatus;
+}
@@ -0,0 +1,380 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file contains a client that measures how quickly a running pinger answers commands on its local socket.  The
+* client first registers a set of hosts, half on the loopback interface and half in the documentation address ranges,
+* which never answer, so that the pinger always has probes in flight.  It then either repeatedly removes a host that
+* does not exist and times the round trip to the "ERROR NO SERVER" reply, or pipelines blocks of additions and
+* removals and reports the number of commands handled per second.  Only commands understood by every version of the
+* pinger are used so that the same client can measure an older build.
+***********************************************************************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+#include <algorithm>
+#include <iostream>
+
+/**
+ * The time to wait for a reply, in milliseconds.
+ */
+static constexpr int replyTimeout = 5003;
+
+/**
+ * The time allowed for the pinger to start probing the registered hosts, in milliseconds.  This is longer than the
+ * four second timeout used by older builds so that at least one full ping cycle is in flight when sampling starts.
+ */
+static constexpr unsigned long settleTime = 5003;
+
+/**
+ * The time between latency samples, in milliseconds.
+ */
+static constexpr unsigned long sampleInterval = 97;
+
+/**
+ * The number of hosts added and then removed in each throughput round.
+ */
+static constexpr unsigned commandsPerRound = 499;
+
+/**
+ * Method that sends a block of commands to the pinger.
+ *
+ * \param[in] socket   The socket connected to the pinger.
+ *
+ * \param[in] commands The commands to send, each terminated by a newline.
+ *
+ * \return Returns true on success.  Returns false if the commands could not be written.
+ */
+static bool sendCommands(QLocalSocket& socket, const QByteArray& commands) {
+    bool success = (socket.write(commands) == commands.size());
+
+    while (success && socket.bytesToWrite() > 0) {
+        success = socket.waitForBytesWritten(replyTimeout);
+    }
+
+    return success;
+}
+
+
+/**
+ * Method that reads the next reply from the pinger.  Outage and recovery notices, which the pinger sends on its own,
+ * are skipped.
+ *
+ * \param[in]  socket The socket connected to the pinger.
+ *
+ * \param[out] reply  The reply, without the trailing newline.
+ *
+ * \return Returns true on success.  Returns false if no reply arrived in time.
+ */
+static bool readReply(QLocalSocket& socket, QByteArray& reply) {
+    bool success = true;
+    bool found   = false;
+
+    do {
+        if (socket.canReadLine()) {
+            reply = socket.readLine().trimmed();
+            found = (
+                   !reply.startsWith("NOPING")
+                && !reply.startsWith("RECOVERED")
+                && !reply.startsWith("EVENT")
+            );
+        } else {
+            success = socket.waitForReadyRead(replyTimeout);
+        }
+    } while (success && !found);
+
+    return success;
+}
+
+
+/**
+ * Method that builds the address for a registered host.  Even hosts are placed on the loopback interface, odd hosts
+ * are spread across the three documentation ranges.
+ *
+ * \param[in] index The zero based index of the host.
+ *
+ * \return Returns the address, as text.
+ */
+static QString hostAddress(unsigned index) {
+    QString result;
+
+    unsigned slot = index / 2;
+    if (index % 2 == 0) {
+        result = QString("127.%1.%2.%3").arg(slot / 62500).arg((slot / 250) % 250).arg(slot % 250 + 1);
+    } else {
+        static const char* const networks[] = { "192.0.2", "198.51.100", "203.0.113" };
+        result = QString("%1.%2").arg(networks[slot % 3]).arg((slot / 3) % 254 + 1);
+    }
+
+    return result;
+}
+
+
+/**
+ * Method that returns a percentile from a sorted list of samples.
+ *
+ * \param[in] samples    The sorted samples.
+ *
+ * \param[in] percentile The percentile, between 0 and 1.
+ *
+ * \return Returns the requested percentile.
+ */
+static double percentile(const QVector<double>& samples, double percentile) {
+    unsigned index = static_cast<unsigned>(percentile * (samples.size() - 1) + 0.5);
+    return samples.at(static_cast<int>(index));
+}
+
+
+/**
+ * Method that times single command round trips.
+ *
+ * \param[in] socket      The socket connected to the pinger.
+ *
+ * \param[in] unusedId    A host ID that is not registered.
+ *
+ * \param[in] duration    The time to measure for, in seconds.
+ *
+ * \param[in] numberHosts The number of hosts registered with the pinger.
+ *
+ * \return Returns true on success.  Returns false if the pinger stopped answering.
+ */
+static bool measureLatency(QLocalSocket& socket, unsigned long unusedId, unsigned long duration, unsigned numberHosts) {
+    bool            success = true;
+    QByteArray      reply;
+    QVector<double> samples;
+    QElapsedTimer   runTimer;
+    QElapsedTimer   sampleTimer;
+
+    runTimer.start();
+    while (success && static_cast<unsigned long>(runTimer.elapsed()) < 1000 * duration) {
+        sampleTimer.start();
+        success = sendCommands(socket, QString("R %1\n").arg(unusedId).toUtf8()) && readReply(socket, reply);
+
+        if (success) {
+            samples.append(sampleTimer.nsecsElapsed() / 1.0E6);
+            QThread::msleep(sampleInterval);
+        }
+    }
+
+    if (success && !samples.isEmpty()) {
+        double total = 0;
+        for (QVector<double>::const_iterator it=samples.constBegin(),end=samples.constEnd() ; it!=end ; ++it) {
+            total += *it;
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        std::cout << "hosts=" << numberHosts
+                  << " samples=" << samples.size()
+                  << " mean_msec=" << QString::number(total / samples.size(), 'f', 3).toLocal8Bit().data()
+                  << " p50_msec=" << QString::number(percentile(samples, 0.50), 'f', 3).toLocal8Bit().data()
+                  << " p99_msec=" << QString::number(percentile(samples, 0.99), 'f', 3).toLocal8Bit().data()
+                  << " max_msec=" << QString::number(samples.last(), 'f', 3).toLocal8Bit().data()
+                  << std::endl;
+    }
+
+    return success;
+}
+
+
+/**
+ * Method that measures command throughput.  Each round pipelines a block of additions, waits for their replies,
+ * then pipelines the matching removals followed by the removal of an unregistered host.  Successful removals are not
+ * acknowledged so the final reply marks the end of the round.
+ *
+ * \param[in] socket      The socket connected to the pinger.
+ *
+ * \param[in] firstId     The first of a range of host IDs that are not registered.
+ *
+ * \param[in] duration    The time to measure for, in seconds.
+ *
+ * \param[in] numberHosts The number of hosts registered with the pinger.
+ *
+ * \return Returns true on success.  Returns false if the pinger stopped answering.
+ */
+static bool measureThroughput(
+        QLocalSocket& socket,
+        unsigned long firstId,
+        unsigned long duration,
+        unsigned      numberHosts
+    ) {
+    bool       success = true;
+    QByteArray reply;
+    QByteArray additions;
+    QByteArray removals;
+
+    for (unsigned i=0 ; i<commandsPerRound ; ++i) {
+        additions += QString("A %1 %2\n").arg(firstId + i).arg(hostAddress(2 * i)).toUtf8();
+        removals  += QString("R %1\n").arg(firstId + i).toUtf8();
+    }
+
+    removals += QString("R %1\n").arg(firstId + commandsPerRound).toUtf8();
+
+    unsigned long numberRounds = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    while (success && static_cast<unsigned long>(timer.elapsed()) < 1000 * duration) {
+        success = sendCommands(socket, additions);
+        for (unsigned i=0 ; success && i<commandsPerRound ; ++i) {
+            success = readReply(socket, reply);
+        }
+
+        success = success && sendCommands(socket, removals) && readReply(socket, reply);
+        if (success) {
+            ++numberRounds;
+        }
+    }
+
+    if (success) {
+        unsigned long numberCommands = numberRounds * (2 * commandsPerRound + 1);
+        double        seconds        = timer.nsecsElapsed() / 1.0E9;
+
+        std::cout << "hosts=" << numberHosts
+                  << " rounds=" << numberRounds
+                  << " commands=" << numberCommands
+                  << " commands_per_sec=" << QString::number(numberCommands / seconds, 'f', 0).toLocal8Bit().data()
+                  << std::endl;
+    }
+
+    return success;
+}
+
+
+int main(int argumentCount, char* argumentValues[]) {
+    int exitStatus = 0;
+
+    QCoreApplication application(argumentCount, argumentValues);
+    QCoreApplication::setApplicationName("control_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Measures command latency or throughput against a running pinger while it has probes in flight."
+    );
+    parser.addHelpOption();
+
+    QCommandLineOption hostsOption(
+        QStringList() << "n" << "hosts",
+        QString("Number of hosts to register before measuring.  Half of them never answer."),
+        QString("count"),
+        QString("1000")
+    );
+
+    QCommandLineOption durationOption(
+        QStringList() << "d" << "duration",
+        QString("Time to measure for, in seconds."),
+        QString("seconds"),
+        QString("30")
+    );
+
+    QCommandLineOption firstIdOption(
+        QStringList() << "f" << "first-id",
+        QString("The first host ID to use.  IDs from this value onward must not already be registered."),
+        QString("id"),
+        QString("1000000001")
+    );
+
+    QCommandLineOption throughputOption(
+        QStringList() << "t" << "throughput",
+        QString("Measure pipelined commands per second rather than single command latency.")
+    );
+
+    parser.addOption(hostsOption);
+    parser.addOption(durationOption);
+    parser.addOption(firstIdOption);
+    parser.addOption(throughputOption);
+    parser.addPositionalArgument(QString("connection"), QString("The local socket the pinger listens on."));
+    parser.process(application);
+
+    QStringList positionalArguments = parser.positionalArguments();
+    if (positionalArguments.size() == 1) {
+        bool          hostsValid;
+        unsigned      numberHosts   = parser.value(hostsOption).toUInt(&hostsValid);
+        bool          durationValid;
+        unsigned long duration      = parser.value(durationOption).toULong(&durationValid);
+        bool          firstIdValid;
+        unsigned long firstId       = parser.value(firstIdOption).toULong(&firstIdValid);
+
+        if (!hostsValid || !durationValid || duration == 0 || !firstIdValid || firstId == 0) {
+            std::cerr << "*** Invalid option value." << std::endl;
+            exitStatus = 1;
+        } else {
+            QLocalSocket socket;
+            socket.connectToServer(positionalArguments.at(0));
+            if (!socket.waitForConnected(replyTimeout)) {
+                std::cerr << "*** Could not connect: " << socket.errorString().toLocal8Bit().data() << std::endl;
+                exitStatus = 1;
+            } else {
+                QByteArray    reply;
+                unsigned long unusedId    = firstId + numberHosts;
+                unsigned      numberAdded = 0;
+
+                QByteArray commands;
+                for (unsigned i=0 ; i<numberHosts ; ++i) {
+                    commands += QString("A %1 %2\n").arg(firstId + i).arg(hostAddress(i)).toUtf8();
+                }
+
+                bool success = sendCommands(socket, commands);
+                for (unsigned i=0 ; success && i<numberHosts ; ++i) {
+                    success = readReply(socket, reply);
+                    if (success && reply == QByteArray("OK")) {
+                        ++numberAdded;
+                    }
+                }
+
+                if (success) {
+                    QThread::msleep(settleTime);
+                }
+
+                if (success) {
+                    if (parser.isSet(throughputOption)) {
+                        success = measureThroughput(socket, unusedId, duration, numberAdded);
+                    } else {
+                        success = measureLatency(socket, unusedId, duration, numberAdded);
+                    }
+                }
+
+                // Successful removals are not acknowledged so the hosts can be dropped in a single write.
+                commands.clear();
+                for (unsigned i=0 ; i<numberHosts ; ++i) {
+                    commands += QString("R %1\n").arg(firstId + i).toUtf8();
+                }
+
+                commands += "Q\n";
+                sendCommands(socket, commands);
+                socket.disconnectFromServer();
+
+                if (!success) {
+                    std::cerr << "*** No reply from the pinger." << std::endl;
+                    exitStatus = 1;
+                }
+            }
+        }
+    } else {
+        std::cerr << "*** Invalid command line.  Include the pinger's local socket as parameter." << std::endl;
+        exitStatus = 1;
+    }
+
+    return exitStatus;
+}
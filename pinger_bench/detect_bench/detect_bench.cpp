@@ -0,0 +1,454 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file contains a measurement of how quickly the pinger reports outages and how often it reports outages that
+* did not happen.  A pinger runs in process and a client connected to its local socket streams the sequenced events.
+* Hosts on the loopback interface are registered and, once they are active, half of them are moved to an address in
+* TEST-NET-1, which never answers, for about a minute while the other half are moved there for about two seconds.
+* The first group measures the time to detect an outage and the number of outages missed.  Any failure reported for
+* the second group, or for a host that was never interrupted, is a false alarm.  The run is repeated for each
+* requested number of confirmation probes.
+***********************************************************************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QMetaObject>
+#include <QLocalSocket>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+
+#include <algorithm>
+#include <iostream>
+
+#include "host_address.h"
+#include "ping_engine.h"
+#include "pinger.h"
+
+/**
+ * The time allowed for new hosts to be tested and become active, in milliseconds.  This covers the untested probe
+ * interval plus the probe timeout.
+ */
+static constexpr int settleTime = 35023;
+
+/**
+ * The length of a simulated outage, in milliseconds.
+ */
+static constexpr int outageTime = 60013;
+
+/**
+ * The length of a simulated blip, in milliseconds.
+ */
+static constexpr int blipTime = 2003;
+
+/**
+ * The time allowed for interrupted hosts to recover before the next round, in milliseconds.  This covers two probes
+ * of the flagged pool.
+ */
+static constexpr int recoveryTime = 30011;
+
+/**
+ * The time to wait for the client to connect, in milliseconds.
+ */
+static constexpr int connectTimeout = 5003;
+
+/**
+ * Class that tracks simulated outages and matches them against the failures the pinger reports.
+ */
+class OutageTracker {
+    public:
+        OutageTracker();
+
+        /**
+         * Method you can use to record the start of an outage for a set of hosts.
+         *
+         * \param[in] hostIds     The hosts placed in outage.
+         *
+         * \param[in] currentTime The current time, in milliseconds.
+         */
+        void startOutage(const QList<unsigned long>& hostIds, qint64 currentTime);
+
+        /**
+         * Method you can use to record the end of an outage.  Hosts that were not reported are counted as missed.
+         *
+         * \param[in] hostIds The hosts whose outage ended.
+         */
+        void endOutage(const QList<unsigned long>& hostIds);
+
+        /**
+         * Method you can use to record a failure reported by the pinger.
+         *
+         * \param[in] hostId      The host reported as failed.
+         *
+         * \param[in] currentTime The current time, in milliseconds.
+         */
+        void reportFailure(unsigned long hostId, qint64 currentTime);
+
+        /**
+         * Method you can use to obtain the number of outages simulated.
+         *
+         * \return Returns the number of outages.
+         */
+        unsigned long numberOutages() const;
+
+        /**
+         * Method you can use to obtain the number of outages that were never reported.
+         *
+         * \return Returns the number of missed outages.
+         */
+        unsigned long numberMissed() const;
+
+        /**
+         * Method you can use to obtain the number of failures reported for hosts that were not in outage.
+         *
+         * \return Returns the number of false alarms.
+         */
+        unsigned long numberFalseAlarms() const;
+
+        /**
+         * Method you can use to obtain the times taken to detect each reported outage.
+         *
+         * \return Returns the detection times, in milliseconds.
+         */
+        const QVector<qint64>& detectionTimes() const;
+
+    private:
+        /**
+         * The start time of each current outage, keyed by host ID.
+         */
+        QHash<unsigned long, qint64> outageStarts;
+
+        /**
+         * The hosts whose current outage has been reported.
+         */
+        QSet<unsigned long> detected;
+
+        /**
+         * The time taken to detect each reported outage, in milliseconds.
+         */
+        QVector<qint64> currentDetectionTimes;
+
+        /**
+         * The number of outages simulated.
+         */
+        unsigned long currentNumberOutages;
+
+        /**
+         * The number of outages never reported.
+         */
+        unsigned long currentNumberMissed;
+
+        /**
+         * The number of false alarms.
+         */
+        unsigned long currentNumberFalseAlarms;
+};
+
+OutageTracker::OutageTracker() {
+    currentNumberOutages     = 0;
+    currentNumberMissed      = 0;
+    currentNumberFalseAlarms = 0;
+}
+
+
+void OutageTracker::startOutage(const QList<unsigned long>& hostIds, qint64 currentTime) {
+    for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        outageStarts.insert(*it, currentTime);
+        ++currentNumberOutages;
+    }
+}
+
+
+void OutageTracker::endOutage(const QList<unsigned long>& hostIds) {
+    for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        if (!detected.remove(*it)) {
+            ++currentNumberMissed;
+        }
+
+        outageStarts.remove(*it);
+    }
+}
+
+
+void OutageTracker::reportFailure(unsigned long hostId, qint64 currentTime) {
+    QHash<unsigned long, qint64>::const_iterator it = outageStarts.constFind(hostId);
+    if (it == outageStarts.constEnd()) {
+        ++currentNumberFalseAlarms;
+    } else if (!detected.contains(hostId)) {
+        detected.insert(hostId);
+        currentDetectionTimes.append(currentTime - it.value());
+    }
+}
+
+
+unsigned long OutageTracker::numberOutages() const {
+    return currentNumberOutages;
+}
+
+
+unsigned long OutageTracker::numberMissed() const {
+    return currentNumberMissed;
+}
+
+
+unsigned long OutageTracker::numberFalseAlarms() const {
+    return currentNumberFalseAlarms;
+}
+
+
+const QVector<qint64>& OutageTracker::detectionTimes() const {
+    return currentDetectionTimes;
+}
+
+
+/**
+ * Method that runs the event loop for a fixed time.
+ *
+ * \param[in] time The time to run for, in milliseconds.
+ */
+static void runEventLoop(int time) {
+    QEventLoop loop;
+    QTimer::singleShot(time, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+
+/**
+ * Method that changes the address the pinger's engines probe for a set of hosts, as a changed DNS answer would.
+ *
+ * \param[in] pinger  The pinger under test.
+ *
+ * \param[in] hostIds The hosts to update.
+ *
+ * \param[in] address The new address.
+ */
+static void changeAddress(Pinger& pinger, const QList<unsigned long>& hostIds, const HostAddress& address) {
+    QMetaObject::invokeMethod(
+        &pinger,
+        "addressChanged",
+        Qt::DirectConnection,
+        Q_ARG(QList<unsigned long>, hostIds),
+        Q_ARG(HostAddress, address)
+    );
+}
+
+
+/**
+ * Method that restores the loopback address of a set of hosts.
+ *
+ * \param[in] pinger  The pinger under test.
+ *
+ * \param[in] hostIds The hosts to restore.
+ */
+static void restoreAddresses(Pinger& pinger, const QList<unsigned long>& hostIds) {
+    for (QList<unsigned long>::const_iterator it=hostIds.constBegin(),end=hostIds.constEnd() ; it!=end ; ++it) {
+        QList<unsigned long> hostId;
+        hostId.append(*it);
+
+        changeAddress(pinger, hostId, HostAddress::fromLiteral(QString("127.0.1.%1").arg(*it)));
+    }
+}
+
+
+/**
+ * Method that measures outage detection for one confirmation setting.
+ *
+ * \param[in] confirmProbes The number of confirmation probes sent after a missed probe.
+ *
+ * \param[in] numberHosts   The number of hosts.  Half see outages and half see blips.
+ *
+ * \param[in] numberRounds  The number of outages simulated per host.
+ *
+ * \return Returns true on success.  Returns false if the pinger could not start.
+ */
+static bool measureDetection(unsigned confirmProbes, unsigned numberHosts, unsigned numberRounds) {
+    bool    success        = true;
+    QString connectionName = QString("detect_bench_%1_%2").arg(QCoreApplication::applicationPid()).arg(confirmProbes);
+    Pinger  pinger;
+
+    pinger.setConfirmation(confirmProbes, PingEngine::defaultConfirmSpacing);
+    if (!pinger.start(connectionName)) {
+        std::cout << "SKIPPED: the pinger could not start" << std::endl;
+        success = false;
+    } else {
+        QLocalSocket socket;
+        socket.connectToServer(connectionName);
+        if (!socket.waitForConnected(connectTimeout)) {
+            std::cerr << "*** Could not connect: " << socket.errorString().toLocal8Bit().data() << std::endl;
+            success = false;
+        } else {
+            OutageTracker tracker;
+            QElapsedTimer clock;
+            clock.start();
+
+            QObject::connect(
+                &socket,
+                &QLocalSocket::readyRead,
+                [&socket, &tracker, &clock]() {
+                    while (socket.canReadLine()) {
+                        QList<QByteArray> fields = socket.readLine().trimmed().split(' ');
+                        if (   fields.size() >= 4
+                            && fields.at(0) == QByteArray("EVENT")
+                            && fields.at(2) == QByteArray("NOPING")
+                           ) {
+                            tracker.reportFailure(fields.at(3).toULong(), clock.elapsed());
+                        }
+                    }
+                }
+            );
+
+            QByteArray commands("RESUME 0\n");
+
+            QList<unsigned long> outageHosts;
+            QList<unsigned long> blipHosts;
+            for (unsigned long hostId=1 ; hostId<=numberHosts ; ++hostId) {
+                commands += QString("A %1 127.0.1.%1\n").arg(hostId).toUtf8();
+                if (hostId % 2 == 0) {
+                    outageHosts.append(hostId);
+                } else {
+                    blipHosts.append(hostId);
+                }
+            }
+
+            socket.write(commands);
+            runEventLoop(settleTime);
+
+            HostAddress silentAddress = HostAddress::fromLiteral(QString("192.0.2.1"));
+            for (unsigned round=0 ; round<numberRounds ; ++round) {
+                tracker.startOutage(outageHosts, clock.elapsed());
+                changeAddress(pinger, outageHosts, silentAddress);
+                changeAddress(pinger, blipHosts, silentAddress);
+
+                runEventLoop(blipTime);
+                restoreAddresses(pinger, blipHosts);
+
+                runEventLoop(outageTime - blipTime);
+                restoreAddresses(pinger, outageHosts);
+                tracker.endOutage(outageHosts);
+
+                runEventLoop(recoveryTime);
+            }
+
+            socket.write("Q\n");
+            socket.waitForBytesWritten(connectTimeout);
+            socket.disconnectFromServer();
+
+            QVector<qint64> times = tracker.detectionTimes();
+            std::sort(times.begin(), times.end());
+
+            double mean = 0;
+            for (QVector<qint64>::const_iterator it=times.constBegin(),end=times.constEnd() ; it!=end ; ++it) {
+                mean += *it;
+            }
+
+            if (!times.isEmpty()) {
+                mean /= times.size();
+            }
+
+            std::cout << "confirm_probes=" << confirmProbes
+                      << " outages=" << tracker.numberOutages()
+                      << " detected=" << times.size()
+                      << " missed=" << tracker.numberMissed()
+                      << " mttd_msec=" << QString::number(mean, 'f', 0).toLocal8Bit().data()
+                      << " worst_msec=" << (times.isEmpty() ? 0 : times.last())
+                      << " blips=" << numberRounds * blipHosts.size()
+                      << " false_alarms=" << tracker.numberFalseAlarms()
+                      << std::endl;
+        }
+    }
+
+    return success;
+}
+
+
+int main(int argumentCount, char* argumentValues[]) {
+    int exitStatus = 0;
+
+    QCoreApplication application(argumentCount, argumentValues);
+    QCoreApplication::setApplicationName("detect_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures outage detection time and false alarms for confirmation settings.");
+    parser.addHelpOption();
+
+    QCommandLineOption hostsOption(
+        QStringList() << "n" << "hosts",
+        QString("Number of loopback hosts.  Half see outages and half see blips."),
+        QString("count"),
+        QString("20")
+    );
+
+    QCommandLineOption roundsOption(
+        QStringList() << "r" << "rounds",
+        QString("Number of outages and blips simulated per host."),
+        QString("count"),
+        QString("3")
+    );
+
+    QCommandLineOption confirmProbesOption(
+        QStringList() << "c" << "confirm-probes",
+        QString("Comma separated list of confirmation probe counts to measure."),
+        QString("counts"),
+        QString("0,3")
+    );
+
+    parser.addOption(hostsOption);
+    parser.addOption(roundsOption);
+    parser.addOption(confirmProbesOption);
+    parser.process(application);
+
+    bool              hostsValid;
+    unsigned          numberHosts  = parser.value(hostsOption).toUInt(&hostsValid);
+    bool              roundsValid;
+    unsigned          numberRounds = parser.value(roundsOption).toUInt(&roundsValid);
+    QStringList       entries      = parser.value(confirmProbesOption).split(QChar(','));
+    bool              confirmValid = true;
+    QVector<unsigned> confirmProbes;
+
+    for (QStringList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        bool     valid;
+        unsigned count = it->toUInt(&valid);
+        if (valid) {
+            confirmProbes.append(count);
+        } else {
+            confirmValid = false;
+        }
+    }
+
+    if (!hostsValid || numberHosts < 2 || numberHosts > 254 || !roundsValid || numberRounds == 0 || !confirmValid) {
+        std::cerr << "*** Invalid option value." << std::endl;
+        exitStatus = 1;
+    } else {
+        bool success = true;
+        for (QVector<unsigned>::const_iterator it=confirmProbes.constBegin(),end=confirmProbes.constEnd()
+             ; success && it!=end
+             ; ++it
+            ) {
+            success = measureDetection(*it, numberHosts, numberRounds);
+        }
+    }
+
+    return exitStatus;
+}
@@ -0,0 +1,78 @@
+##-*-makefile-*-########################################################################################################
+# Copyright 2021 - 2023 Inesonic, LLC
+#
+# GNU Public License, Version 3:
+#   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+#   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+#   version.
+#   
+#   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+#   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+#   details.
+#   
+#   You should have received a copy of the GNU General Public License along with this program.  If not, see
+#   <https://www.gnu.org/licenses/>.
+########################################################################################################################
+
+########################################################################################################################
+# Basic build characteristics
+#
+
+TEMPLATE = app
+QT += core network
+CONFIG += console
+CONFIG += c++14
+
+unix:!macx:LIBS += -lrt
+
+########################################################################################################################
+# Headers
+#
+
+INCLUDEPATH += ../../pinger/include
+HEADERS = ../../pinger/include/pinger.h \
+          ../../pinger/include/connection.h \
+          ../../pinger/include/server_data.h \
+          ../../pinger/include/host_address.h \
+          ../../pinger/include/resolver_cache.h \
+          ../../pinger/include/ping_engine.h \
+          ../../pinger/include/latency_histogram.h \
+          ../../pinger/include/event_log.h \
+          ../../pinger/include/status_table_layout.h \
+          ../../pinger/include/status_table.h \
+          ../../pinger/include/host_table.h \
+
+########################################################################################################################
+# Source files
+#
+
+SOURCES = detect_bench.cpp \
+          ../../pinger/source/pinger.cpp \
+          ../../pinger/source/connection.cpp \
+          ../../pinger/source/server_data.cpp \
+          ../../pinger/source/host_address.cpp \
+          ../../pinger/source/resolver_cache.cpp \
+          ../../pinger/source/ping_engine.cpp \
+          ../../pinger/source/latency_histogram.cpp \
+          ../../pinger/source/event_log.cpp \
+          ../../pinger/source/status_table.cpp \
+          ../../pinger/source/host_table.cpp \
+
+########################################################################################################################
+# Locate build intermediate and output products
+#
+
+TARGET = detect_bench
+
+CONFIG(debug, debug|release) {
+    unix:DESTDIR = build/debug
+    win32:DESTDIR = build/Debug
+} else {
+    unix:DESTDIR = build/release
+    win32:DESTDIR = build/Release
+}
+
+OBJECTS_DIR = $${DESTDIR}/objects
+MOC_DIR = $${DESTDIR}/moc
+RCC_DIR = $${DESTDIR}/rcc
+UI_DIR = $${DESTDIR}/ui
@@ -0,0 +1,399 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file contains a measurement of ping engine capacity as the number of shards grows.  For each shard count the
+* hosts are spread across that many engines, each running in its own thread exactly as the pinger runs them, and the
+* engines probe loopback addresses, which answer.  After a warm-up period the probes sent and replies received per
+* second are compared against the rate the schedule asks for, together with the worst send lag and the number of
+* ticks that fell behind.  Each shard count is measured at every requested batch size so that the per-packet path
+* can be compared against sendmmsg and recvmmsg in system calls per probe and CPU time per 10000 probes.
+***********************************************************************************************************************/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QThread>
+#include <QMetaObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <iostream>
+
+#include "host_address.h"
+#include "ping_engine.h"
+
+/**
+ * The probe interval, in milliseconds.
+ */
+static constexpr unsigned long probeInterval = 997;
+
+/**
+ * The probe timeout, in milliseconds.
+ */
+static constexpr unsigned long probeTimeout = 499;
+
+/**
+ * The interval used to poll the engines for results, in milliseconds.
+ */
+static constexpr int resultPollInterval = 11;
+
+/**
+ * The time allowed for the engines to spread their schedules and settle, in milliseconds.
+ */
+static constexpr int warmUpTime = 5003;
+
+/**
+ * Trivial class used to hold the counters summed across a set of engines.
+ */
+class Counters {
+    public:
+        /**
+         * The number of echo requests sent.
+         */
+        unsigned long probesSent;
+
+        /**
+         * The number of echo replies received.
+         */
+        unsigned long repliesReceived;
+
+        /**
+         * The number of ticks that found probes already overdue.
+         */
+        unsigned long scheduleOverruns;
+
+        /**
+         * The number of ticks that deferred probes because the burst budget was spent.
+         */
+        unsigned long budgetExhausted;
+
+        /**
+         * The largest send lag seen by any engine, in microseconds.
+         */
+        unsigned long worstSendLag;
+
+        /**
+         * The CPU time consumed by the engine threads, in milliseconds.
+         */
+        unsigned long cpuTime;
+
+        /**
+         * The number of socket system calls issued to send and receive packets.
+         */
+        unsigned long systemCalls;
+};
+
+/**
+ * Method that sums the counters of a set of engines.
+ *
+ * \param[in] engines The engines to sample.
+ *
+ * \return Returns the summed counters.
+ */
+static Counters sampleCounters(const QVector<PingEngine*>& engines) {
+    Counters result = { 0, 0, 0, 0, 0, 0, 0 };
+
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        const PingEngine* engine = *it;
+
+        result.probesSent       += engine->numberProbesSent();
+        result.repliesReceived  += engine->numberRepliesReceived();
+        result.scheduleOverruns += engine->numberScheduleOverruns();
+        result.budgetExhausted  += engine->numberBudgetExhausted();
+        result.cpuTime          += engine->cpuTime();
+        result.systemCalls      += engine->numberSystemCalls();
+
+        if (engine->worstSendLag() > result.worstSendLag) {
+            result.worstSendLag = engine->worstSendLag();
+        }
+    }
+
+    return result;
+}
+
+
+/**
+ * Method that runs the event loop for a fixed time.
+ *
+ * \param[in] time The time to run for, in milliseconds.
+ */
+static void runEventLoop(int time) {
+    QEventLoop loop;
+    QTimer::singleShot(time, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+
+/**
+ * Method that measures a set of engines.
+ *
+ * \param[in] numberShards The number of engines to run.
+ *
+ * \param[in] numberHosts  The total number of hosts, spread evenly across the engines.
+ *
+ * \param[in] batchSize    The number of packets each engine sends or receives per system call.
+ *
+ * \param[in] measureTime  The time to measure for, in milliseconds.
+ *
+ * \return Returns true on success.  Returns false if the engines could not open their sockets.
+ */
+static bool measureShards(unsigned numberShards, unsigned numberHosts, unsigned batchSize, int measureTime) {
+    bool                 success = true;
+    QVector<QThread*>    engineThreads;
+    QVector<PingEngine*> engines;
+    unsigned long        numberResults = 0;
+
+    for (unsigned shardIndex=0 ; shardIndex<numberShards ; ++shardIndex) {
+        QThread* engineThread = new QThread;
+        engineThread->setObjectName(QString("PingEngine%1").arg(shardIndex));
+
+        PingEngine* engine = new PingEngine(shardIndex);
+        if (success && !engine->isOpen()) {
+            std::cout << "SKIPPED: no ICMP sockets (" << engine->errorString().toLocal8Bit().data() << ")"
+                      << std::endl;
+            success = false;
+        }
+
+        engine->moveToThread(engineThread);
+
+        QObject::connect(engineThread, &QThread::started, engine, &PingEngine::initialize);
+
+        QVector<PingEngine::HostEntry> entries;
+        for (unsigned i=shardIndex ; i<numberHosts ; i+=numberShards) {
+            PingEngine::HostEntry entry;
+            entry.hostId  = i + 1;
+            entry.context = i;
+            entry.address = HostAddress::fromLiteral(
+                QString("127.%1.%2.%3").arg(i / 62500).arg((i / 250) % 250).arg(i % 250 + 1)
+            );
+
+            entries.append(entry);
+        }
+
+        engineThread->start();
+
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, entries, batchSize]() {
+                engine->setBatchSize(batchSize);
+                engine->addHosts(PingEngine::Pool::ACTIVE, entries);
+                engine->schedulePool(PingEngine::Pool::ACTIVE, probeInterval, probeTimeout);
+            },
+            Qt::QueuedConnection
+        );
+
+        engineThreads.append(engineThread);
+        engines.append(engine);
+    }
+
+    // Results are polled and handed straight back, as the pinger does.
+    QTimer resultTimer;
+    resultTimer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(
+        &resultTimer,
+        &QTimer::timeout,
+        [&engines, &numberResults]() {
+            for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+                PingEngine* engine = *it;
+                for (unsigned i=0 ; i<static_cast<unsigned>(PingEngine::Pool::NUMBER_POOLS) ; ++i) {
+                    PingEngine::Pool pool = static_cast<PingEngine::Pool>(i);
+                    unsigned         buffer;
+                    if (engine->pendingResults(pool, buffer)) {
+                        numberResults += static_cast<unsigned long>(engine->reportedResults(pool, buffer).size());
+                        engine->releaseResults(pool);
+                    }
+                }
+            }
+        }
+    );
+
+    resultTimer.start(resultPollInterval);
+
+    if (success) {
+        runEventLoop(warmUpTime);
+
+        Counters      before = sampleCounters(engines);
+        QElapsedTimer timer;
+
+        timer.start();
+        runEventLoop(measureTime);
+
+        Counters after   = sampleCounters(engines);
+        double   seconds = timer.nsecsElapsed() / 1.0E9;
+
+        double probesPerSecond  = (after.probesSent - before.probesSent) / seconds;
+        double repliesPerSecond = (after.repliesReceived - before.repliesReceived) / seconds;
+        double targetPerSecond  = numberHosts * 1000.0 / probeInterval;
+
+        unsigned long numberProbes    = after.probesSent - before.probesSent;
+        double        callsPerProbe   = 0;
+        double        cpuPer10kProbes = 0;
+        if (numberProbes > 0) {
+            callsPerProbe   = static_cast<double>(after.systemCalls - before.systemCalls) / numberProbes;
+            cpuPer10kProbes = 10000.0 * (after.cpuTime - before.cpuTime) / numberProbes;
+        }
+
+        std::cout << "shards=" << numberShards
+                  << " hosts=" << numberHosts
+                  << " batch_size=" << batchSize
+                  << " target_probes_per_sec=" << QString::number(targetPerSecond, 'f', 0).toLocal8Bit().data()
+                  << " probes_per_sec=" << QString::number(probesPerSecond, 'f', 0).toLocal8Bit().data()
+                  << " replies_per_sec=" << QString::number(repliesPerSecond, 'f', 0).toLocal8Bit().data()
+                  << " worst_send_lag_usec=" << after.worstSendLag
+                  << " schedule_overruns=" << (after.scheduleOverruns - before.scheduleOverruns)
+                  << " budget_exhausted=" << (after.budgetExhausted - before.budgetExhausted)
+                  << " syscalls_per_probe=" << QString::number(callsPerProbe, 'f', 3).toLocal8Bit().data()
+                  << " cpu_msec_per_10k_probes=" << QString::number(cpuPer10kProbes, 'f', 1).toLocal8Bit().data()
+                  << " results=" << numberResults
+                  << std::endl;
+    }
+
+    for (QVector<QThread*>::const_iterator it=engineThreads.constBegin(),end=engineThreads.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        (*it)->quit();
+    }
+
+    for (QVector<QThread*>::const_iterator it=engineThreads.constBegin(),end=engineThreads.constEnd()
+         ; it!=end
+         ; ++it
+        ) {
+        (*it)->wait();
+        delete *it;
+    }
+
+    resultTimer.stop();
+
+    for (QVector<PingEngine*>::const_iterator it=engines.constBegin(),end=engines.constEnd() ; it!=end ; ++it) {
+        delete *it;
+    }
+
+    return success;
+}
+
+
+/**
+ * Method that parses a comma separated list of positive counts.
+ *
+ * \param[in]  text   The text to parse.
+ *
+ * \param[out] counts The parsed counts.
+ *
+ * \return Returns true on success.  Returns false if any entry is not a positive integer.
+ */
+static bool parseCounts(const QString& text, QVector<unsigned>& counts) {
+    bool        success = true;
+    QStringList entries = text.split(QChar(','));
+
+    for (QStringList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        bool     valid;
+        unsigned count = it->toUInt(&valid);
+        if (valid && count > 0) {
+            counts.append(count);
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+
+int main(int argumentCount, char* argumentValues[]) {
+    int exitStatus = 0;
+
+    QCoreApplication application(argumentCount, argumentValues);
+    QCoreApplication::setApplicationName("engine_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures ping engine capacity for a range of shard counts and batch sizes.");
+    parser.addHelpOption();
+
+    QCommandLineOption hostsOption(
+        QStringList() << "n" << "hosts",
+        QString("Number of loopback hosts to probe, spread across the shards."),
+        QString("count"),
+        QString("50000")
+    );
+
+    QCommandLineOption shardsOption(
+        QStringList() << "s" << "shards",
+        QString("Comma separated list of shard counts to measure."),
+        QString("counts"),
+        QString("1,2,4,8")
+    );
+
+    QCommandLineOption durationOption(
+        QStringList() << "d" << "duration",
+        QString("Time to measure each configuration for, in seconds."),
+        QString("seconds"),
+        QString("20")
+    );
+
+    QCommandLineOption batchSizesOption(
+        QStringList() << "b" << "batch-sizes",
+        QString("Comma separated list of batch sizes to measure.  A batch size of 1 selects the per-packet path."),
+        QString("counts"),
+        QString("1,%1").arg(PingEngine::defaultBatchSize)
+    );
+
+    parser.addOption(hostsOption);
+    parser.addOption(shardsOption);
+    parser.addOption(batchSizesOption);
+    parser.addOption(durationOption);
+    parser.process(application);
+
+    bool              hostsValid;
+    unsigned          numberHosts     = parser.value(hostsOption).toUInt(&hostsValid);
+    bool              durationValid;
+    unsigned          duration        = parser.value(durationOption).toUInt(&durationValid);
+    QVector<unsigned> numberShards;
+    bool              shardsValid     = parseCounts(parser.value(shardsOption), numberShards);
+    QVector<unsigned> batchSizes;
+    bool              batchSizesValid = parseCounts(parser.value(batchSizesOption), batchSizes);
+
+    if (   !hostsValid
+        || numberHosts == 0
+        || !durationValid
+        || duration == 0
+        || !shardsValid
+        || !batchSizesValid
+       ) {
+        std::cerr << "*** Invalid option value." << std::endl;
+        exitStatus = 1;
+    } else {
+        bool success = true;
+        for (QVector<unsigned>::const_iterator shardIt=numberShards.constBegin(),shardEnd=numberShards.constEnd()
+             ; success && shardIt!=shardEnd
+             ; ++shardIt
+            ) {
+            for (QVector<unsigned>::const_iterator batchIt=batchSizes.constBegin(),batchEnd=batchSizes.constEnd()
+                 ; success && batchIt!=batchEnd
+                 ; ++batchIt
+                ) {
+                success = measureShards(*shardIt, numberHosts, *batchIt, static_cast<int>(1000 * duration));
+            }
+        }
+    }
+
+    return exitStatus;
+}
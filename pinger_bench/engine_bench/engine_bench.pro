@@ -0,0 +1,61 @@
+##-*-makefile-*-########################################################################################################
+# Copyright 2021 - 2023 Inesonic, LLC
+#
+# GNU Public License, Version 3:
+#   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+#   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+#   version.
+#   
+#   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+#   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+#   details.
+#   
+#   You should have received a copy of the GNU General Public License along with this program.  If not, see
+#   <https://www.gnu.org/licenses/>.
+########################################################################################################################
+
+########################################################################################################################
+# Basic build characteristics
+#
+
+TEMPLATE = app
+QT += core network
+CONFIG += console
+CONFIG += c++14
+
+unix:!macx:LIBS += -lrt
+
+########################################################################################################################
+# Headers
+#
+
+INCLUDEPATH += ../../pinger/include
+HEADERS = ../../pinger/include/host_address.h \
+          ../../pinger/include/ping_engine.h \
+
+########################################################################################################################
+# Source files
+#
+
+SOURCES = engine_bench.cpp \
+          ../../pinger/source/host_address.cpp \
+          ../../pinger/source/ping_engine.cpp \
+
+########################################################################################################################
+# Locate build intermediate and output products
+#
+
+TARGET = engine_bench
+
+CONFIG(debug, debug|release) {
+    unix:DESTDIR = build/debug
+    win32:DESTDIR = build/Debug
+} else {
+    unix:DESTDIR = build/release
+    win32:DESTDIR = build/Release
+}
+
+OBJECTS_DIR = $${DESTDIR}/objects
+MOC_DIR = $${DESTDIR}/moc
+RCC_DIR = $${DESTDIR}/rcc
+UI_DIR = $${DESTDIR}/ui
@@ -22,18 +22,22 @@ TEMPLATE = app
 QT += core network gui widgets
 CONFIG += c++14
 
+unix:!macx:LIBS += -lrt
+
 ########################################################################################################################
 # Headers
 #
 
-HEADERS = pinger_test_dialog.h
+HEADERS = pinger_test_dialog.h \
+          server_model.h
 
 ########################################################################################################################
 # Source files
 #
 
 SOURCES = pinger_test.cpp \
-          pinger_test_dialog.cpp
+          pinger_test_dialog.cpp \
+          server_model.cpp
 
 ########################################################################################################################
 # Locate build intermediate and output products
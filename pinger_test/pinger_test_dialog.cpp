@@ -26,10 +26,12 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QPlainTextEdit>
+#include <QTableView>
 #include <QDialogButtonBox>
 #include <QLocalSocket>
 #include <QMessageBox>
 
+#include "server_model.h"
 #include "pinger_test_dialog.h"
 
 PingerTestDialog::PingerTestDialog(QWidget* parent):QDialog(parent) {
@@ -60,11 +62,26 @@ PingerTestDialog::PingerTestDialog(QWidget* parent):QDialog(parent) {
     commandSendPushButton = new QPushButton(tr("Send"));
     commandHorizontalLayout->addWidget(commandSendPushButton);
 
+    QHBoxLayout* statusTableHorizontalLayout = new QHBoxLayout;
+    formLayout->addRow(tr("Status Table "), statusTableHorizontalLayout);
+
+    statusTableLineEdit = new QLineEdit;
+    statusTableHorizontalLayout->addWidget(statusTableLineEdit);
+
+    statusTablePushButton = new QPushButton(tr("Open"));
+    statusTableHorizontalLayout->addWidget(statusTablePushButton);
+
     responseTextEdit = new QPlainTextEdit;
     mainLayout->addWidget(responseTextEdit);
 
     responseTextEdit->setReadOnly(true);
 
+    serverModel = new ServerModel(this);
+
+    statusTableView = new QTableView;
+    statusTableView->setModel(serverModel);
+    mainLayout->addWidget(statusTableView);
+
     QDialogButtonBox* dialogButtonBox = new QDialogButtonBox(Qt::Orientation::Horizontal);
     dialogButtonBox->setStandardButtons(QDialogButtonBox::StandardButton::Close);
 
@@ -75,6 +92,9 @@ PingerTestDialog::PingerTestDialog(QWidget* parent):QDialog(parent) {
     connect(serverKeyLineEdit, &QLineEdit::returnPressed, this, &PingerTestDialog::serverKeyEntered);
     connect(serverKeyPushButton, &QPushButton::clicked, this, &PingerTestDialog::serverKeyEntered);
 
+    connect(statusTableLineEdit, &QLineEdit::returnPressed, this, &PingerTestDialog::statusTableEntered);
+    connect(statusTablePushButton, &QPushButton::clicked, this, &PingerTestDialog::statusTableEntered);
+
     connect(commandLineEdit, &QLineEdit::returnPressed, this, &PingerTestDialog::commandEntered);
     connect(commandSendPushButton, &QPushButton::clicked, this, &PingerTestDialog::commandEntered);
 
@@ -116,6 +136,14 @@ void PingerTestDialog::serverKeyEntered() {
 }
 
 
+void PingerTestDialog::statusTableEntered() {
+    QString tableName = statusTableLineEdit->text().trimmed();
+    if (!tableName.isEmpty()) {
+        serverModel->connect(tableName);
+    }
+}
+
+
 void PingerTestDialog::commandEntered() {
     QString rawCommand = commandLineEdit->text();
     QString command    = rawCommand + "\n";
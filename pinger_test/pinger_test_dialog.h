@@ -31,8 +31,11 @@ class QVBoxLayout;
 class QLineEdit;
 class QPlainTextEdit;
 class QPushButton;
+class QTableView;
 class QLocalSocket;
 
+class ServerModel;
+
 /**
  * Dialog used test the pinger server.
  */
@@ -55,6 +58,11 @@ class PingerTestDialog:public QDialog {
          */
         void serverKeyEntered();
 
+        /**
+         * Slot that is triggered when the status table name is entered.
+         */
+        void statusTableEntered();
+
         /**
          * Slot that is triggered when a new command is entered.
          */
@@ -106,6 +114,26 @@ class PingerTestDialog:public QDialog {
          */
         QPlainTextEdit* responseTextEdit;
 
+        /**
+         * The line editor where the user can enter the status table name.
+         */
+        QLineEdit* statusTableLineEdit;
+
+        /**
+         * The status table open push button.
+         */
+        QPushButton* statusTablePushButton;
+
+        /**
+         * The view showing the status table.
+         */
+        QTableView* statusTableView;
+
+        /**
+         * The model reading the status table.
+         */
+        ServerModel* serverModel;
+
         /**
          * The local socket connection.
          */
@@ -13,22 +13,32 @@
 *   You should have received a copy of the GNU General Public License along with this program.  If not, see
 *   <https://www.gnu.org/licenses/>.
 ********************************************************************************************************************//**
-* \filef
+* \file
 *
 * This file implements the \ref ServerModel class.
 ***********************************************************************************************************************/
 
 #include <QString>
+#include <QByteArray>
 #include <QVariant>
-#include <QSharedMemory>
-#include <QSystemSemaphore>
 #include <QModelIndex>
+#include <QVector>
+#include <QTimer>
+#include <QDateTime>
 #include <QAbstractTableModel>
 #include <QMessageBox>
 
-#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
 
-#include "../pinger/pinger/include/shared_memory.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../pinger/include/status_table_layout.h"
+#include "../pinger/include/server_data.h"
 #include "server_model.h"
 
 /***********************************************************************************************************************
@@ -36,85 +46,111 @@
 */
 
 ServerModel::ServerModel(QObject* parent):QAbstractTableModel(parent) {
-    sharedMemory = nullptr;
-    semaphore    = nullptr;
+    header      = nullptr;
+    tableSlots  = nullptr;
+    mappingSize = 0;
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(false);
+
+    QObject::connect(refreshTimer, &QTimer::timeout, this, &ServerModel::refresh);
 }
 
 
-ServerModel::~ServerModel() {}
+ServerModel::~ServerModel() {
+    disconnect();
+}
 
 
-bool ServerModel::connect(const QString& serverKey) {
-    bool result;
+bool ServerModel::connect(const QString& tableName) {
+    disconnect();
 
-    if (sharedMemory == nullptr && semaphore == nullptr) {
-        sharedMemory = new QSharedMemory(serverKey + "Memory", this);
-        semaphore    = new QSystemSemaphore(serverKey + "Semaphore");
+    QByteArray objectName = tableName.toLocal8Bit();
+    if (!objectName.startsWith('/')) {
+        objectName.prepend('/');
+    }
 
-        result = sharedMemory->create(sizeof(SharedMemory), QSharedMemory::AccessMode::ReadWrite);
-        if (result) {
-            result = (semaphore->error() == QSystemSemaphore::SystemSemaphoreError::NoError);
-            if (!result) {
-                QMessageBox::critical(
-                    nullptr,
-                    tr("No Connect"),
-                    tr("Could not create semaphore: %1").arg(semaphore->errorString())
-                );
-            }
-        } else {
-            if (sharedMemory->error() == QSharedMemory::SharedMemoryError::AlreadyExists) {
-                result = sharedMemory->attach(QSharedMemory::AccessMode::ReadWrite);
-                if (!result) {
-                    QMessageBox::critical(
-                        nullptr,
-                        tr("No Connect"),
-                        tr("Could not create shared memory instance: %1").arg(sharedMemory->errorString())
-                    );
+    QString errorMessage;
+    int     fd = ::shm_open(objectName.constData(), O_RDONLY, 0);
+    if (fd >= 0) {
+        struct stat status;
+        if (::fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= sizeof(StatusTableHeader)) {
+            std::size_t size    = static_cast<std::size_t>(status.st_size);
+            void*       mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                const StatusTableHeader* tableHeader = reinterpret_cast<const StatusTableHeader*>(mapping);
+                std::size_t              needed      =   sizeof(StatusTableHeader)
+                                                       + sizeof(StatusTableSlot) * tableHeader->capacity;
+
+                if (tableHeader->magic.load(std::memory_order_acquire) != statusTableMagic) {
+                    errorMessage = tr("Table is not a pinger status table.");
+                } else if (tableHeader->layoutVersion != statusTableLayoutVersion ||
+                           tableHeader->slotSize != sizeof(StatusTableSlot)       ||
+                           needed > size                                             ) {
+                    errorMessage = tr("Unsupported status table layout.");
+                }
+
+                if (errorMessage.isEmpty()) {
+                    header      = tableHeader;
+                    tableSlots  = reinterpret_cast<const StatusTableSlot*>(tableHeader + 1);
+                    mappingSize = size;
+                } else {
+                    ::munmap(mapping, size);
                 }
             } else {
-                QMessageBox::critical(
-                    nullptr,
-                    tr("No Connect"),
-                    tr("Could not create shared memory instance: %1").arg(sharedMemory->errorString())
-                );
+                errorMessage = QString::fromLocal8Bit(std::strerror(errno));
             }
+        } else {
+            errorMessage = tr("Table is truncated.");
         }
 
-        if (result) {
-            beginResetModel();
-            sharedMemory->lock();
-
-            SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-            memset(shared, 0, sizeof(SharedMemory));
-
-            shared->command               = Command::COMPLETED;
-            shared->numberHosts           = 0;
-            shared->reconfigurationNeeded = 0;
-
-            for (unsigned i=0 ; i<maximumNumberServers ; ++i) {
-                shared->servers[i].hostStatus = HostStatus::UNTESTED;
-            }
+        ::close(fd);
+    } else {
+        errorMessage = QString::fromLocal8Bit(std::strerror(errno));
+    }
 
-            sharedMemory->unlock();
-            endResetModel();
-        }
+    bool result = errorMessage.isEmpty();
+    if (result) {
+        refresh();
+        refreshTimer->start(refreshInterval);
     } else {
-        result = false;
+        QMessageBox::critical(
+            nullptr,
+            tr("No Connect"),
+            tr("Could not map status table %1: %2").arg(tableName).arg(errorMessage)
+        );
     }
 
     return result;
 }
 
 
+void ServerModel::disconnect() {
+    if (header != nullptr) {
+        refreshTimer->stop();
+
+        beginResetModel();
+        ::munmap(const_cast<StatusTableHeader*>(header), mappingSize);
+
+        header      = nullptr;
+        tableSlots  = nullptr;
+        mappingSize = 0;
+        snapshot.clear();
+        endResetModel();
+    }
+}
+
+
 QVariant ServerModel::headerData(int section, Qt::Orientation orientation, int role) const {
     QVariant result;
 
     if (role == Qt::DisplayRole) {
         if (orientation == Qt::Orientation::Horizontal) {
-            if (section == 0) {
-                result = QString("Server");
-            } else {
-                result = QString("Status");
+            switch (section) {
+                case 0:  { result = tr("Server ID");     break; }
+                case 1:  { result = tr("Status");        break; }
+                case 2:  { result = tr("Last RTT (ms)"); break; }
+                default: { result = tr("Last Seen");     break; }
             }
         } else {
             result = QString::number(section + 1);
@@ -125,93 +161,38 @@ QVariant ServerModel::headerData(int section, Qt::Orientation orientation, int r
 }
 
 
-Qt::ItemFlags ServerModel::flags(const QModelIndex& index) const {
-    unsigned long column = static_cast<unsigned long>(index.column());
-    Qt::ItemFlags result;
-
-    if (column == 0) {
-        result = QAbstractTableModel::flags(index) | Qt::ItemIsEditable | Qt::ItemIsEnabled;
-    } else {
-        result = QAbstractTableModel::flags(index) | Qt::ItemIsEnabled;
-    }
-
-    return result;
-}
-
-
 QVariant ServerModel::data(const QModelIndex& index, int role) const {
     QVariant result;
 
-    switch (role) {
-        case Qt::EditRole:
-        case Qt::DisplayRole: {
-            unsigned long row    = static_cast<unsigned long>(index.row());
-            unsigned long column = static_cast<unsigned long>(index.column());
-
-            sharedMemory->lock();
-            const SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-
-            if (row < shared->numberHosts) {
-                const Server& serverEntry = shared->servers[row];
-                result =   (column == 0)
-                         ? QString::fromUtf8(reinterpret_cast<const char*>(serverEntry.serverName))
-                         : toString(serverEntry.hostStatus);
-            } else {
-                result = QString();
+    if (role == Qt::DisplayRole && index.row() < snapshot.size()) {
+        const StatusTableEntry& entry = snapshot.at(index.row());
+        switch (index.column()) {
+            case 0: {
+                result = QString::number(entry.hostId);
+                break;
             }
 
-            sharedMemory->unlock();
-            break;
-        }
-    }
-
-    return result;
-}
-
-
-bool ServerModel::setData(const QModelIndex& index, const QVariant& variant, int role) {
-    bool result;
-
-    if (role == Qt::EditRole) {
-        unsigned long row    = static_cast<unsigned long>(index.row());
-        unsigned long column = static_cast<unsigned long>(index.column());
-
-        if (column == 0) {
-            sharedMemory->lock();
-            SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-
-            if (row <= shared->numberHosts) {
-                Server& server  = shared->servers[row];
-                QString oldName = QString::fromUtf8(reinterpret_cast<const char*>(server.serverName));
-                QString newName = variant.toString().trimmed();
-
-                if (oldName != newName) {
-                    beginResetModel();
-
-                    QByteArray v = newName.toUtf8();
-                    unsigned   l = static_cast<unsigned>(v.size());
-
-                    memset(server.serverName, 0, maximumServerNameLength + 1);
-                    server.pad = 0;
+            case 1: {
+                result = toString(static_cast<ServerData::Status>(entry.status));
+                break;
+            }
 
-                    memcpy(server.serverName, v.data(), std::min(l, maximumServerNameLength));
-                    shared->reconfigurationNeeded = true;
+            case 2: {
+                if (entry.lastRtt != statusTableNoRtt) {
+                    result = QString::number(entry.lastRtt / 1000.0, 'f', 3);
+                }
 
-                    if (row >= shared->numberHosts) {
-                        shared->numberHosts = static_cast<std::uint32_t>(row + 1);
-                    }
+                break;
+            }
 
-                    endResetModel();
+            default: {
+                if (entry.lastSeen != 0) {
+                    result = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(entry.lastSeen)).toString();
                 }
-            }
 
-            sharedMemory->unlock();
-            result = true;
-        } else {
-            result = false;
+                break;
+            }
         }
-    } else {
-        result = false;
     }
 
     return result;
@@ -219,77 +200,56 @@ bool ServerModel::setData(const QModelIndex& index, const QVariant& variant, int
 
 
 int ServerModel::columnCount(const QModelIndex& /* parent */) const {
-    return 2;
+    return 4;
 }
 
 
 int ServerModel::rowCount(const QModelIndex& /* parent */) const {
-    int result;
-
-    if (sharedMemory == nullptr || semaphore == nullptr) {
-        result = 0;
-    } else {
-        result = reinterpret_cast<SharedMemory*>(sharedMemory->data())->numberHosts + 1;
-    }
-
-    return result;
+    return snapshot.size();
 }
 
 
-void ServerModel::shutdown() {
-    sharedMemory->lock();
-    SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-    if (shared->command == Command::COMPLETED) {
-        shared->command = Command::SHUTDOWN;
-        sharedMemory->unlock();
-        semaphore->release();
-    } else {
-        sharedMemory->unlock();
-        QMessageBox::information(nullptr, tr("Pinger Busy"), tr("Command is not \"COMPLETED\""));
-    }
-}
+void ServerModel::refresh() {
+    QVector<StatusTableEntry> newSnapshot;
 
+    if (header != nullptr && header->magic.load(std::memory_order_acquire) == statusTableMagic) {
+        unsigned numberSlots = header->numberSlots.load(std::memory_order_acquire);
+        if (numberSlots > header->capacity) {
+            numberSlots = header->capacity;
+        }
 
-void ServerModel::runActive() {
-    sharedMemory->lock();
-    SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-    if (shared->command == Command::COMPLETED) {
-        shared->command = Command::RUN_ACTIVE;
-        sharedMemory->unlock();
-        semaphore->release();
-    } else {
-        sharedMemory->unlock();
-        QMessageBox::information(nullptr, tr("Pinger Busy"), tr("Command is not \"COMPLETED\""));
+        newSnapshot.reserve(static_cast<int>(numberSlots));
+        for (unsigned slot=0 ; slot<numberSlots ; ++slot) {
+            StatusTableEntry entry;
+            if (tableSlots[slot].read(entry) && entry.hostId != 0) {
+                newSnapshot.append(entry);
+            }
+        }
     }
-}
 
-
-void ServerModel::runAll() {
-    sharedMemory->lock();
-    SharedMemory* shared = reinterpret_cast<SharedMemory*>(sharedMemory->data());
-    if (shared->command == Command::COMPLETED) {
-        shared->command = Command::RUN_ALL;
-        sharedMemory->unlock();
-        semaphore->release();
-    } else {
-        sharedMemory->unlock();
-        QMessageBox::information(nullptr, tr("Pinger Busy"), tr("Command is not \"COMPLETED\""));
+    if (newSnapshot.size() != snapshot.size()) {
+        beginResetModel();
+        snapshot.swap(newSnapshot);
+        endResetModel();
+    } else if (!snapshot.isEmpty()) {
+        snapshot.swap(newSnapshot);
+        emit dataChanged(index(0, 0), index(snapshot.size() - 1, columnCount() - 1));
     }
 }
 
 
-QString ServerModel::toString(HostStatus hostStatus) {
+QString ServerModel::toString(ServerData::Status hostStatus) {
     QString result;
 
     switch (hostStatus) {
-        case HostStatus::UNTESTED:         { result = tr("Untested");           break; }
-        case HostStatus::DEFUNCT:          { result = tr("Defunct");            break; }
-        case HostStatus::ACTIVE:           { result = tr("Active");             break; }
-        case HostStatus::INACTIVE_1:       { result = tr("Inactive 1");         break; }
-        case HostStatus::INACTIVE_2:       { result = tr("Inactive 2");         break; }
-        case HostStatus::INACTIVE_3:       { result = tr("Inactive 3");         break; }
-        case HostStatus::INACTIVE_4:       { result = tr("Inactive 4");         break; }
-        case HostStatus::INACTIVE_FLAGGED: { result = tr("Inactive Flagged");   break; }
+        case ServerData::Status::UNTESTED:         { result = tr("Untested");           break; }
+        case ServerData::Status::DEFUNCT:          { result = tr("Defunct");            break; }
+        case ServerData::Status::ACTIVE:           { result = tr("Active");             break; }
+        case ServerData::Status::INACTIVE_1:       { result = tr("Inactive 1");         break; }
+        case ServerData::Status::INACTIVE_2:       { result = tr("Inactive 2");         break; }
+        case ServerData::Status::INACTIVE_3:       { result = tr("Inactive 3");         break; }
+        case ServerData::Status::INACTIVE_4:       { result = tr("Inactive 4");         break; }
+        case ServerData::Status::INACTIVE_FLAGGED: { result = tr("Inactive Flagged");   break; }
         default: {
             result = QString::number(static_cast<unsigned>(hostStatus));
             break;
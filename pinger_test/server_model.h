@@ -24,18 +24,22 @@
 #define SERVER_MODEL_H
 
 #include <QString>
+#include <QByteArray>
 #include <QVariant>
 #include <QModelIndex>
-#include <QList>
+#include <QVector>
 #include <QAbstractTableModel>
 
-#include "../pinger/pinger/include/shared_memory.h"
+#include <cstddef>
 
-class QSharedMemory;
-class QSystemSemaphore;
+#include "../pinger/include/status_table_layout.h"
+#include "../pinger/include/server_data.h"
+
+class QTimer;
 
 /**
- * Class that provides a model for the pinger test.
+ * Class that provides a read-only model over the status table published by the pinger.  The model maps the table
+ * read-only and takes a snapshot on a timer, so it never blocks or signals the pinger.
  */
 class ServerModel:public QAbstractTableModel {
     Q_OBJECT
@@ -51,13 +55,18 @@ class ServerModel:public QAbstractTableModel {
         ~ServerModel() override;
 
         /**
-         * Method you can use to connect to a remote ping server.
+         * Method you can use to connect to the status table published by a ping server.
          *
-         * \param[in] serverKey The server key used to connect to the server.
+         * \param[in] tableName The status table name passed to the ping server.
          *
          * \return Returns true on success.  Returns false on error.
          */
-        bool connect(const QString& serverKey);
+        bool connect(const QString& tableName);
+
+        /**
+         * Method you can use to disconnect from the status table.
+         */
+        void disconnect();
 
         /**
          * Method used by the view to obtain the header data to be displayed.
@@ -72,15 +81,6 @@ class ServerModel:public QAbstractTableModel {
          */
         QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
-        /**
-         * Method used by the view to obtain the item flags.
-         *
-         * \param[in] index The index of the cell being queried.
-         *
-         * \return Returns the flags tied to the cell.
-         */
-        Qt::ItemFlags flags(const QModelIndex& index) const override;
-
         /**
          * Method used by the view to obtain the data to be displayed.
          *
@@ -92,19 +92,6 @@ class ServerModel:public QAbstractTableModel {
          */
         QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
 
-        /**
-         * Method used by the model to update the contents of a cell.
-         *
-         * \param[in] index The index indicating the row/column being updated.
-         *
-         * \param[in] value A variant holding the new value for the cell.
-         *
-         * \param[in] role  The role for the data being updated.
-         *
-         * \return Returns true on success.  Returns false on error.
-         */
-        bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
-
         /**
          * Method used by the view to obtain the number of columns to be displayed.
          *
@@ -121,21 +108,16 @@ class ServerModel:public QAbstractTableModel {
 
     public slots:
         /**
-         * Slot you can trigger to shutdown the pinger server.
-         */
-        void shutdown();
-
-        /**
-         * Slot you can trigger to run only the active servers.
+         * Slot you can trigger to take a new snapshot of the status table.
          */
-        void runActive();
+        void refresh();
 
+    private:
         /**
-         * Slot you can trigger to run all servers.
+         * The interval between snapshots, in milliseconds.
          */
-        void runAll();
+        static constexpr unsigned refreshInterval = 997;
 
-    private:
         /**
          * Method you can use to obtain the host status as a string.
          *
@@ -143,17 +125,32 @@ class ServerModel:public QAbstractTableModel {
          *
          * \return Returns the host status encoded as a string.
          */
-        static QString toString(HostStatus hostStatus);
+        static QString toString(ServerData::Status hostStatus);
+
+        /**
+         * The mapped table header.  A null pointer indicates the model is not connected.
+         */
+        const StatusTableHeader* header;
+
+        /**
+         * The mapped slots.
+         */
+        const StatusTableSlot* tableSlots;
+
+        /**
+         * The size of the mapping, in bytes.
+         */
+        std::size_t mappingSize;
 
         /**
-         * The shared memory object.
+         * The most recent snapshot of the servers in the table.
          */
-        QSharedMemory* sharedMemory;
+        QVector<StatusTableEntry> snapshot;
 
         /**
-         * The semaphore used to gate access.
+         * Timer used to refresh the snapshot.
          */
-        QSystemSemaphore* semaphore;
+        QTimer* refreshTimer;
 };
 
 #endif
@@ -15,4 +15,4 @@
 ########################################################################################################################
 
 TEMPLATE = subdirs
-SUBDIRS = pinger pinger_test
+SUBDIRS = pinger pinger_test pinger_bench